@@ -58,6 +58,21 @@ public:
   }
 
 
+  /// Pops into item if there is something to return, never blocks.
+  /// \return False if the queue was empty.
+  bool
+  tryPop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_queue.empty()) {
+      return false;
+    }
+    item = m_queue.front();
+    m_queue.pop();
+    return true;
+  }
+
+
 private:
   std::queue <T> m_queue;
   std::mutex m_lock;
@@ -0,0 +1,359 @@
+#ifndef bd_ringqueue_h
+#define bd_ringqueue_h
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace bd
+{
+
+/// \brief Size of a cache line, used to keep producer and consumer indexes apart.
+size_t const CACHE_LINE_SIZE{ 64 };
+
+
+/// \brief Lets threads sleep until another thread signals, without a mutex
+///        on the signalling side.
+///
+/// A waiter calls prepareWait(), re-checks its condition, then either calls
+/// cancelWait() or wait(). notify() only makes a system call if some thread
+/// has called prepareWait() and not yet returned from wait().
+class WaitEvent
+{
+public:
+  WaitEvent()
+    : m_epoch{ 0 }
+    , m_waiters{ 0 }
+  { }
+
+
+  /// \brief Announce intent to wait.
+  /// \return A token to pass to wait().
+  uint32_t
+  prepareWait()
+  {
+    m_waiters.fetch_add(1);
+    return m_epoch.load();
+  }
+
+
+  /// \brief Withdraw a prepareWait() without sleeping.
+  void
+  cancelWait()
+  {
+    m_waiters.fetch_sub(1);
+  }
+
+
+  /// \brief Sleep until notify() is called after prepareWait() returned \c token.
+  /// \note Spurious wake ups are possible. Withdraws the prepareWait().
+  void
+  wait(uint32_t token)
+  {
+#ifdef __linux__
+    if (m_epoch.load() == token) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_epoch),
+              FUTEX_WAIT_PRIVATE, token, nullptr, nullptr, 0);
+    }
+#else
+    std::unique_lock<std::mutex> lck(m_mutex);
+    while (m_epoch.load() == token) {
+      m_cv.wait(lck);
+    }
+#endif
+    cancelWait();
+  }
+
+
+  /// \brief Wake at most \c n waiting threads.
+  void
+  notify(int n = 1)
+  {
+    m_epoch.fetch_add(1);
+    if (m_waiters.load() == 0) {
+      return;
+    }
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_epoch),
+            FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+#else
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if (n == 1) {
+      m_cv.notify_one();
+    } else {
+      m_cv.notify_all();
+    }
+#endif
+  }
+
+
+  /// \brief Wake all waiting threads.
+  void
+  notifyAll()
+  {
+    notify(INT_MAX);
+  }
+
+
+private:
+  std::atomic<uint32_t> m_epoch;
+  std::atomic<uint32_t> m_waiters;
+#ifndef __linux__
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+#endif
+
+}; // class WaitEvent
+
+
+/// \brief Bounded lock-free queue for exactly one producer and one consumer thread.
+template<class T>
+class SpscRing
+{
+public:
+  /// \param capacity Rounded up to a power of two.
+  SpscRing(size_t capacity)
+    : m_cells{ nullptr }
+    , m_mask{ 0 }
+    , m_head{ 0 }
+    , m_tail{ 0 }
+  {
+    size_t cap{ 2 };
+    while (cap < capacity) {
+      cap <<= 1;
+    }
+    m_mask = cap - 1;
+    m_cells = new T[cap];
+  }
+
+
+  ~SpscRing()
+  {
+    delete[] m_cells;
+  }
+
+
+  SpscRing(SpscRing const &) = delete;
+  SpscRing &operator=(SpscRing const &) = delete;
+
+
+  /// \brief Push \c item, only call from the producer thread.
+  /// \return False if the ring is full.
+  bool
+  tryPush(T const &item)
+  {
+    size_t const tail{ m_tail.load(std::memory_order_relaxed) };
+    if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+      return false;
+    }
+    m_cells[tail & m_mask] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  /// \brief Pop into \c item, only call from the consumer thread.
+  /// \return False if the ring is empty.
+  bool
+  tryPop(T &item)
+  {
+    size_t const head{ m_head.load(std::memory_order_relaxed) };
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = m_cells[head & m_mask];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  /// \brief Number of items, only exact when neither side is active.
+  size_t
+  size() const
+  {
+    return m_tail.load() - m_head.load();
+  }
+
+
+private:
+  // Padding keeps the two indexes on separate cache lines. (alignas would
+  // need C++17 aligned new for rings allocated on the heap.)
+  T *m_cells;
+  size_t m_mask;
+  char m_pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> m_head;  ///< Next cell to pop.
+  char m_pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail;  ///< Next cell to push.
+  char m_pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+}; // class SpscRing
+
+
+/// \brief Bounded lock-free queue for any number of producers and consumers.
+///
+/// Each cell carries a sequence number that tells producers and consumers
+/// whose turn it is, so the only contended operations are a CAS on the
+/// enqueue or dequeue position (D. Vyukov's bounded MPMC queue).
+template<class T>
+class MpmcRing
+{
+public:
+  /// \param capacity Rounded up to a power of two.
+  MpmcRing(size_t capacity)
+    : m_cells{ nullptr }
+    , m_mask{ 0 }
+    , m_enqueuePos{ 0 }
+    , m_dequeuePos{ 0 }
+  {
+    size_t cap{ 2 };
+    while (cap < capacity) {
+      cap <<= 1;
+    }
+    m_mask = cap - 1;
+    m_cells = new Cell[cap];
+    for (size_t i{ 0 }; i < cap; ++i) {
+      m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+
+  ~MpmcRing()
+  {
+    delete[] m_cells;
+  }
+
+
+  MpmcRing(MpmcRing const &) = delete;
+  MpmcRing &operator=(MpmcRing const &) = delete;
+
+
+  /// \brief Push \c item.
+  /// \return False if the ring is full.
+  bool
+  tryPush(T const &item)
+  {
+    size_t pos{ m_enqueuePos.load(std::memory_order_relaxed) };
+    Cell *cell{ nullptr };
+    while (true) {
+      cell = &m_cells[pos & m_mask];
+      size_t const seq{ cell->seq.load(std::memory_order_acquire) };
+      intptr_t const diff{ static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) };
+      if (diff == 0) {
+        if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  /// \brief Pop into \c item.
+  /// \return False if the ring is empty.
+  bool
+  tryPop(T &item)
+  {
+    size_t pos{ m_dequeuePos.load(std::memory_order_relaxed) };
+    Cell *cell{ nullptr };
+    while (true) {
+      cell = &m_cells[pos & m_mask];
+      size_t const seq{ cell->seq.load(std::memory_order_acquire) };
+      intptr_t const diff{ static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) };
+      if (diff == 0) {
+        if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+
+    item = cell->data;
+    cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  /// \brief Number of items, only exact when no thread is active.
+  size_t
+  size() const
+  {
+    return m_enqueuePos.load() - m_dequeuePos.load();
+  }
+
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  Cell *m_cells;
+  size_t m_mask;
+  char m_pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> m_enqueuePos;
+  char m_pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_dequeuePos;
+  char m_pad2[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+
+}; // class MpmcRing
+
+
+/// \brief Spin on \c tryPop before sleeping on \c ev until it succeeds or
+///        \c give_up returns true.
+///
+/// A producer may push its last item and then set the condition \c give_up
+/// checks in between a failed tryPop and the check, so the ring is tried
+/// once more after \c give_up returns true.
+/// \return False if \c give_up returned true and the queue was empty.
+template<class Ring, class T, class GiveUp>
+bool
+popOrWait(Ring &ring, WaitEvent &ev, T &item, GiveUp give_up)
+{
+  for (int spin{ 0 }; spin < 64; ++spin) {
+    if (ring.tryPop(item)) {
+      return true;
+    }
+  }
+
+  while (true) {
+    if (ring.tryPop(item)) {
+      return true;
+    }
+
+    uint32_t const token{ ev.prepareWait() };
+    if (ring.tryPop(item)) {
+      ev.cancelWait();
+      return true;
+    }
+    if (give_up()) {
+      ev.cancelWait();
+      return ring.tryPop(item);
+    }
+    ev.wait(token);
+  }
+}
+
+} // namespace bd
+
+#endif // ! bd_ringqueue_h
@@ -5,9 +5,18 @@
 #ifndef bd_voxelopacityfilter_h
 #define bd_voxelopacityfilter_h
 
+#include <bd/io/buffer.h>
 #include <bd/volume/transferfunction.h>
+#include <bd/volume/transferfunctionlut.h>
 
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace bd
@@ -30,8 +39,8 @@ public:
       , m_max{ knotMax }
       , m_dataMin{ dataMin }
       , m_diff{ static_cast<Ty>(dataMax-dataMin) }
+      , m_table{ std::make_shared<Table>() }
   {
-
   }
 
 
@@ -74,12 +83,147 @@ public:
   }
 
 
+  /// \brief Number of 64 bit words classify() fills for \c n voxels.
+  static size_t
+  maskWords(size_t n)
+  {
+    return ( n + 63 ) / 64;
+  }
+
+
+  /// \brief Classify \c n voxels at once into a bitmask.
+  ///
+  /// Bit i % 64 of bits[i / 64] is set if voxel i is relevant, the unused
+  /// bits of the last word are cleared. Voxels are looked up in an
+  /// OpacityLUT::forType() of alpha() instead of walking the knots. The
+  /// table is made by the first call, and shared by copies of the filter,
+  /// so filters that are only used through operator() never pay for it.
+  /// 8 and 16 bit integers have an entry per value, other types
+  /// TF_LUT_DEFAULT_SIZE entries over the data range, so values within one
+  /// entry of an opacity boundary may land on either side of it. Values
+  /// outside the data range count as the nearest end of it.
+  ///
+  /// Each word of the mask is made from a fixed run of 64 voxels with no
+  /// branches on the values, which compilers vectorize.
+  ///
+  /// \param bits At least maskWords(n) words.
+  /// \return The number of relevant voxels.
+  uint64_t
+  classify(Ty const *data, size_t n, uint64_t *bits) const
+  {
+    OpacityLUT const &lut{ table() };
+    uint64_t relevant{ 0 };
+    size_t const full{ n / 64 };
+    for (size_t w{ 0 }; w < full; ++w) {
+      bits[w] = classifyWord(lut, data + w * 64, 64, ExactTable{ });
+      relevant += std::bitset<64>(bits[w]).count();
+    }
+    if (n % 64 != 0) {
+      bits[full] = classifyWord(lut, data + full * 64, n % 64, ExactTable{ });
+      relevant += std::bitset<64>(bits[full]).count();
+    }
+    return relevant;
+  }
+
+
+  /// \brief Classify the voxels of \c buf into \c bits, resized to fit.
+  /// \return The number of relevant voxels.
+  uint64_t
+  classify(Buffer<Ty> const &buf, std::vector<uint64_t> &bits) const
+  {
+    bits.resize(maskWords(buf.getNumElements()));
+    return classify(buf.getPtr(), buf.getNumElements(), bits.data());
+  }
+
+
 private:
+  /// \brief True if OpacityLUT::forType() has an entry for every value of Ty.
+  using ExactTable =
+      std::integral_constant<bool, std::is_integral<Ty>::value && sizeof(Ty) <= 2>;
+
+
+  /// \brief alpha() as a transfer function, to bake into an OpacityLUT.
+  class AlphaFunction : public TransferFunction<OpacityKnot, double>
+  {
+  public:
+    explicit AlphaFunction(VoxelOpacityFilter const &filter)
+      : m_filter{ filter }
+    { }
+
+    int
+    load(std::string const &) override
+    {
+      return -1;
+    }
+
+    double
+    interpolate(double v) const override
+    {
+      return m_filter.alpha(v);
+    }
+
+  private:
+    VoxelOpacityFilter const &m_filter;
+  };
+
+
+  /// \brief The table of classify(), made once by whichever copy of the
+  ///        filter needs it first.
+  struct Table
+  {
+    std::once_flag once;
+    OpacityLUT lut;
+  };
+
+
+  OpacityLUT const &
+  table() const
+  {
+    std::call_once(m_table->once, [this]() {
+      m_table->lut = OpacityLUT::forType(AlphaFunction{ *this }, m_dataMin,
+                                         static_cast<Ty>(m_dataMin + m_diff));
+    });
+    return m_table->lut;
+  }
+
+
+  bool
+  relevant(double a) const
+  {
+    return ( a >= m_min ) & ( a < m_max );
+  }
+
+
+  uint64_t
+  classifyWord(OpacityLUT const &lut, Ty const *data, size_t count, std::true_type) const
+  {
+    long const lo{ std::numeric_limits<Ty>::lowest() };
+    double const *alpha{ lut.data() };
+    uint64_t word{ 0 };
+    for (size_t j{ 0 }; j < count; ++j) {
+      word |= static_cast<uint64_t>(relevant(alpha[static_cast<long>(data[j]) - lo])) << j;
+    }
+    return word;
+  }
+
+
+  uint64_t
+  classifyWord(OpacityLUT const &lut, Ty const *data, size_t count, std::false_type) const
+  {
+    uint64_t word{ 0 };
+    for (size_t j{ 0 }; j < count; ++j) {
+      word |= static_cast<uint64_t>(relevant(lut.lookup(static_cast<double>(data[j])))) << j;
+    }
+    return word;
+  }
+
+
   std::vector<OpacityKnot> const m_func;
   double const m_min;
   double const m_max;
   Ty const m_dataMin;
   Ty const m_diff;
+  std::shared_ptr<Table> m_table;  ///< Shared by copies, see classify().
 
 
 }; // class VoxelOpacityFilter
@@ -0,0 +1,149 @@
+#ifndef bd_blockhistograms_h
+#define bd_blockhistograms_h
+
+#include <bd/io/indexfile.h>
+#include <bd/volume/transferfunction.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief A value histogram for every block of an IndexFile.
+///
+/// Each histogram has \c bins bins that are evenly spaced sample points over
+/// [dataMin, dataMax]: a voxel goes to the bin nearest its normalized value,
+/// and bin \c b stands for the normalized value b / (bins - 1). When the data
+/// has no more distinct, evenly spaced values than there are bins (8 bit data
+/// with 256 bins) every bin holds exactly one value and anything computed
+/// from the histograms matches a scan of the voxels.
+///
+/// The histograms are kept in the SectionType::Histograms section of the
+/// index, so the relevance of every block can be recomputed for a new
+/// transfer function without reading the volume again (see updateRelevance()).
+class BlockHistograms
+{
+public:
+  BlockHistograms();
+
+
+  /// \param numBlocks Number of blocks, normally IndexFile::blocks().size().
+  /// \param bins Bins per block, at least 2.
+  /// \param dataMin Value that normalizes to 0.
+  /// \param dataMax Value that normalizes to 1.
+  BlockHistograms(size_t numBlocks, uint32_t bins, double dataMin, double dataMax);
+
+
+  /// \brief Count the \c n voxels at \c voxels into the histogram of \c block.
+  template<class Ty>
+  void
+  add(size_t block, Ty const *voxels, size_t n);
+
+
+  /// \brief The bin that \c value is counted in.
+  uint32_t
+  binOf(double value) const;
+
+
+  /// \brief The normalized value bin \c b stands for.
+  double
+  binValue(uint32_t b) const;
+
+
+  /// \brief The \c bins() counts of \c block.
+  uint32_t const *
+  counts(size_t block) const;
+
+
+  size_t
+  numBlocks() const;
+
+
+  uint32_t
+  bins() const;
+
+
+  double
+  dataMin() const;
+
+
+  double
+  dataMax() const;
+
+
+  /// \brief Store the histograms as the Histograms section of \c index.
+  bool
+  store(IndexFile &index) const;
+
+
+  /// \brief Load the histograms from the Histograms section of \c index.
+  /// \return False if there is no such section or it doesn't match the blocks.
+  bool
+  load(IndexFile const &index);
+
+
+private:
+  /// \brief Start of the Histograms section, followed by the counts.
+  struct SectionHeader
+  {
+    uint32_t bins;
+    uint32_t count_bytes;  ///< sizeof(uint32_t)
+    uint64_t num_blocks;
+    double data_min;
+    double data_max;
+  };
+
+
+  size_t m_numBlocks;
+  uint32_t m_bins;
+  double m_dataMin;
+  double m_dataMax;
+  double m_scale;                 ///< (bins - 1) / (dataMax - dataMin)
+  std::vector<uint32_t> m_counts; ///< m_numBlocks x m_bins
+
+}; // class BlockHistograms
+
+
+/// \brief Histogram every block of \c index by reading its voxels from
+///        \c path, the row-major or bricked data file of the index.
+/// \return False if the data file could not be read.
+bool
+buildBlockHistograms(IndexFile const &index,
+                     std::string const &path,
+                     BlockHistograms &histograms);
+
+
+/// \brief Recompute rov, empty_voxels and is_empty of every block for
+///        the opacity transfer function \c otf.
+///
+/// A voxel is relevant when its opacity is in [minOpacity, maxOpacity), like
+/// VoxelOpacityFilter. The rov of a block is its fraction of relevant voxels
+/// and the block is empty if its rov is 0 or below \c minRov. The empty voxel
+/// count and rov range of the Volume are updated as well. Only the histograms
+/// are read, so this takes time in the number of blocks times bins, not voxels.
+void
+updateRelevance(IndexFile &index,
+                BlockHistograms const &histograms,
+                OpacityTransferFunction const &otf,
+                double minOpacity,
+                double maxOpacity,
+                double minRov = 0.0);
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BlockHistograms::add(size_t block, Ty const *voxels, size_t n)
+{
+  uint32_t *c{ m_counts.data() + block * m_bins };
+  for (size_t i{ 0 }; i < n; ++i) {
+    c[binOf(static_cast<double>(voxels[i]))] += 1;
+  }
+}
+
+} // namespace bd
+
+#endif // ! bd_blockhistograms_h
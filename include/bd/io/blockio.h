@@ -0,0 +1,85 @@
+#ifndef bd_blockio_h
+#define bd_blockio_h
+
+#include <bd/io/fileblock.h>
+#include <bd/io/indexfileheader.h>
+
+#include <glm/fwd.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Read the voxels of a FileBlock out of a row-major raw file into
+///        a contiguous, x-fastest brick.
+///
+/// Rows that are contiguous in the file (the block spans the whole volume
+/// along x, and possibly y) are read straight into \c dst. Otherwise each
+/// z-slab is fetched with one pread(2) that covers all of its rows and the
+/// rows are gathered out of \c scratch, unless the gaps between rows are so
+/// large that reading them would cost more than seeking.
+///
+/// With a \c halo the brick also holds \c halo voxels of the neighbouring
+/// blocks on every side, so it is voxel_dims + 2 * halo voxels along each
+/// axis. Halo voxels past the edge of the volume repeat the nearest voxel of
+/// the volume, like clamp-to-edge texture sampling.
+///
+/// \param fd Descriptor of the raw file. Only pread is used, so the same
+///           descriptor can be shared between threads.
+/// \param block The block to read.
+/// \param volDims Dimensions of the whole volume in voxels.
+/// \param tySize Size in bytes of a voxel.
+/// \param dst Destination, at least fileBlockBrickBytes(block, tySize, halo) bytes.
+/// \param scratch Staging memory, grown as needed and reusable between calls.
+/// \param halo Width of the halo in voxels.
+/// \returns The number of bytes written to \c dst, or -1 if a read failed.
+long long
+readFileBlock(int fd,
+              FileBlock const &block,
+              glm::u64vec3 const &volDims,
+              size_t tySize,
+              char *dst,
+              std::vector<char> &scratch,
+              unsigned halo = 0);
+
+
+/// \brief Size in bytes of the brick readFileBlock() produces for \c block.
+size_t
+fileBlockBrickBytes(FileBlock const &block, size_t tySize, unsigned halo = 0);
+
+
+/// \brief Drop the halo of a brick read with \c halo, in place, leaving
+///        the voxel_dims voxels of the block at the start of \c brick.
+void
+stripHalo(char *brick, FileBlock const &block, size_t tySize, unsigned halo);
+
+
+/// \brief Read the voxels of a FileBlock out of a file with any BlockStorage
+///        into a contiguous, x-fastest brick.
+///
+/// Row-major files go through readFileBlock(). For bricked files the brick
+/// is one pread(2) of data_bytes at data_offset, decompressed with the
+/// header's codec unless data_bytes is the full brick size. Bricks with
+/// data_bytes of 0 were left out of the file (see writeBrickedVolume()) and
+/// are filled with zeros.
+///
+/// \param header Header of the index the block came from.
+/// \param halo Width of the halo, see readFileBlock(). Bricks are returned
+///             as they were written, so for bricked files this must be the
+///             halo they were written with (see brickHalo()).
+/// \returns The number of bytes written to \c dst, or -1 on failure.
+long long
+readBlockData(int fd,
+              IndexFileHeader const &header,
+              FileBlock const &block,
+              glm::u64vec3 const &volDims,
+              size_t tySize,
+              char *dst,
+              std::vector<char> &scratch,
+              unsigned halo = 0);
+
+} // namespace bd
+
+#endif // ! bd_blockio_h
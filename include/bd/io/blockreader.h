@@ -0,0 +1,300 @@
+#ifndef bd_blockreader_h
+#define bd_blockreader_h
+
+#include <bd/io/blockio.h>
+#include <bd/io/brickedvolume.h>
+#include <bd/io/buffer.h>
+#include <bd/io/bufferpool.h>
+#include <bd/io/indexfile.h>
+#include <bd/log/logger.h>
+
+#include <glm/glm.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief Reads each FileBlock of an IndexFile into its own pool buffer.
+///
+/// Where BufferedReader fills buffers with flat slabs of the raw file,
+/// BlockReader fills each buffer with exactly one block, gathered into a
+/// contiguous x-fastest brick (see readBlockData()), so row-major and
+/// bricked files look the same to consumers. Blocks are read in the order
+/// they appear in the IndexFile.
+///
+/// The index offset of each Buffer handed out is the position of its
+/// FileBlock in IndexFile::blocks(), use fileBlock() to look it up.
+///
+/// Bricks written with a halo (see writeBrickedVolume()) are handed out
+/// with it, voxel_dims + 2 * halo() voxels along each axis.
+///
+/// Template parameter \c Ty is the data type contained in the raw file.
+template<class Ty>
+class BlockReader
+{
+
+public:
+  /// \param index Describes the blocks to read. Must outlive the reader.
+  /// \param numBuffers Number of block sized buffers in the pool.
+  BlockReader(IndexFile const &index, int numBuffers = 4);
+
+
+  ~BlockReader();
+
+
+  /// \brief Open the raw file at path.
+  /// \return True if opened, false if the file could not be opened or the
+  ///         buffer pool could not be allocated.
+  bool
+  open(std::string const &path);
+
+
+  /// \brief Start reading blocks.
+  void
+  start();
+
+
+  /// \brief Stop reading as soon as possible.
+  void
+  stop();
+
+
+  /// \brief Stop reading and wait for the read thread to exit.
+  /// \return The number of bytes read so far by the thread, or -1 on error.
+  long long int
+  reset();
+
+
+  /// \brief Grab the next filled block as soon as it is ready.
+  /// \return nullptr once all blocks have been handed out.
+  Buffer<Ty> *
+  waitNextFullUntilNone();
+
+
+  /// \brief Return a buffer to the empty pool to be filled again.
+  void
+  waitReturnEmpty(Buffer<Ty> *buf);
+
+
+  /// \brief Get the FileBlock that \c buf was filled with.
+  FileBlock const &
+  fileBlock(Buffer<Ty> const *buf) const;
+
+
+  /// \brief Get the number of elements in a single buffer (the largest block).
+  size_t
+  singleBufferElements() const;
+
+
+  /// \brief Width of the halo around each brick handed out.
+  unsigned
+  halo() const;
+
+
+private:
+  long long int
+  readBlocks();
+
+
+  IndexFile const *m_index;
+  std::string m_path;
+  int m_fd;
+  int m_numBuffers;
+  unsigned m_halo;
+
+  BufferPool<Ty> *m_pool;
+  std::future<long long int> m_future;
+  std::atomic_bool m_stopReaderThread;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+BlockReader<Ty>::BlockReader(IndexFile const &index, int numBuffers)
+    : m_index{ &index }
+    , m_path{ }
+    , m_fd{ -1 }
+    , m_numBuffers{ numBuffers > 0 ? numBuffers : 1 }
+    , m_halo{ brickHalo(index) }
+    , m_pool{ nullptr }
+    , m_future{ }
+    , m_stopReaderThread{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+BlockReader<Ty>::~BlockReader()
+{
+  if (m_future.valid()) {
+    reset();
+  }
+
+  if (m_pool) {
+    delete m_pool;
+  }
+
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BlockReader<Ty>::open(std::string const &path)
+{
+  m_path = path;
+  m_fd = ::open(m_path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    Err() << "Unable to open file: " + m_path;
+    return false;
+  }
+
+  size_t maxBlockBytes{ sizeof(Ty) };
+  for (FileBlock const &b : m_index->blocks()) {
+    size_t bytes{ fileBlockBrickBytes(b, sizeof(Ty), m_halo) };
+    if (bytes > maxBlockBytes) {
+      maxBlockBytes = bytes;
+    }
+  }
+
+  m_pool = new BufferPool<Ty>(maxBlockBytes * m_numBuffers, m_numBuffers);
+  if (! m_pool->allocate()) {
+    return false;
+  }
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BlockReader<Ty>::start()
+{
+  m_stopReaderThread = false;
+  m_future = std::async(std::launch::async, [this]() { return readBlocks(); });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BlockReader<Ty>::stop()
+{
+  m_stopReaderThread = true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+long long int
+BlockReader<Ty>::reset()
+{
+  m_stopReaderThread = true;
+  m_pool->requestStop();
+  long long int bytes{ m_future.get() };
+  m_pool->reset();
+  return bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+BlockReader<Ty>::waitNextFullUntilNone()
+{
+  return m_pool->nextFullUntilNone();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BlockReader<Ty>::waitReturnEmpty(Buffer<Ty> *buf)
+{
+  m_pool->returnEmpty(buf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+FileBlock const &
+BlockReader<Ty>::fileBlock(Buffer<Ty> const *buf) const
+{
+  return m_index->blocks()[buf->getIndexOffset()];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+BlockReader<Ty>::singleBufferElements() const
+{
+  return m_pool->bufferSizeElements();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+unsigned
+BlockReader<Ty>::halo() const
+{
+  return m_halo;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+long long int
+BlockReader<Ty>::readBlocks()
+{
+  Span<FileBlock const> const blocks{ m_index->blocks() };
+  glm::u64vec3 const volDims{ m_index->getVolume().voxelDims() };
+  std::vector<char> scratch;
+  long long int total{ 0 };
+
+  Dbg() << "Starting block reader loop.";
+  for (size_t i{ 0 }; i < blocks.size() && !m_stopReaderThread; ++i) {
+    Buffer<Ty> *buf{ m_pool->nextEmpty() };
+    if (buf == nullptr) {
+      break;
+    }
+
+    long long int bytes{
+        readBlockData(m_fd, m_index->getHeader(), blocks[i], volDims, sizeof(Ty),
+                      reinterpret_cast<char *>(buf->getPtr()), scratch, m_halo) };
+    if (bytes < 0) {
+      Err() << "Could not read block " << blocks[i].block_index << " from " << m_path;
+      m_pool->returnEmpty(buf);
+      total = -1;
+      break;
+    }
+
+    buf->setIndexOffset(i);
+    buf->setNumElements(static_cast<size_t>(bytes) / sizeof(Ty));
+    total += bytes;
+
+    m_pool->returnFull(buf);
+  }
+
+  m_pool->producerDone();
+  Dbg() << "Block reader done after reading " << total << " bytes";
+  return total;
+}
+
+
+} // namespace bd
+
+#endif // ! bd_blockreader_h
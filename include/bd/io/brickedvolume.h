@@ -0,0 +1,56 @@
+#ifndef bd_brickedvolume_h
+#define bd_brickedvolume_h
+
+#include <bd/io/compression.h>
+#include <bd/io/indexfile.h>
+
+#include <string>
+
+namespace bd
+{
+
+/// \brief Widest halo writeBrickedVolume() will write.
+unsigned const MAX_BRICK_HALO{ 2 };
+
+
+/// \brief Rewrite the row-major raw file described by \c index as a bricked
+///        volume, one contiguous brick per FileBlock.
+///
+/// Bricks are written in the order of IndexFile::blocks(), so sort the
+/// blocks first (see IndexFile::sortBlocks()) to keep bricks of nearby
+/// blocks close in the file. Each is compressed on its own with \c codec so
+/// any block can be loaded with a single read (see readBlockData()). A
+/// brick that doesn't get smaller is
+/// stored uncompressed. On success the data_offset and data_bytes of every
+/// FileBlock are pointed at its brick, the header records the storage and
+/// codec, and the raw file name becomes \c brickPath. Write the index out
+/// again afterwards to keep it with the bricked file.
+///
+/// \param index A row-major index of the raw file at \c rawPath.
+/// \param level Compression level, only used by Zstd.
+/// \param skipEmpty Leave blocks flagged is_empty out of the file. They
+///        read back as all zeros.
+/// \param halo Voxels of the neighbouring blocks to add on every side of
+///        each brick (see readFileBlock()), so a brick can be sampled with
+///        trilinear interpolation right up to its faces without fetching its
+///        neighbours. At most MAX_BRICK_HALO. The width is kept in the
+///        SectionType::Bricks section of the index.
+/// \return True on success. \c index is left untouched on failure.
+bool
+writeBrickedVolume(IndexFile &index,
+                   std::string const &rawPath,
+                   std::string const &brickPath,
+                   Codec codec,
+                   int level = 3,
+                   bool skipEmpty = false,
+                   unsigned halo = 0);
+
+
+/// \brief Width of the halo the bricks of \c index were written with, 0 for
+///        row-major files and bricks without a halo.
+unsigned
+brickHalo(IndexFile const &index);
+
+} // namespace bd
+
+#endif // ! bd_brickedvolume_h
@@ -9,6 +9,8 @@
 #include <thread>
 #include <mutex>
 #include <future>
+#include <algorithm>
+#include <vector>
 
 namespace bd
 {
@@ -29,8 +31,70 @@ public:
   ~BufferedReader();
 
 
+  /// \brief Read through an asynchronous ReadBackend instead of an ifstream.
+  /// Keeps up to \c queueDepth reads in flight, so it is only useful if the
+  /// pool has at least that many buffers.
+  /// \note Must be called before open().
+  /// \param direct Open the file with O_DIRECT and align the buffer pool.
+  void
+  setReadBackend(ReadBackendType type, int queueDepth, bool direct = false);
+
+
+  /// \brief Set the number of buffers the byte budget is split into.
+  /// \note Must be called before open().
+  void
+  setNumBuffers(int n);
+
+
+  /// \brief Read the file with \c k concurrent readers.
+  ///
+  /// With DeliveryOrder::Arrival each reader owns one contiguous, disjoint
+  /// byte range of the file and buffers are handed out as they are filled.
+  /// With DeliveryOrder::File buffers are handed out in file order, and the
+  /// readers take turns reading buffer sized chunks so that they all stay
+  /// close to the consumer (see BufferPool::waitWindow()).
+  ///
+  /// \note Must be called before open(). Use at least k+1 buffers.
+  void
+  setNumReaders(int k, DeliveryOrder order = DeliveryOrder::Arrival);
+
+
+  /// \brief Choose the queues the buffer pool hands buffers off with.
+  ///
+  /// PoolQueue::Spsc is switched to PoolQueue::Mpmc if there is more than
+  /// one reader.
+  /// \note Must be called before open().
+  void
+  setQueueType(PoolQueue q);
+
+
+  /// \brief Let the pool add and park buffers to keep the readers and the
+  ///        consumer busy, using at most \c maxBytes of memory.
+  ///
+  /// The buffers stay the size set by the constructor and setNumBuffers(),
+  /// see BufferPool::setAdaptive().
+  /// \note Must be called before open().
+  void
+  setAdaptiveBuffers(size_t maxBytes, int minBuffers = 2);
+
+
+  /// \brief The pool configuration and stall counters, for logging.
+  /// \note Only valid after open().
+  PoolStats
+  poolStats() const;
+
+
+  /// \brief Set how the buffer pool memory is allocated (huge pages, NUMA node).
+  ///
+  /// If the reader uses O_DIRECT the alignment is raised to DIRECT_IO_ALIGNMENT.
+  /// \note Must be called before open().
+  void
+  setAllocPolicy(PoolAllocPolicy const &policy);
+
+
   /// \brief Open the raw file at path.
-  /// \return True if opened, false otherwise.
+  /// \return True if opened, false if the file could not be opened or the
+  ///         buffer pool could not be allocated.
   bool
   open(std::string const &path);
 
@@ -80,7 +144,18 @@ private:
   int m_numBuffers;
 
   BufferPool<Ty> *m_pool;
-  std::future<long long int> m_future;
+  bool m_useBackend;
+  ReadBackendType m_backendType;
+  int m_queueDepth;
+  bool m_direct;
+  int m_numReaders;
+  DeliveryOrder m_order;
+  PoolQueue m_queueType;
+  PoolAllocPolicy m_allocPolicy;
+  size_t m_adaptiveMaxBytes;  ///< 0 if the pool should not adapt.
+  int m_adaptiveMinBuffers;
+  uint64_t m_fileSizeBytes;
+  std::vector<std::future<long long int>> m_futures;
   std::atomic_bool m_stopReaderThread;
 
 };
@@ -93,7 +168,18 @@ BufferedReader<Ty>::BufferedReader(size_t bufSize)
     , m_bufSizeBytes{ bufSize }
     , m_numBuffers{ 4 }
     , m_pool{ nullptr }
-    , m_future{ }
+    , m_useBackend{ false }
+    , m_backendType{ ReadBackendType::Pread }
+    , m_queueDepth{ 1 }
+    , m_direct{ false }
+    , m_numReaders{ 1 }
+    , m_order{ DeliveryOrder::Arrival }
+    , m_queueType{ PoolQueue::Locked }
+    , m_allocPolicy{ }
+    , m_adaptiveMaxBytes{ 0 }
+    , m_adaptiveMinBuffers{ 2 }
+    , m_fileSizeBytes{ 0 }
+    , m_futures{ }
 {
 }
 
@@ -108,20 +194,107 @@ BufferedReader<Ty>::~BufferedReader()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setReadBackend(ReadBackendType type, int queueDepth, bool direct)
+{
+  m_useBackend = true;
+  m_backendType = type;
+  m_queueDepth = queueDepth;
+  m_direct = direct;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setNumBuffers(int n)
+{
+  m_numBuffers = n > 0 ? n : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setNumReaders(int k, DeliveryOrder order)
+{
+  m_numReaders = k > 0 ? k : 1;
+  m_order = order;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setQueueType(PoolQueue q)
+{
+  m_queueType = q;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setAdaptiveBuffers(size_t maxBytes, int minBuffers)
+{
+  m_adaptiveMaxBytes = maxBytes;
+  m_adaptiveMinBuffers = minBuffers;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+PoolStats
+BufferedReader<Ty>::poolStats() const
+{
+  return m_pool->stats();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferedReader<Ty>::setAllocPolicy(PoolAllocPolicy const &policy)
+{
+  m_allocPolicy = policy;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
 bool
 BufferedReader<Ty>::open(std::string const &path)
 {
   m_path = path;
-  std::ifstream test(m_path);
+  std::ifstream test(m_path, std::ios::binary | std::ios::ate);
   if (! test.is_open()) {
     Err() << "Unable to open file: " + m_path;
     return false;
   }
+  m_fileSizeBytes = static_cast<uint64_t>(test.tellg());
   test.close();
-  m_pool = new BufferPool<Ty>(m_bufSizeBytes, 4);
-  m_pool->allocate();
+  PoolAllocPolicy policy{ m_allocPolicy };
+  if (m_direct && policy.alignment < DIRECT_IO_ALIGNMENT) {
+    policy.alignment = DIRECT_IO_ALIGNMENT;
+  }
+  m_pool = new BufferPool<Ty>(m_bufSizeBytes, m_numBuffers);
+  m_pool->setAllocPolicy(policy);
+  if (m_adaptiveMaxBytes > 0) {
+    m_pool->setAdaptive(m_adaptiveMaxBytes, m_adaptiveMinBuffers);
+  }
+  m_pool->setDeliveryOrder(m_order);
+  m_pool->setNumProducers(m_numReaders);
+  if (m_queueType == PoolQueue::Spsc && m_numReaders > 1) {
+    Warn() << "Single producer queue with " << m_numReaders << " readers, using Mpmc.";
+    m_pool->setQueueType(PoolQueue::Mpmc);
+  } else {
+    m_pool->setQueueType(m_queueType);
+  }
+  if (! m_pool->allocate()) {
+    return false;
+  }
   return true;
 
 }
@@ -133,13 +306,39 @@ void
 BufferedReader<Ty>::start()
 {
   m_stopReaderThread = false;
-  m_future =
-      std::async(std::launch::async,
-                 [&]() -> long long int {
-                   ReaderWorker<Ty> worker(*m_pool);
-                   worker.setPath(m_path);
-                   return worker(std::ref(m_stopReaderThread));
-                 });
+
+  size_t const chunkBytes{ m_pool->bufferSizeElements() * sizeof(Ty) };
+  uint64_t const numChunks{ ( m_fileSizeBytes + chunkBytes - 1 ) / chunkBytes };
+  uint64_t const k{ static_cast<uint64_t>(m_numReaders) };
+  uint64_t const perReader{ ( numChunks + k - 1 ) / k };
+
+  m_futures.clear();
+  for (uint64_t r = 0; r < k; ++r) {
+    uint64_t first{ r };
+    uint64_t stride{ k };
+    uint64_t last{ numChunks };
+    if (m_order == DeliveryOrder::Arrival) {
+      first = std::min(numChunks, r * perReader);
+      stride = 1;
+      last = std::min(numChunks, first + perReader);
+    }
+
+    m_futures.push_back(
+        std::async(std::launch::async,
+                   [this, first, stride, last]() -> long long int {
+                     ReadBackend *backend{ nullptr };
+                     if (m_useBackend) {
+                       backend = ReadBackend::create(m_backendType, m_queueDepth);
+                     }
+                     ReaderWorker<Ty> worker(*m_pool, backend);
+                     worker.setPath(m_path);
+                     worker.setDirect(m_direct);
+                     worker.setChunks(first, stride, last);
+                     long long int bytes{ worker(std::ref(m_stopReaderThread)) };
+                     delete backend;
+                     return bytes;
+                   }));
+  }
 }
 
 
@@ -158,9 +357,18 @@ long long int
 BufferedReader<Ty>::reset()
 {
   m_stopReaderThread = true;
-  m_future.wait();
+  // Readers blocked waiting for empty buffers need to be woken up.
+  m_pool->requestStop();
+
+  long long int total{ 0 };
+  for (auto &f : m_futures) {
+    long long int bytes{ f.get() };
+    total = ( bytes < 0 || total < 0 ) ? -1 : total + bytes;
+  }
+  m_futures.clear();
+
   m_pool->reset();
-  return m_future.get();
+  return total;
 }
 
 
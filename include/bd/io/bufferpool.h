@@ -7,31 +7,124 @@
 
 #include <bd/log/logger.h>
 #include <bd/io/buffer.h>
+#include <bd/io/poolallocator.h>
+#include <bd/datastructure/ringqueue.h>
 
+#include <algorithm>
 #include <vector>
 #include <queue>
+#include <map>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 
 namespace bd
 {
 
+/// \brief The order in which BufferPool hands out full buffers.
+enum class DeliveryOrder
+{
+  Arrival,  ///< In the order producers return them full.
+  File      ///< In increasing Buffer::getIndexOffset() order, without gaps.
+};
+
+
+/// \brief The queues BufferPool uses to pass buffers between threads.
+enum class PoolQueue
+{
+  Locked,  ///< std::queue guarded by a mutex and condition variable.
+  Spsc,    ///< Lock-free ring, exactly one producer and one consumer thread.
+  Mpmc     ///< Lock-free ring, any number of producers and consumers.
+};
+
+
+/// \brief Stall counters and the current configuration of a BufferPool.
+///
+/// A producer stall is time spent in nextEmpty() waiting for an empty
+/// buffer (the consumers are behind), a consumer stall is time spent in
+/// nextFullUntilNone() waiting for a full buffer (the producers are behind).
+struct PoolStats
+{
+  int liveBuffers;             ///< Buffers currently circulating.
+  int maxBuffers;              ///< Buffers that fit in the memory cap.
+  size_t bufferBytes;          ///< Size of each buffer in bytes.
+  uint64_t handOffs;           ///< Full buffers handed to consumers.
+  uint64_t producerStalls;     ///< Times nextEmpty() had to wait.
+  uint64_t producerStallNs;    ///< Total time waited in nextEmpty().
+  uint64_t consumerStalls;     ///< Times nextFullUntilNone() had to wait.
+  uint64_t consumerStallNs;    ///< Total time waited in nextFullUntilNone().
+  uint64_t grows;              ///< Buffers added by the adaptive sizing.
+  uint64_t shrinks;            ///< Buffers parked by the adaptive sizing.
+};
+
+
 /// \brief Manager a pool of buffers to hand out to consumers and producers.
 template<class Ty>
 class BufferPool
 {
 public:
 
-  BufferPool(size_t bufSize, int numBuffers);
+  /// \param bufSize Total size in bytes of all buffers in the pool.
+  /// \param numBuffers Number of buffers to split bufSize into.
+  /// \param alignment If non-zero, each buffer starts on, and is sized to
+  ///        a multiple of, this many bytes (for example DIRECT_IO_ALIGNMENT).
+  BufferPool(size_t bufSize, int numBuffers, size_t alignment = 0);
 
 
   ~BufferPool();
 
 
-  /// \brief Allocate the memory for this BufferPool.
+  /// \brief Set how allocate() gets memory: page size, NUMA node, alignment.
+  /// \note Call before allocate(). Replaces the constructor's alignment.
   void
+  setAllocPolicy(PoolAllocPolicy const &policy);
+
+
+  PoolAllocPolicy const &
+  allocPolicy() const;
+
+
+  /// \brief The memory the buffers live in, valid after allocate().
+  PoolMemory const &
+  memory() const;
+
+
+  /// \brief Let the pool change how many buffers circulate.
+  ///
+  /// Buffers keep the size given to the constructor (bufSize / numBuffers)
+  /// and numBuffers of them start out live, but enough memory for up to
+  /// \c maxBytes worth of buffers is allocated. About every liveBuffers
+  /// hand offs the pool looks at how long each side waited: if both
+  /// producers and consumers stalled, the rates are bursty and another
+  /// buffer is added; if only one side stalled, the other side is the
+  /// bottleneck and extra buffers only cost memory, so one is parked (never
+  /// below \c minBuffers).
+  ///
+  /// \note Call before allocate(). Only PoolQueue::Locked with
+  ///       DeliveryOrder::Arrival adapts, other configurations keep numBuffers.
+  void
+  setAdaptive(size_t maxBytes, int minBuffers = 2);
+
+
+  bool
+  isAdaptive() const;
+
+
+  /// \brief Current configuration and stall counters.
+  PoolStats
+  stats() const;
+
+
+  /// \brief Allocate the memory for this BufferPool.
+  /// \return False, with nothing allocated, if the memory could not be had
+  ///         or a buffer would hold no elements, such as when the alignment
+  ///         is more than each buffer's share of bufSize.
+  bool
   allocate();
 
 
@@ -52,11 +145,76 @@ public:
   nextEmpty();
 
 
+  /// \brief Get an empty buffer from the queue if one is available.
+  /// \return nullptr if there are no empty buffers right now.
+  Buffer<Ty> *
+  tryNextEmpty();
+
+
   /// \brief Return a full buffer to the queue.
   void
   returnFull(Buffer<Ty> *);
 
 
+  /// \brief Choose the queues used for the empty and full buffers.
+  ///
+  /// The lock-free rings only sleep (on a futex) when a queue is empty and
+  /// only wake a sleeping thread if there is one, instead of taking a mutex
+  /// and doing a notify_all on every hand off. PoolQueue::Spsc must only be
+  /// used with one producer and one consumer thread. DeliveryOrder::File
+  /// always uses the locked queues.
+  ///
+  /// \note Call before allocate().
+  void
+  setQueueType(PoolQueue q);
+
+
+  PoolQueue
+  queueType() const;
+
+
+  /// \brief Set the order full buffers are handed out in.
+  /// \note Call before any buffers are handed out.
+  void
+  setDeliveryOrder(DeliveryOrder order);
+
+
+  DeliveryOrder
+  deliveryOrder() const;
+
+
+  /// \brief Set the number of producers filling buffers.
+  /// The pool stops once each of them has called producerDone().
+  /// \note Call before any buffers are handed out.
+  void
+  setNumProducers(int n);
+
+
+  /// \brief Called by a producer when it will not return any more full buffers.
+  /// The last producer to finish requests a stop.
+  void
+  producerDone();
+
+
+  /// \brief Block a producer until the buffer starting at \c elementIndex is
+  /// close enough to the next buffer to be delivered to be filled.
+  ///
+  /// With DeliveryOrder::File the consumer can only take the next buffer in
+  /// file order, so producers that run too far ahead would hold every buffer
+  /// and deadlock. Each producer calls this before nextEmpty() so only buffers
+  /// within numBuffers-1 buffers of the delivery point get filled. Returns
+  /// immediately with DeliveryOrder::Arrival.
+  ///
+  /// \return False if a stop was requested while waiting.
+  bool
+  waitWindow(size_t elementIndex);
+
+
+  /// \brief One past the last element index waitWindow() lets through right now.
+  size_t
+  windowEnd() const;
+
+
   /// \brief Return the maximum number of elements that the buffers may contain.
   /// \note This may not be the same as the number of elements the buffer was filled with.
   size_t
@@ -85,9 +243,61 @@ private:
   std::vector<Buffer<Ty> *> m_allBuffers;
   std::queue<Buffer<Ty> *> m_emptyBuffers;
   std::queue<Buffer<Ty> *> m_fullBuffers;
+  std::map<size_t, Buffer<Ty> *> m_orderedFullBuffers; ///< Full buffers by index offset.
+
+  /// \brief Called with m_emptyBuffersLock held on each returned empty buffer.
+  /// \return True if \c buf was parked and must not be queued.
+  bool
+  adapt(Buffer<Ty> *buf);
+
+  static uint64_t
+  nowNs();
+
+  bool m_adaptive;
+  int m_minBufs;
+  int m_maxBufs;
+  int m_liveBufs;
+  std::vector<Buffer<Ty> *> m_parkedBuffers;
+  int m_returnsSinceAdapt;
+  uint64_t m_lastAdaptNs;
+  uint64_t m_lastProducerStallNs;
+  uint64_t m_lastConsumerStallNs;
+
+  std::atomic<uint64_t> m_handOffs;
+  std::atomic<uint64_t> m_producerStalls;
+  std::atomic<uint64_t> m_producerStallNs;
+  std::atomic<uint64_t> m_consumerStalls;
+  std::atomic<uint64_t> m_consumerStallNs;
+  std::atomic<uint64_t> m_grows;
+  std::atomic<uint64_t> m_shrinks;
+
+  /// \brief True if the lock-free rings are in use.
+  bool
+  usesRings() const;
+
+  bool
+  ringPop(bool full, Buffer<Ty> *&buf);
+
+  void
+  ringPush(bool full, Buffer<Ty> *buf);
+
+  PoolQueue m_queueType;
+  SpscRing<Buffer<Ty> *> *m_emptySpsc;
+  SpscRing<Buffer<Ty> *> *m_fullSpsc;
+  MpmcRing<Buffer<Ty> *> *m_emptyMpmc;
+  MpmcRing<Buffer<Ty> *> *m_fullMpmc;
+  WaitEvent m_emptyEvent;
+  WaitEvent m_fullEvent;
+
+  DeliveryOrder m_order;
+  std::atomic<size_t> m_nextIndex; ///< Next index offset to deliver in File order.
+  int m_nProducers;
+  std::atomic_int m_activeProducers;
 
   int m_nBufs;
   size_t m_szBytesTotal;
+  PoolAllocPolicy m_policy;
+  PoolMemory m_memory;
 
   std::atomic_bool m_stopRequested;
 
@@ -102,12 +312,40 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
-BufferPool<Ty>::BufferPool(size_t bufSize, int nbuf)
+BufferPool<Ty>::BufferPool(size_t bufSize, int nbuf, size_t alignment)
     : m_mem{ nullptr }
+    , m_adaptive{ false }
+    , m_minBufs{ nbuf }
+    , m_maxBufs{ nbuf }
+    , m_liveBufs{ nbuf }
+    , m_parkedBuffers{ }
+    , m_returnsSinceAdapt{ 0 }
+    , m_lastAdaptNs{ 0 }
+    , m_lastProducerStallNs{ 0 }
+    , m_lastConsumerStallNs{ 0 }
+    , m_handOffs{ 0 }
+    , m_producerStalls{ 0 }
+    , m_producerStallNs{ 0 }
+    , m_consumerStalls{ 0 }
+    , m_consumerStallNs{ 0 }
+    , m_grows{ 0 }
+    , m_shrinks{ 0 }
+    , m_queueType{ PoolQueue::Locked }
+    , m_emptySpsc{ nullptr }
+    , m_fullSpsc{ nullptr }
+    , m_emptyMpmc{ nullptr }
+    , m_fullMpmc{ nullptr }
+    , m_order{ DeliveryOrder::Arrival }
+    , m_nextIndex{ 0 }
+    , m_nProducers{ 1 }
+    , m_activeProducers{ 1 }
     , m_nBufs{ nbuf }
     , m_szBytesTotal{ bufSize }
+    , m_policy{ }
+    , m_memory{ }
     , m_stopRequested{ false }
 {
+  m_policy.alignment = alignment;
 }
 
 
@@ -119,33 +357,94 @@ BufferPool<Ty>::~BufferPool()
     delete buf;
   }
 
-  if (m_mem) {
-    delete[] m_mem;
-  }
+  delete m_emptySpsc;
+  delete m_fullSpsc;
+  delete m_emptyMpmc;
+  delete m_fullMpmc;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
 void
+BufferPool<Ty>::setAllocPolicy(PoolAllocPolicy const &policy)
+{
+  m_policy = policy;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+PoolAllocPolicy const &
+BufferPool<Ty>::allocPolicy() const
+{
+  return m_policy;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+PoolMemory const &
+BufferPool<Ty>::memory() const
+{
+  return m_memory;
+}
+
+
+template<class Ty>
+bool
 BufferPool<Ty>::allocate()
 {
   size_t buffer_size_elems{ bufferSizeElements() };
+  if (buffer_size_elems == 0) {
+    Err() << "Buffers of " << m_szBytesTotal / m_nBufs << " bytes with alignment "
+          << m_policy.alignment << " hold no elements, not allocating the buffer pool.";
+    return false;
+  }
 
-  m_mem = new Ty[buffer_size_elems * m_nBufs];
-  Info() << "Allocated " << buffer_size_elems * m_nBufs << " elements ( " <<
-         m_szBytesTotal << " bytes).";
+  if (m_adaptive && (usesRings() || m_order == DeliveryOrder::File)) {
+    Warn() << "Adaptive buffer pool needs locked queues and arrival order, "
+              "keeping " << m_nBufs << " buffers.";
+    m_adaptive = false;
+    m_maxBufs = m_nBufs;
+  }
 
-  for (int i = 0; i < m_nBufs; ++i) {
+  if (! m_memory.allocate(buffer_size_elems * m_maxBufs * sizeof(Ty), m_policy)) {
+    Err() << "Could not allocate buffer pool memory.";
+    return false;
+  }
+  m_mem = static_cast<Ty *>(m_memory.ptr());
+  Info() << "Allocated " << buffer_size_elems * m_maxBufs << " elements ( " <<
+         buffer_size_elems * m_maxBufs * sizeof(Ty) << " bytes).";
+
+  if (m_queueType == PoolQueue::Spsc) {
+    m_emptySpsc = new SpscRing<Buffer<Ty> *>(m_nBufs);
+    m_fullSpsc = new SpscRing<Buffer<Ty> *>(m_nBufs);
+  } else if (m_queueType == PoolQueue::Mpmc) {
+    m_emptyMpmc = new MpmcRing<Buffer<Ty> *>(m_nBufs);
+    m_fullMpmc = new MpmcRing<Buffer<Ty> *>(m_nBufs);
+  }
+
+  for (int i = 0; i < m_maxBufs; ++i) {
     size_t offset{ i * buffer_size_elems };
     Ty *start{ m_mem + offset };
     Buffer<Ty> *buf{ new Buffer<Ty>{ start, buffer_size_elems }};
     m_allBuffers.push_back(buf);
-    m_emptyBuffers.push(buf);
+    if (i >= m_nBufs) {
+      m_parkedBuffers.push_back(buf);
+    } else if (usesRings()) {
+      ringPush(false, buf);
+    } else {
+      m_emptyBuffers.push(buf);
+    }
   }
+  m_liveBufs = m_nBufs;
+  m_lastAdaptNs = nowNs();
 
   Info() << "Generated " << m_allBuffers.size() << " buffers of size " <<
          buffer_size_elems;
 
+  return true;
 }
 
 
@@ -154,10 +453,75 @@ template<class Ty>
 Buffer<Ty> *
 BufferPool<Ty>::nextFullUntilNone()
 {
+  if (usesRings()) {
+    Buffer<Ty> *buf{ nullptr };
+    if (ringPop(true, buf)) {
+      ++m_handOffs;
+      return buf;
+    }
+
+    // keep going until no full buffers are left, and then quit.
+    uint64_t const start{ nowNs() };
+    bool got{ m_queueType == PoolQueue::Spsc
+              ? popOrWait(*m_fullSpsc, m_fullEvent, buf, [this]() { return m_stopRequested.load(); })
+              : popOrWait(*m_fullMpmc, m_fullEvent, buf, [this]() { return m_stopRequested.load(); }) };
+    ++m_consumerStalls;
+    m_consumerStallNs += nowNs() - start;
+    if (! got) {
+      return nullptr;
+    }
+    ++m_handOffs;
+    return buf;
+  }
+
+  if (m_order == DeliveryOrder::File) {
+    Buffer<Ty> *buf{ nullptr };
+    {
+      std::lock_guard<std::mutex> lck(m_fullBuffersLock);
+      // Wait for the next buffer in file order. Once stopped, hand out
+      // whatever is left in order even if there is a gap.
+      uint64_t start{ 0 };
+      while (!m_stopRequested &&
+             (m_orderedFullBuffers.empty() ||
+              m_orderedFullBuffers.begin()->first != m_nextIndex)) {
+        if (start == 0) {
+          start = nowNs();
+          ++m_consumerStalls;
+        }
+        m_fullBuffersAvailable.wait(m_fullBuffersLock);
+      }
+      if (start != 0) {
+        m_consumerStallNs += nowNs() - start;
+      }
+
+      if (m_orderedFullBuffers.empty()) {
+        return nullptr;
+      }
+
+      buf = m_orderedFullBuffers.begin()->second;
+      m_orderedFullBuffers.erase(m_orderedFullBuffers.begin());
+      ++m_handOffs;
+      m_nextIndex = buf->getIndexOffset() + buf->getNumElements();
+    }
+
+    // The delivery window moved, wake producers in waitWindow().
+    std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+    m_emptyBuffersAvailable.notify_all();
+    return buf;
+  }
+
   std::lock_guard<std::mutex> lck(m_fullBuffersLock);
+  uint64_t start{ 0 };
   while (m_fullBuffers.size() == 0 && !m_stopRequested) {
+    if (start == 0) {
+      start = nowNs();
+      ++m_consumerStalls;
+    }
     m_fullBuffersAvailable.wait(m_fullBuffersLock);
   }
+  if (start != 0) {
+    m_consumerStallNs += nowNs() - start;
+  }
 
   // keep going until no full buffers are left, and then
   // quit.
@@ -167,6 +531,7 @@ BufferPool<Ty>::nextFullUntilNone()
 
   Buffer<Ty> *buf = m_fullBuffers.front();
   m_fullBuffers.pop();
+  ++m_handOffs;
 
   return buf;
 }
@@ -177,7 +542,16 @@ template<class Ty>
 void
 BufferPool<Ty>::returnEmpty(Buffer<Ty> *buf)
 {
+  if (usesRings()) {
+    ringPush(false, buf);
+    m_emptyEvent.notify();
+    return;
+  }
+
   std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+  if (m_adaptive && adapt(buf)) {
+    return;
+  }
   m_emptyBuffers.push(buf);
   m_emptyBuffersAvailable.notify_all();
 }
@@ -188,11 +562,37 @@ template<class Ty>
 Buffer<Ty> *
 BufferPool<Ty>::nextEmpty()
 {
+  if (usesRings()) {
+    Buffer<Ty> *buf{ nullptr };
+    if (m_stopRequested) {
+      return nullptr;
+    }
+    if (ringPop(false, buf)) {
+      return buf;
+    }
+
+    uint64_t const start{ nowNs() };
+    bool got{ m_queueType == PoolQueue::Spsc
+              ? popOrWait(*m_emptySpsc, m_emptyEvent, buf, [this]() { return m_stopRequested.load(); })
+              : popOrWait(*m_emptyMpmc, m_emptyEvent, buf, [this]() { return m_stopRequested.load(); }) };
+    ++m_producerStalls;
+    m_producerStallNs += nowNs() - start;
+    return got ? buf : nullptr;
+  }
+
   std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+  uint64_t start{ 0 };
   while (m_emptyBuffers.size() == 0 && !m_stopRequested) {
     // all the buffers are in the full queue.
+    if (start == 0) {
+      start = nowNs();
+      ++m_producerStalls;
+    }
     m_emptyBuffersAvailable.wait(m_emptyBuffersLock);
   }
+  if (start != 0) {
+    m_producerStallNs += nowNs() - start;
+  }
   if (m_stopRequested) {
     return nullptr;
   }
@@ -204,23 +604,285 @@ BufferPool<Ty>::nextEmpty()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+BufferPool<Ty>::tryNextEmpty()
+{
+  if (usesRings()) {
+    Buffer<Ty> *buf{ nullptr };
+    if (m_stopRequested || ! ringPop(false, buf)) {
+      return nullptr;
+    }
+    return buf;
+  }
+
+  std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+  if (m_emptyBuffers.size() == 0 || m_stopRequested) {
+    return nullptr;
+  }
+
+  Buffer<Ty> *buf{ m_emptyBuffers.front() };
+  m_emptyBuffers.pop();
+
+  return buf;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
 void
 BufferPool<Ty>::returnFull(Buffer<Ty> *buf)
 {
+  if (usesRings()) {
+    ringPush(true, buf);
+    m_fullEvent.notify();
+    return;
+  }
+
   std::lock_guard<std::mutex> lck(m_fullBuffersLock);
-  m_fullBuffers.push(buf);
+  if (m_order == DeliveryOrder::File) {
+    m_orderedFullBuffers[buf->getIndexOffset()] = buf;
+  } else {
+    m_fullBuffers.push(buf);
+  }
   m_fullBuffersAvailable.notify_all();
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::setAdaptive(size_t maxBytes, int minBuffers)
+{
+  size_t const bufBytes{ bufferSizeElements() * sizeof(Ty) };
+  int const fit{ bufBytes > 0 ? static_cast<int>(maxBytes / bufBytes) : 0 };
+
+  m_adaptive = true;
+  m_minBufs = std::max(1, std::min(minBuffers, m_nBufs));
+  m_maxBufs = std::max(m_nBufs, fit);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BufferPool<Ty>::isAdaptive() const
+{
+  return m_adaptive;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+PoolStats
+BufferPool<Ty>::stats() const
+{
+  PoolStats st;
+  st.liveBuffers = m_liveBufs;
+  st.maxBuffers = m_maxBufs;
+  st.bufferBytes = bufferSizeElements() * sizeof(Ty);
+  st.handOffs = m_handOffs;
+  st.producerStalls = m_producerStalls;
+  st.producerStallNs = m_producerStallNs;
+  st.consumerStalls = m_consumerStalls;
+  st.consumerStallNs = m_consumerStallNs;
+  st.grows = m_grows;
+  st.shrinks = m_shrinks;
+  return st;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BufferPool<Ty>::adapt(Buffer<Ty> *buf)
+{
+  if (++m_returnsSinceAdapt < m_liveBufs) {
+    return false;
+  }
+  m_returnsSinceAdapt = 0;
+
+  uint64_t const now{ nowNs() };
+  uint64_t const pStall{ m_producerStallNs - m_lastProducerStallNs };
+  uint64_t const cStall{ m_consumerStallNs - m_lastConsumerStallNs };
+  uint64_t const window{ now - m_lastAdaptNs };
+  m_lastAdaptNs = now;
+  m_lastProducerStallNs += pStall;
+  m_lastConsumerStallNs += cStall;
+
+  // A side stalled if it waited for more than 1/20th of the window.
+  bool const producersStalled{ pStall * 20 > window };
+  bool const consumersStalled{ cStall * 20 > window };
+
+  if (producersStalled && consumersStalled) {
+    if (! m_parkedBuffers.empty()) {
+      m_emptyBuffers.push(m_parkedBuffers.back());
+      m_parkedBuffers.pop_back();
+      ++m_liveBufs;
+      ++m_grows;
+      Dbg() << "Buffer pool grew to " << m_liveBufs << " buffers.";
+    }
+  } else if (producersStalled != consumersStalled) {
+    if (m_liveBufs > m_minBufs) {
+      buf->setNumElements(bufferSizeElements());
+      buf->setIndexOffset(0);
+      m_parkedBuffers.push_back(buf);
+      --m_liveBufs;
+      ++m_shrinks;
+      Dbg() << "Buffer pool shrank to " << m_liveBufs << " buffers.";
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+BufferPool<Ty>::nowNs()
+{
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::setQueueType(PoolQueue q)
+{
+  m_queueType = q;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+PoolQueue
+BufferPool<Ty>::queueType() const
+{
+  return m_queueType;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BufferPool<Ty>::usesRings() const
+{
+  return m_queueType != PoolQueue::Locked && m_order == DeliveryOrder::Arrival;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BufferPool<Ty>::ringPop(bool full, Buffer<Ty> *&buf)
+{
+  if (m_queueType == PoolQueue::Spsc) {
+    return ( full ? m_fullSpsc : m_emptySpsc )->tryPop(buf);
+  }
+  return ( full ? m_fullMpmc : m_emptyMpmc )->tryPop(buf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::ringPush(bool full, Buffer<Ty> *buf)
+{
+  // The rings hold every buffer in the pool, so a push can not fail.
+  if (m_queueType == PoolQueue::Spsc) {
+    ( full ? m_fullSpsc : m_emptySpsc )->tryPush(buf);
+  } else {
+    ( full ? m_fullMpmc : m_emptyMpmc )->tryPush(buf);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::setDeliveryOrder(DeliveryOrder order)
+{
+  m_order = order;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+DeliveryOrder
+BufferPool<Ty>::deliveryOrder() const
+{
+  return m_order;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::setNumProducers(int n)
+{
+  m_nProducers = n > 0 ? n : 1;
+  m_activeProducers = m_nProducers;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+BufferPool<Ty>::producerDone()
+{
+  if (--m_activeProducers <= 0) {
+    requestStop();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+BufferPool<Ty>::waitWindow(size_t elementIndex)
+{
+  if (m_order != DeliveryOrder::File) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lck(m_emptyBuffersLock);
+  while (elementIndex >= windowEnd() && !m_stopRequested) {
+    m_emptyBuffersAvailable.wait(m_emptyBuffersLock);
+  }
+
+  return !m_stopRequested;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+BufferPool<Ty>::windowEnd() const
+{
+  if (m_order != DeliveryOrder::File) {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  size_t const window{ ( m_nBufs > 1 ? m_nBufs - 1 : 1 ) * bufferSizeElements() };
+  return m_nextIndex + window;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 template<class Ty>
 size_t
 BufferPool<Ty>::bufferSizeElements() const
 {
-  return ( m_szBytesTotal / m_nBufs ) / sizeof(Ty);
+  size_t bytes{ m_szBytesTotal / m_nBufs };
+  if (m_policy.alignment > 0) {
+    bytes -= bytes % m_policy.alignment;
+  }
+  return bytes / sizeof(Ty);
 }
 
 
@@ -245,12 +907,17 @@ BufferPool<Ty>::kickThreads()
 {
   m_emptyBuffersAvailable.notify_all();
   m_fullBuffersAvailable.notify_all();
+  m_emptyEvent.notifyAll();
+  m_fullEvent.notifyAll();
 }
 
 template <class Ty>
 void BufferPool<Ty>::requestStop()
 {
   m_stopRequested = true;
+  // Take the locks so waiters are either already waiting or will see the stop.
+  { std::lock_guard<std::mutex> lck(m_emptyBuffersLock); }
+  { std::lock_guard<std::mutex> lck(m_fullBuffersLock); }
   kickThreads();
 }
 
@@ -259,16 +926,40 @@ template<class Ty>
 void
 BufferPool<Ty>::reset()
 {
-  // put the buffers into the full buffers queue
+  // put the buffers into the empty buffers queue
+  while (!m_emptyBuffers.empty()) {
+    m_emptyBuffers.pop();
+  }
+  if (usesRings()) {
+    Buffer<Ty> *b{ nullptr };
+    while (ringPop(false, b)) { }
+    while (ringPop(true, b)) { }
+  }
+  m_parkedBuffers.clear();
+  m_liveBufs = m_nBufs;
+  m_returnsSinceAdapt = 0;
+  m_lastAdaptNs = nowNs();
+  m_lastProducerStallNs = m_producerStallNs;
+  m_lastConsumerStallNs = m_consumerStallNs;
+  int i{ 0 };
   for (Buffer<Ty> *b : m_allBuffers) {
     b->setNumElements(bufferSizeElements());
     b->setIndexOffset(0);
-    m_emptyBuffers.push(b);
+    if (i++ >= m_nBufs) {
+      m_parkedBuffers.push_back(b);
+    } else if (usesRings()) {
+      ringPush(false, b);
+    } else {
+      m_emptyBuffers.push(b);
+    }
   }
   while (!m_fullBuffers.empty()) {
     m_fullBuffers.pop();
   }
+  m_orderedFullBuffers.clear();
 
+  m_nextIndex = 0;
+  m_activeProducers = m_nProducers;
   m_stopRequested = false;
 }
 
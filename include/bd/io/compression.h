@@ -0,0 +1,141 @@
+#ifndef bd_compression_h
+#define bd_compression_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Compression codecs for chunked compressed volumes.
+enum class Codec : uint16_t
+{
+  None = 0,  ///< Chunks are stored uncompressed.
+  Lz4 = 1,   ///< LZ4 block format (needs BD_HAVE_LZ4).
+  Zstd = 2   ///< Zstandard frames (needs BD_HAVE_ZSTD).
+};
+
+
+/// \brief True if this build can compress and decompress with \c c.
+bool
+codecAvailable(Codec c);
+
+
+std::string
+to_string(Codec c);
+
+
+/// \brief Largest compressed size of \c rawBytes with codec \c c.
+size_t
+compressBound(Codec c, size_t rawBytes);
+
+
+/// \brief Compress \c n bytes at \c src into \c dst.
+/// \param level Compression level, only used by Zstd.
+/// \return The compressed size, or -1 on failure.
+long long
+compressChunk(Codec c, char const *src, size_t n, char *dst, size_t dstCap, int level = 3);
+
+
+/// \brief Decompress \c n bytes at \c src into \c dst.
+/// \return The decompressed size, or -1 on failure.
+long long
+decompressChunk(Codec c, char const *src, size_t n, char *dst, size_t dstCap);
+
+
+/// \brief Header at the start of a chunked compressed volume.
+///
+/// The raw file is cut into chunks of chunk_bytes (the last one may be
+/// shorter) that are compressed independently, so they can be decompressed
+/// on several threads and in any order. A table of CompressedChunk entries,
+/// one per chunk, is at table_offset.
+struct CompressedHeader
+{
+  uint32_t magic;        ///< COMPRESSED_MAGIC.
+  uint16_t version;      ///< COMPRESSED_VERSION.
+  uint16_t codec;        ///< A Codec.
+  uint64_t chunk_bytes;  ///< Uncompressed size of every chunk but the last.
+  uint64_t raw_bytes;    ///< Size of the uncompressed volume.
+  uint64_t num_chunks;
+  uint64_t table_offset; ///< Byte offset of the chunk table.
+};
+
+
+/// \brief Where a chunk is in a chunked compressed volume.
+struct CompressedChunk
+{
+  uint64_t offset;       ///< Byte offset of the compressed data.
+  uint64_t bytes;        ///< Compressed size.
+  uint64_t raw_offset;   ///< Byte offset of the chunk in the uncompressed volume.
+  uint64_t raw_bytes;    ///< Uncompressed size.
+};
+
+
+uint32_t const COMPRESSED_MAGIC{ 0x435a4442 };  // "BDZC"
+uint16_t const COMPRESSED_VERSION{ 1 };
+
+
+/// \brief Compress the raw file at \c rawPath into a chunked compressed volume.
+/// \param chunkBytes Uncompressed size of each chunk. Use a multiple of the
+///        voxel size so no voxel straddles two chunks.
+/// \return True on success.
+bool
+writeCompressedFile(std::string const &rawPath, std::string const &outPath,
+                    Codec codec, size_t chunkBytes, int level = 3);
+
+
+/// \brief Read only access to a chunked compressed volume.
+class CompressedFile
+{
+public:
+  CompressedFile();
+
+
+  ~CompressedFile();
+
+
+  CompressedFile(CompressedFile const &) = delete;
+  CompressedFile &operator=(CompressedFile const &) = delete;
+
+
+  /// \brief Open and check the header and chunk table.
+  bool
+  open(std::string const &path);
+
+
+  void
+  close();
+
+
+  CompressedHeader const &
+  header() const;
+
+
+  Codec
+  codec() const;
+
+
+  std::vector<CompressedChunk> const &
+  chunks() const;
+
+
+  /// \brief Read and decompress chunk \c i into \c dst.
+  /// \param scratch Holds the compressed bytes, grown as needed.
+  /// \note Only uses pread, so threads may share one CompressedFile.
+  /// \return The decompressed size, or -1 on failure.
+  long long
+  readChunk(size_t i, char *dst, size_t dstCap, std::vector<char> &scratch) const;
+
+
+private:
+  int m_fd;
+  CompressedHeader m_header;
+  std::vector<CompressedChunk> m_chunks;
+
+}; // class CompressedFile
+
+} // namespace bd
+
+#endif // ! bd_compression_h
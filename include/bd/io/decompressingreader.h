@@ -0,0 +1,336 @@
+#ifndef bd_decompressingreader_h
+#define bd_decompressingreader_h
+
+#include <bd/io/buffer.h>
+#include <bd/io/bufferpool.h>
+#include <bd/io/compression.h>
+#include <bd/log/logger.h>
+
+#include <atomic>
+#include <future>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief Streams a chunked compressed volume (see writeCompressedFile())
+///        into pool buffers, decompressing on several worker threads.
+///
+/// DecompressingReader has the same consumer side interface as
+/// BufferedReader. Each buffer holds exactly one chunk, and its index
+/// offset is the element index of the chunk in the uncompressed volume, so
+/// consumers can't tell it from reading the raw file. Workers take chunks
+/// in file order and read plus decompress them independently, so the
+/// decompression cost is spread across cores while the reads stay
+/// sequential enough for the disk.
+///
+/// Template parameter \c Ty is the data type contained in the raw volume.
+template<class Ty>
+class DecompressingReader
+{
+
+public:
+  /// \param numWorkers Number of threads reading and decompressing chunks.
+  DecompressingReader(int numWorkers = 4);
+
+
+  ~DecompressingReader();
+
+
+  /// \brief Set the number of chunk sized buffers, defaults to twice the workers.
+  /// \note Must be called before open().
+  void
+  setNumBuffers(int n);
+
+
+  /// \brief Hand out chunks as soon as they are decompressed, or in file order.
+  /// \note Must be called before open().
+  void
+  setDeliveryOrder(DeliveryOrder order);
+
+
+  /// \brief Open the compressed volume at path.
+  /// \return True if opened, false if the file could not be opened or the
+  ///         buffer pool could not be allocated.
+  bool
+  open(std::string const &path);
+
+
+  /// \brief Start the worker threads.
+  void
+  start();
+
+
+  /// \brief Stop reading as soon as possible.
+  void
+  stop();
+
+
+  /// \brief Stop reading and wait for the worker threads to exit.
+  /// \return The number of uncompressed bytes produced, or -1 on error.
+  long long int
+  reset();
+
+
+  /// \brief Grab the next decompressed chunk as soon as it is ready.
+  /// \return nullptr once every chunk has been handed out.
+  Buffer<Ty> *
+  waitNextFullUntilNone();
+
+
+  /// \brief Return a buffer to the empty pool to be filled again.
+  void
+  waitReturnEmpty(Buffer<Ty> *buf);
+
+
+  /// \brief Get the number of elements in a single buffer (one chunk).
+  size_t
+  singleBufferElements() const;
+
+
+  /// \brief Size of the uncompressed volume in bytes.
+  uint64_t
+  rawFileSize() const;
+
+
+private:
+  long long int
+  work();
+
+
+  CompressedFile m_file;
+  std::string m_path;
+  int m_numWorkers;
+  int m_numBuffers;
+  DeliveryOrder m_order;
+
+  BufferPool<Ty> *m_pool;
+  std::atomic<size_t> m_nextChunk;
+  std::vector<std::future<long long int>> m_futures;
+  std::atomic_bool m_stopReaderThread;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+DecompressingReader<Ty>::DecompressingReader(int numWorkers)
+    : m_file{ }
+    , m_path{ }
+    , m_numWorkers{ numWorkers > 0 ? numWorkers : 1 }
+    , m_numBuffers{ 2 * m_numWorkers }
+    , m_order{ DeliveryOrder::Arrival }
+    , m_pool{ nullptr }
+    , m_nextChunk{ 0 }
+    , m_futures{ }
+    , m_stopReaderThread{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+DecompressingReader<Ty>::~DecompressingReader()
+{
+  if (! m_futures.empty()) {
+    reset();
+  }
+
+  if (m_pool) {
+    delete m_pool;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+DecompressingReader<Ty>::setNumBuffers(int n)
+{
+  m_numBuffers = n > 0 ? n : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+DecompressingReader<Ty>::setDeliveryOrder(DeliveryOrder order)
+{
+  m_order = order;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+DecompressingReader<Ty>::open(std::string const &path)
+{
+  m_path = path;
+  if (! m_file.open(m_path)) {
+    return false;
+  }
+
+  size_t const chunkBytes{ m_file.header().chunk_bytes };
+  if (chunkBytes == 0 ||
+      chunkBytes > std::numeric_limits<size_t>::max() / static_cast<size_t>(m_numBuffers)) {
+    Err() << "Chunk size " << chunkBytes << " of " << m_path
+          << " can't be used for " << m_numBuffers << " buffers.";
+    return false;
+  }
+  if (chunkBytes % sizeof(Ty) != 0) {
+    Err() << "Chunk size " << chunkBytes << " of " << m_path
+          << " is not a multiple of the element size " << sizeof(Ty);
+    return false;
+  }
+
+  m_pool = new BufferPool<Ty>(chunkBytes * m_numBuffers, m_numBuffers);
+  m_pool->setDeliveryOrder(m_order);
+  m_pool->setNumProducers(m_numWorkers);
+  if (! m_pool->allocate()) {
+    return false;
+  }
+
+  Info() << "Opened " << m_path << ": " << m_file.header().num_chunks << " "
+         << to_string(m_file.codec()) << " chunks of " << chunkBytes << " bytes.";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+DecompressingReader<Ty>::start()
+{
+  m_stopReaderThread = false;
+  m_nextChunk = 0;
+  for (int i{ 0 }; i < m_numWorkers; ++i) {
+    m_futures.push_back(std::async(std::launch::async, [this]() { return work(); }));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+DecompressingReader<Ty>::stop()
+{
+  m_stopReaderThread = true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+long long int
+DecompressingReader<Ty>::reset()
+{
+  m_stopReaderThread = true;
+  m_pool->requestStop();
+
+  long long int total{ 0 };
+  for (auto &f : m_futures) {
+    long long int bytes{ f.get() };
+    if (bytes < 0 || total < 0) {
+      total = -1;
+    } else {
+      total += bytes;
+    }
+  }
+  m_futures.clear();
+
+  m_pool->reset();
+  m_nextChunk = 0;
+  return total;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+DecompressingReader<Ty>::waitNextFullUntilNone()
+{
+  return m_pool->nextFullUntilNone();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+DecompressingReader<Ty>::waitReturnEmpty(Buffer<Ty> *buf)
+{
+  m_pool->returnEmpty(buf);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+DecompressingReader<Ty>::singleBufferElements() const
+{
+  return m_pool->bufferSizeElements();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+uint64_t
+DecompressingReader<Ty>::rawFileSize() const
+{
+  return m_file.header().raw_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+long long int
+DecompressingReader<Ty>::work()
+{
+  std::vector<CompressedChunk> const &chunks{ m_file.chunks() };
+  std::vector<char> scratch;
+  long long int total{ 0 };
+
+  while (! m_stopReaderThread) {
+    size_t const i{ m_nextChunk++ };
+    if (i >= chunks.size()) {
+      break;
+    }
+
+    size_t const indexOffset{ chunks[i].raw_offset / sizeof(Ty) };
+    if (! m_pool->waitWindow(indexOffset)) {
+      break;
+    }
+    Buffer<Ty> *buf{ m_pool->nextEmpty() };
+    if (buf == nullptr) {
+      break;
+    }
+
+    long long int bytes{
+        m_file.readChunk(i, reinterpret_cast<char *>(buf->getPtr()),
+                         buf->getMaxNumElements() * sizeof(Ty), scratch) };
+    if (bytes < 0) {
+      Err() << "Could not decompress chunk " << i << " of " << m_path;
+      m_pool->returnEmpty(buf);
+      // A missing chunk would stall the other workers in file order.
+      m_stopReaderThread = true;
+      m_pool->requestStop();
+      total = -1;
+      break;
+    }
+
+    buf->setIndexOffset(indexOffset);
+    buf->setNumElements(static_cast<size_t>(bytes) / sizeof(Ty));
+    total += bytes;
+
+    m_pool->returnFull(buf);
+  }
+
+  m_pool->producerDone();
+  return total;
+}
+
+
+} // namespace bd
+
+#endif // ! bd_decompressingreader_h
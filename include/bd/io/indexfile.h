@@ -3,13 +3,18 @@
 
 #include <bd/io/fileblock.h>
 #include <bd/io/indexfileheader.h>
+#include <bd/io/indexrecord.h>
+#include <bd/io/indexsection.h>
+#include <bd/util/span.h>
 #include <bd/volume/volume.h>
 
 
 #include <iostream>
 #include <cstdint>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 
@@ -20,14 +25,48 @@ namespace
 ///< Magic number for the file (ascii 'SV')
 uint16_t const MAGIC{ 7376 };
 /// \brief The version of the IndexFile
-uint16_t const VERSION{ 13 };
-/// \brief Length of the IndexFileHeader in bytes.
-uint32_t const HEAD_LEN{ sizeof(IndexFileHeader) };
+uint16_t const VERSION{ 15 };
+/// \brief The oldest version that can still be read. It and the versions
+///        after it up to VERSION were written flat, without a section directory.
+uint16_t const LEGACY_VERSION{ 13 };
+/// \brief Length of the IndexFileHeader record in bytes.
+uint32_t const HEAD_LEN{ HEADER_RECORD_BYTES };
 } // namespace
 
 
+/// \brief Order of the FileBlocks in an IndexFile, and so of the bricks
+///        written from it.
+enum class BlockOrder : uint32_t
+{
+  Linear = 0,  ///< x-fastest, by to1D() of the block's ijk index.
+  Morton = 1,  ///< Along the Morton (Z-order) curve, see toMorton().
+  Hilbert = 2  ///< Along the Hilbert curve, see toHilbert().
+};
+
+
+std::string
+to_string(BlockOrder o);
+
+
 /// \brief Generate an index file from the provided FileBlockCollection. The
 ///        IndexFile can be written to disk in either ASCII or binary format.
+///
+/// The binary format is an IndexPreamble, a directory of SectionEntry and
+/// then the sections, each 64 byte aligned and checksummed: the header, the
+/// volume, the FileBlock table and any extra sections (see setSection()).
+/// The preamble, directory, header, volume and FileBlock records are
+/// written field by field as fixed width little-endian values (see
+/// indexrecord.h), so they read the same on any host. A mapped FileBlock
+/// table is viewed in place only on hosts where a FileBlock already is its
+/// record, others decode a copy. Readers skip section types they don't know
+/// and keep them, so they survive a read and write. The block table records its record size,
+/// so FileBlocks that grow new trailing fields can still be read by older
+/// code, and older tables by newer code.
+///
+/// Flat files of earlier versions (header, volume, then blocks), back to
+/// LEGACY_VERSION, can still be read and are written back in the sectioned
+/// format. Version 13 headers have no storage or codec, those files are
+/// row-major and uncompressed.
 class IndexFile
 {
 public:
@@ -38,6 +77,23 @@ public:
   fromBinaryIndexFile(std::string const &path, bool &ok);
 
 
+  /// \brief Create IndexFile from an existing binary index file without
+  ///        copying the FileBlock table.
+  ///
+  /// The file is mapped read-only and checked once (magic, version, the
+  /// section directory and its checksum, the header and volume checksums,
+  /// and the size and alignment of the block table). blocks() then views
+  /// the table in place, so opening costs the same for any number of
+  /// blocks and processes opening the same index share its pages. The
+  /// checksums of the block table and extra sections are not checked, since
+  /// that would touch every page. If the file can't be mapped, or is in the
+  /// flat format, it is read like fromBinaryIndexFile() instead.
+  ///
+  /// \returns A unique_ptr to the IndexFile created or nullptr on failure.
+  static std::unique_ptr<IndexFile>
+  mapBinaryIndexFile(std::string const &path, bool &ok);
+
+
   /// \brief Create an empty IndexFile with empty header.
   IndexFile();
 
@@ -45,14 +101,18 @@ public:
   ~IndexFile();
 
 
+  IndexFile(IndexFile const &) = delete;
+  IndexFile &operator=(IndexFile const &) = delete;
+
+
   bd::FileBlock const &
   operator[](size_t idx) const {
-    return m_fileBlocks[idx];
+    return blocks()[idx];
   }
 
   bd::FileBlock &
   operator[](size_t idx)  {
-    return m_fileBlocks[idx];
+    return getFileBlocks()[idx];
   }
 
   /// \brief Write binary index file to ostream \c os.
@@ -80,10 +140,24 @@ public:
   getHeader() const;
 
 
+  /// \brief View the FileBlock table, mapped or not.
+  /// \note Prefer this over getFileBlocks() for read-only access, it never copies.
+  Span<FileBlock const>
+  blocks() const;
+
+
+  /// \brief True if the FileBlock table is viewed in a mapping of the file.
+  bool
+  isMapped() const;
+
+
+  /// \note For a mapped index the first call copies the table out of the mapping.
   std::vector<FileBlock> const&
   getFileBlocks() const;
 
 
+  /// \note For a mapped index this copies the table and drops the mapping,
+  ///       so spans from blocks() taken before are no longer valid.
   std::vector<FileBlock>&
   getFileBlocks();
 
@@ -116,28 +190,120 @@ public:
   void
   setTFFileName(std::string const &);
 
+
+  /// \brief Record how the blocks are laid out in the raw file.
+  /// \note Does not touch the block offsets, see writeBrickedVolume().
+  void
+  setStorage(BlockStorage storage, Codec codec);
+
+
+  /// \brief Bytes of the extra section \c type, empty if there is none.
+  Span<char const>
+  section(SectionType type) const;
+
+
+  /// \brief Record size of the extra section \c type, 0 if it isn't a table.
+  uint32_t
+  sectionRecordBytes(SectionType type) const;
+
+
+  /// \brief Add or replace an extra section, written after the block table.
+  /// \param recordBytes Size of one record if the section is a table, or 0.
+  /// \return False if \c type is one of the core sections.
+  bool
+  setSection(SectionType type, std::vector<char> bytes, uint32_t recordBytes = 0);
+
+
+  /// \brief Drop the extra section \c type if there is one.
+  void
+  removeSection(SectionType type);
+
   /// Initialize this indexfile with datatype t.
   /// \param t
+  /// \param edges With EdgeBlocks::Ragged the block dimensions of the volume
+  ///              are rounded up and the last block along each axis gets
+  ///              the remainder, so no voxels are left out of the blocks.
+  /// \param order Order to put the blocks in, see sortBlocks().
   void
-  init(DataType t);
+  init(DataType t,
+       EdgeBlocks edges = EdgeBlocks::Drop,
+       BlockOrder order = BlockOrder::Linear);
+
+
+  /// \brief Put the blocks in \c order by their ijk index.
+  ///
+  /// Blocks near each other in the volume end up near each other in the
+  /// block list along the Morton and Hilbert curves, so bricks written
+  /// afterwards (see writeBrickedVolume()) of a small region of the volume
+  /// are close together in the file. block_index keeps being the to1D()
+  /// index of the block. The Histograms section is kept in block order, so
+  /// it is dropped.
+  void
+  sortBlocks(BlockOrder order);
 
 
 private:
 
 
+  /// \brief An extra section, either read into \c bytes or viewed in the mapping.
+  struct Section
+  {
+    uint32_t recordBytes;
+    std::vector<char> bytes;
+    Span<char const> mapped;
+  };
+
+
   /// \brief Read binary index file and populate \c a collection with blocks
   bool
   readBinaryIndexFile();
 
 
+  /// \brief Read the sections of a sectioned index file.
+  bool
+  readSections(std::istream &is, IndexPreamble const &pre, uint64_t fileBytes);
+
+
+  /// \brief Read a flat index file, LEGACY_VERSION or later.
+  bool
+  readLegacyIndexFile(std::istream &is);
+
+
+  /// \brief Map the index file and view its block table in place.
+  /// \returns 1 if mapped, 0 if the file could not be mapped, -1 if it is invalid.
+  int
+  mapIndexFile();
+
+
+  /// \brief Copy the mapped block table into m_fileBlocks, if not done yet.
+  void
+  copyMappedBlocks() const;
+
+
+  /// \brief Copy mapped extra sections into memory the IndexFile owns.
+  void
+  copyMappedSections();
+
+
+  void
+  unmap();
+
+
   void
   initHeader(DataType dt);
 
 
   IndexFileHeader m_header;
   std::string m_fileName;
-  std::vector<bd::FileBlock> m_fileBlocks;
+  mutable std::vector<bd::FileBlock> m_fileBlocks;
   bd::Volume m_volume;
+  std::map<SectionType, Section> m_sections;  ///< Sections besides the core three.
+
+  void *m_map;                      ///< Mapping of the whole index file, or nullptr.
+  size_t m_mapBytes;
+  Span<FileBlock const> m_mappedBlocks;
+  mutable bool m_mappedCopied;      ///< m_fileBlocks holds a copy of m_mappedBlocks.
+  mutable std::mutex m_copyLock;
 }; // class IndexFile
 } // namespace bd
 
@@ -5,20 +5,38 @@
 #ifndef bd_INDEXFILEHEADER_H
 #define bd_INDEXFILEHEADER_H
 
+#include <bd/io/compression.h>
 #include <bd/io/datatypes.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 
 namespace bd
 {
 
+/// \brief How the voxels of the FileBlocks are laid out in the data file.
+enum class BlockStorage : uint16_t
+{
+  RowMajor = 0, ///< A plain row-major raw file, data_offset is the first voxel of the block.
+  Bricked = 1   ///< Each block is one contiguous, possibly compressed, brick.
+};
+
+
+std::string
+to_string(BlockStorage s);
+
+
 ///////////////////////////////////////////////////////////////////////////////
 ///   \brief The header for the index file.
 struct IndexFileHeader
 {
 
   /// \brief Generate an IndexFileHeader from an input stream of binary data.
+  ///
+  /// Headers of version 13 and earlier end at tf_file, their storage and
+  /// codec are set to BlockStorage::RowMajor and Codec::None. The stream is
+  /// left just past the header.
   static IndexFileHeader
   fromStream(std::istream &);
 
@@ -38,6 +56,16 @@ struct IndexFileHeader
   getTypeInt(DataType);
 
 
+  /// \brief Convert the storage value to a bd::BlockStorage.
+  static BlockStorage
+  getStorage(const IndexFileHeader &);
+
+
+  /// \brief Convert the codec value to a bd::Codec.
+  static Codec
+  getCodec(const IndexFileHeader &);
+
+
   /// \brief Number describing filetype.
   uint16_t magic_number;
   /// \brief IndexFile revision number
@@ -50,6 +78,10 @@ struct IndexFileHeader
   char raw_file[256];
   /// \brief The transfer func associated with the index file this header is part of.
   char tf_file[256];
+  /// \brief A BlockStorage, how the blocks are laid out in raw_file.
+  uint16_t storage;
+  /// \brief A Codec, only used for BlockStorage::Bricked.
+  uint16_t codec;
 
 
 //  /// \brief Num blocks along each coordinate axis.
@@ -73,6 +105,11 @@ struct IndexFileHeader
 
 }; // struct IndexFileHeader
 
+
+/// \brief Length of a version 13 IndexFileHeader, which has no storage or codec.
+uint32_t const IFH_V13_LENGTH{ offsetof(IndexFileHeader, storage) };
+
+
 std::ostream &
 operator<<(std::ostream &os, bd::IndexFileHeader const &h);
 
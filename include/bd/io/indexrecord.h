@@ -0,0 +1,325 @@
+#ifndef bd_indexrecord_h
+#define bd_indexrecord_h
+
+#include <bd/io/fileblock.h>
+#include <bd/io/indexfileheader.h>
+#include <bd/io/indexsection.h>
+#include <bd/volume/volume.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace bd
+{
+
+/// \brief Encoded size of an IndexPreamble.
+uint32_t const PREAMBLE_RECORD_BYTES{ 24 };
+/// \brief Encoded size of a SectionEntry.
+uint32_t const SECTION_ENTRY_RECORD_BYTES{ 32 };
+/// \brief Encoded size of an IndexFileHeader, IFH_V13_LENGTH for version 13.
+uint32_t const HEADER_RECORD_BYTES{ 528 };
+/// \brief Encoded size of a Volume.
+uint32_t const VOLUME_RECORD_BYTES{ 144 };
+/// \brief Encoded size of a FileBlock, the record size of the block table.
+uint32_t const FILEBLOCK_RECORD_BYTES{ 176 };
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Writes fixed width little-endian values one after the other.
+///
+/// Values are put together a byte at a time, so the bytes come out the same
+/// on hosts of either byte order.
+///////////////////////////////////////////////////////////////////////////////
+class RecordWriter
+{
+public:
+  explicit RecordWriter(char *out)
+    : m_p{ out }
+  { }
+
+
+  void
+  put(uint16_t v)
+  {
+    putBytes(v, 2);
+  }
+
+
+  void
+  put(uint32_t v)
+  {
+    putBytes(v, 4);
+  }
+
+
+  void
+  put(uint64_t v)
+  {
+    putBytes(v, 8);
+  }
+
+
+  void
+  put(float v)
+  {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    put(u);
+  }
+
+
+  void
+  put(double v)
+  {
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    put(u);
+  }
+
+
+  /// \brief Copy \c n bytes as they are.
+  void
+  putRaw(char const *bytes, size_t n)
+  {
+    memcpy(m_p, bytes, n);
+    m_p += n;
+  }
+
+
+  /// \brief Write \c n zero bytes, for reserved fields.
+  void
+  skip(size_t n)
+  {
+    memset(m_p, 0, n);
+    m_p += n;
+  }
+
+
+  char *
+  pos() const
+  {
+    return m_p;
+  }
+
+
+private:
+  void
+  putBytes(uint64_t v, int n)
+  {
+    for (int i{ 0 }; i < n; ++i) {
+      *m_p++ = static_cast<char>(( v >> ( 8 * i ) ) & 0xFF);
+    }
+  }
+
+
+  char *m_p;
+
+}; // class RecordWriter
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Reads the values written by a RecordWriter out of a record of
+///        \c size bytes.
+///
+/// A value that doesn't fit in what is left of the record is not read, and
+/// the variable keeps what it had, so records written before a field was
+/// added read back with the field's default. ok() tells if every value was
+/// there.
+///////////////////////////////////////////////////////////////////////////////
+class RecordReader
+{
+public:
+  RecordReader(char const *in, size_t size)
+    : m_p{ in }
+    , m_left{ size }
+    , m_ok{ true }
+  { }
+
+
+  void
+  get(uint16_t &v)
+  {
+    uint64_t u{ v };
+    getBytes(u, 2);
+    v = static_cast<uint16_t>(u);
+  }
+
+
+  void
+  get(uint32_t &v)
+  {
+    uint64_t u{ v };
+    getBytes(u, 4);
+    v = static_cast<uint32_t>(u);
+  }
+
+
+  void
+  get(uint64_t &v)
+  {
+    getBytes(v, 8);
+  }
+
+
+  void
+  get(float &v)
+  {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    get(u);
+    memcpy(&v, &u, 4);
+  }
+
+
+  void
+  get(double &v)
+  {
+    uint64_t u;
+    memcpy(&u, &v, 8);
+    get(u);
+    memcpy(&v, &u, 8);
+  }
+
+
+  /// \brief Copy \c n bytes as they are.
+  void
+  getRaw(char *bytes, size_t n)
+  {
+    if (fits(n)) {
+      memcpy(bytes, m_p, n);
+      m_p += n;
+      m_left -= n;
+    }
+  }
+
+
+  /// \brief Step over \c n reserved bytes.
+  void
+  skip(size_t n)
+  {
+    if (fits(n)) {
+      m_p += n;
+      m_left -= n;
+    }
+  }
+
+
+  /// \brief False if the record was too short for some of the values read.
+  bool
+  ok() const
+  {
+    return m_ok;
+  }
+
+
+private:
+  bool
+  fits(size_t n)
+  {
+    if (n > m_left) {
+      m_left = 0;
+      m_ok = false;
+      return false;
+    }
+    return true;
+  }
+
+
+  void
+  getBytes(uint64_t &v, int n)
+  {
+    if (! fits(static_cast<size_t>(n))) {
+      return;
+    }
+    uint64_t u{ 0 };
+    for (int i{ 0 }; i < n; ++i) {
+      u |= static_cast<uint64_t>(static_cast<unsigned char>(m_p[i])) << ( 8 * i );
+    }
+    v = u;
+    m_p += n;
+    m_left -= n;
+  }
+
+
+  char const *m_p;
+  size_t m_left;
+  bool m_ok;
+
+}; // class RecordReader
+
+
+void
+encodePreamble(IndexPreamble const &pre, char *out);
+
+
+/// \return False if \c size is less than PREAMBLE_RECORD_BYTES.
+bool
+decodePreamble(char const *in, size_t size, IndexPreamble &pre);
+
+
+void
+encodeSectionEntry(SectionEntry const &e, char *out);
+
+
+/// \brief Decode \c n entries of a section directory at \c in.
+void
+decodeSectionEntries(char const *in, size_t n, SectionEntry *dir);
+
+
+void
+encodeHeader(IndexFileHeader const &h, char *out);
+
+
+/// \brief Decode a header of \c size bytes.
+///
+/// Headers of version 13 and earlier are IFH_V13_LENGTH bytes, without
+/// storage and codec, which are set to BlockStorage::RowMajor and
+/// Codec::None. Longer headers, written by newer code, have the extra
+/// bytes ignored.
+/// \return False if \c size is too short for the header's version.
+bool
+decodeHeader(char const *in, size_t size, IndexFileHeader &h);
+
+
+void
+encodeVolume(Volume const &v, char *out);
+
+
+/// \return False if \c size is less than VOLUME_RECORD_BYTES or the
+///         volume has no blocks along an axis.
+bool
+decodeVolume(char const *in, size_t size, Volume &v);
+
+
+void
+encodeFileBlock(FileBlock const &b, char *out);
+
+
+/// \brief Decode a block record of \c recordBytes bytes.
+///
+/// Fields past the end of a shorter record keep their FileBlock() values,
+/// fields of a longer one that FileBlock doesn't have are ignored.
+void
+decodeFileBlock(char const *in, size_t recordBytes, FileBlock &b);
+
+
+/// \brief Encode \c n blocks into \c n * FILEBLOCK_RECORD_BYTES bytes at \c out.
+void
+encodeFileBlocks(FileBlock const *blocks, size_t n, char *out);
+
+
+/// \brief Decode \c n records of \c recordBytes bytes at \c in.
+void
+decodeFileBlocks(char const *in, size_t n, size_t recordBytes, FileBlock *blocks);
+
+
+/// \brief True if a FileBlock in memory is its record, little-endian and
+///        with the fields at the same offsets, so a block table can be
+///        viewed in place.
+bool
+fileBlockIsRecord();
+
+} // namespace bd
+
+#endif // ! bd_indexrecord_h
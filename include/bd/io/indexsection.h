@@ -0,0 +1,76 @@
+#ifndef bd_indexsection_h
+#define bd_indexsection_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief The kinds of section in a binary index file.
+///
+/// Readers skip types they don't know, so new kinds of per-block data can be
+/// added without touching the core sections or bumping the format version.
+enum class SectionType : uint32_t
+{
+  Header = 1,     ///< The IndexFileHeader.
+  Volume = 2,     ///< The bd::Volume.
+  Blocks = 3,     ///< The FileBlock table.
+  Histograms = 4, ///< Per-block value histograms, see BlockHistograms.
+  Lod = 5,        ///< Coarser levels of detail, see LodPyramid.
+  Bricks = 6,     ///< Layout of the bricks of a bricked volume, see writeBrickedVolume().
+};
+
+
+std::string
+to_string(SectionType t);
+
+
+/// \brief First bytes of a sectioned binary index file.
+///
+/// magic, version and header_length line up with the start of an
+/// IndexFileHeader, so a reader can tell a sectioned file from an older
+/// flat one by the version alone.
+struct IndexPreamble
+{
+  uint16_t magic_number;       ///< Same as IndexFileHeader::magic_number.
+  uint16_t version;            ///< Same as IndexFileHeader::version.
+  uint32_t header_length;      ///< PREAMBLE_RECORD_BYTES.
+  uint32_t byte_order;         ///< INDEX_BYTE_ORDER as written by the writer.
+  uint32_t num_sections;       ///< Number of SectionEntry in the directory.
+  uint32_t directory_checksum; ///< indexChecksum() of the encoded directory.
+  uint32_t reserved;
+};
+
+
+/// \brief One entry of the section directory, which follows the IndexPreamble.
+struct SectionEntry
+{
+  uint32_t type;          ///< A SectionType.
+  uint32_t record_bytes;  ///< Size of one record for tables, 0 otherwise.
+  uint64_t offset;        ///< Byte offset of the section from the start of the file.
+  uint64_t length;        ///< Length of the section in bytes.
+  uint32_t checksum;      ///< indexChecksum() of the section bytes.
+  uint32_t reserved;
+};
+
+
+/// \brief Byte-order mark, stored little-endian like the rest of the file.
+///        Files from before the records were fixed to little-endian, written
+///        on a big-endian host, don't read back as this value.
+uint32_t const INDEX_BYTE_ORDER{ 0x01020304 };
+
+/// \brief Sections start on multiples of this many bytes.
+size_t const SECTION_ALIGNMENT{ 64 };
+
+
+/// \brief CRC-32 (IEEE) of \c bytes bytes at \c data.
+/// \param crc The checksum of the preceding data, to checksum in pieces.
+uint32_t
+indexChecksum(void const *data, size_t bytes, uint32_t crc = 0);
+
+} // namespace bd
+
+#endif // ! bd_indexsection_h
@@ -0,0 +1,157 @@
+#ifndef bd_lodpyramid_h
+#define bd_lodpyramid_h
+
+#include <bd/io/fileblock.h>
+#include <bd/io/indexfile.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief How a coarser level combines the 2x2x2 voxels it replaces.
+enum class LodFilter : uint32_t
+{
+  Average = 0,
+  Max = 1,
+  Min = 2
+};
+
+
+std::string
+to_string(LodFilter f);
+
+
+/// \brief One resolution of a LodPyramid.
+struct LodLevel
+{
+  glm::u64vec3 voxelDims;          ///< Voxels of this level along each axis.
+  glm::u64vec3 blockCount;         ///< Blocks of this level along each axis.
+  std::string rawFile;             ///< Row-major data file of this level.
+  std::vector<FileBlock> blocks;   ///< Blocks into rawFile, laid out like IndexFile::init().
+};
+
+
+/// \brief A stack of ever coarser copies of a volume, each half the
+///        resolution of the one before it, for drawing far away or
+///        zoomed out views without streaming full resolution blocks.
+///
+/// Level 0 is the volume of the IndexFile itself. Level l+1 has
+/// ceil(dims / 2) voxels of level l, each made from up to 2x2x2 voxels of
+/// level l by the LodFilter, and about half as many blocks along each axis,
+/// so blocks keep roughly the same voxel dimensions at every level. Every
+/// level spans the same world box.
+///
+/// Levels 1 and up are kept in the SectionType::Lod section of the index,
+/// their voxels in one row-major file per level next to the raw file.
+class LodPyramid
+{
+public:
+  LodPyramid();
+
+
+  /// \brief Number of levels, including level 0.
+  size_t
+  numLevels() const;
+
+
+  LodLevel const &
+  level(size_t l) const;
+
+
+  LodFilter
+  filter() const;
+
+
+  /// \brief Voxels of level 0 one voxel of level \c l spans, along its
+  ///        coarsest axis.
+  double
+  levelScale(size_t l) const;
+
+
+  /// \brief The coarsest level whose voxels project to at most
+  ///        \c maxPixelError pixels.
+  /// \param pixelsPerVoxel Projected size in pixels of one level 0 voxel,
+  ///                       see projectedVoxelSize().
+  /// \param maxPixelError Screen-space error bound in pixels.
+  size_t
+  selectLevel(double pixelsPerVoxel, double maxPixelError) const;
+
+
+  /// \brief Start a pyramid with level 0 of \c index and \c filter.
+  void
+  reset(IndexFile const &index, LodFilter filter);
+
+
+  /// \brief Add the next coarser level.
+  void
+  addLevel(LodLevel level);
+
+
+  /// \brief Store levels 1 and up as the Lod section of \c index.
+  bool
+  store(IndexFile &index) const;
+
+
+  /// \brief Level 0 from \c index, the other levels from its Lod section.
+  /// \return False if the section is missing or doesn't match this build.
+  bool
+  load(IndexFile const &index);
+
+
+private:
+  /// \brief Start of the Lod section, followed by num_levels LevelRecords
+  ///        and then the FileBlocks of every level in order.
+  struct SectionHeader
+  {
+    uint32_t num_levels;     ///< Levels in the section, not counting level 0.
+    uint32_t filter;         ///< A LodFilter.
+    uint32_t block_bytes;    ///< sizeof(FileBlock)
+    uint32_t reserved;
+  };
+
+  struct LevelRecord
+  {
+    uint64_t voxel_dims[3];
+    uint64_t block_count[3];
+    uint64_t num_blocks;
+    char raw_file[256];
+  };
+
+
+  LodFilter m_filter;
+  std::vector<LodLevel> m_levels;
+
+}; // class LodPyramid
+
+
+/// \brief Projected size in pixels of a voxel \c voxelSize world units
+///        across, \c distance away from a perspective camera.
+/// \param fovY Vertical field of view in radians.
+/// \param viewportHeight Height of the viewport in pixels.
+double
+projectedVoxelSize(double voxelSize, double distance, double fovY, double viewportHeight);
+
+
+/// \brief Build levels 1 to \c numLevels - 1 of the row-major volume
+///        \c rawPath described by \c index.
+///
+/// Level l is written to rawPath + ".lod<l>". Each block gets its min, max,
+/// avg and total value; the relevance fields are left as made by
+/// IndexFile::init(). Stops early once a level is a single voxel.
+/// \return False if the index isn't row-major or a file can't be read or written.
+bool
+buildLodPyramid(IndexFile const &index,
+                std::string const &rawPath,
+                size_t numLevels,
+                LodFilter filter,
+                LodPyramid &pyramid);
+
+} // namespace bd
+
+#endif // ! bd_lodpyramid_h
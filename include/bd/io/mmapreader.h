@@ -0,0 +1,310 @@
+#ifndef bd_mmapreader_h
+#define bd_mmapreader_h
+
+#include <bd/io/buffer.h>
+#include <bd/log/logger.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+namespace bd
+{
+
+
+/// \brief Hands out Buffers that view directly into a memory mapped raw file.
+///
+/// MmapReader has the same consumer side interface as BufferedReader, but no
+/// reader thread and no copy: each Buffer returned by waitNextFullUntilNone()
+/// points into the page cache. The file is advised as sequential and the
+/// window after the one just handed out is prefetched with MADV_WILLNEED.
+///
+/// \note The mapping is read-only. Consumers must not write through the
+///       pointers returned by Buffer::getPtr().
+///
+/// Template parameter \c Ty is the data type contained in the raw file, and is thus
+/// the element type contained in each Buffer.
+template<class Ty>
+class MmapReader
+{
+
+public:
+  /// \param bufSize Size in bytes of the window each Buffer covers.
+  MmapReader(size_t bufSize);
+
+
+  ~MmapReader();
+
+
+  /// \brief Map the raw file at path.
+  /// \return True if mapped, false otherwise.
+  bool
+  open(std::string const &path);
+
+
+  /// \brief Start handing out buffers from the beginning of the file.
+  void
+  start();
+
+
+  /// \brief Stop handing out buffers as soon as possible.
+  void
+  stop();
+
+
+  /// \brief Stop and rewind to the start of the file.
+  /// \return The number of bytes handed out so far.
+  long long int
+  reset();
+
+
+  /// \brief Get a view of the next window of the file.
+  /// \return nullptr once the whole file has been handed out or after stop().
+  Buffer<Ty> *
+  waitNextFullUntilNone();
+
+
+  /// \brief Release a buffer obtained from waitNextFullUntilNone().
+  void
+  waitReturnEmpty(Buffer<Ty> *buf);
+
+
+  /// /brief Get the number of elements in a single window.
+  size_t
+  singleBufferElements() const;
+
+
+  size_t
+  totalBufferBytes() const;
+
+
+  /// \brief Size of the mapped file in bytes.
+  size_t
+  fileSize() const;
+
+
+private:
+  void
+  unmap();
+
+
+  std::string m_path;
+
+  size_t m_bufSizeBytes;
+  size_t m_fileSizeBytes;
+
+  Ty *m_mem;
+  size_t m_nextElement;
+  size_t m_numElements;
+
+  std::mutex m_nextLock;
+  std::atomic_bool m_stop;
+  std::atomic<long long> m_bytesHandedOut;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+MmapReader<Ty>::MmapReader(size_t bufSize)
+    : m_path{ }
+    , m_bufSizeBytes{ bufSize }
+    , m_fileSizeBytes{ 0 }
+    , m_mem{ nullptr }
+    , m_nextElement{ 0 }
+    , m_numElements{ 0 }
+    , m_stop{ false }
+    , m_bytesHandedOut{ 0 }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+MmapReader<Ty>::~MmapReader()
+{
+  unmap();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+MmapReader<Ty>::open(std::string const &path)
+{
+  unmap();
+  m_path = path;
+
+  int fd{ ::open(m_path.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    Err() << "Unable to open file: " + m_path;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    Err() << "Unable to stat file: " << m_path << " (" << strerror(errno) << ")";
+    ::close(fd);
+    return false;
+  }
+
+  m_fileSizeBytes = static_cast<size_t>(st.st_size);
+  m_numElements = m_fileSizeBytes / sizeof(Ty);
+  if (m_numElements == 0) {
+    Err() << "File " << m_path << " is too small to hold a single element.";
+    ::close(fd);
+    return false;
+  }
+
+  void *mem{ mmap(nullptr, m_fileSizeBytes, PROT_READ, MAP_PRIVATE, fd, 0) };
+  // The mapping holds its own reference to the file.
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    Err() << "Unable to mmap file: " << m_path << " (" << strerror(errno) << ")";
+    return false;
+  }
+
+  madvise(mem, m_fileSizeBytes, MADV_SEQUENTIAL);
+  m_mem = static_cast<Ty *>(mem);
+
+  Info() << "Mapped " << m_fileSizeBytes << " bytes of " << m_path;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+MmapReader<Ty>::start()
+{
+  std::lock_guard<std::mutex> lck(m_nextLock);
+  m_stop = false;
+  m_nextElement = 0;
+  m_bytesHandedOut = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+MmapReader<Ty>::stop()
+{
+  m_stop = true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+long long int
+MmapReader<Ty>::reset()
+{
+  std::lock_guard<std::mutex> lck(m_nextLock);
+  m_stop = true;
+  m_nextElement = 0;
+  return m_bytesHandedOut.exchange(0);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+Buffer<Ty> *
+MmapReader<Ty>::waitNextFullUntilNone()
+{
+  size_t const bufElems{ singleBufferElements() };
+  size_t first{ 0 };
+  size_t count{ 0 };
+  {
+    std::lock_guard<std::mutex> lck(m_nextLock);
+    if (m_stop || m_mem == nullptr || m_nextElement >= m_numElements) {
+      return nullptr;
+    }
+
+    first = m_nextElement;
+    count = std::min(bufElems, m_numElements - first);
+    m_nextElement += count;
+  }
+
+  // Read ahead the window after this one while the consumer works on this one.
+  size_t const aheadFirst{ first + count };
+  if (aheadFirst < m_numElements) {
+    size_t const aheadCount{ std::min(bufElems, m_numElements - aheadFirst) };
+    long const page{ sysconf(_SC_PAGESIZE) };
+    uintptr_t start{ reinterpret_cast<uintptr_t>(m_mem + aheadFirst) };
+    uintptr_t pageStart{ start & ~static_cast<uintptr_t>(page - 1) };
+    madvise(reinterpret_cast<void *>(pageStart),
+            aheadCount * sizeof(Ty) + (start - pageStart),
+            MADV_WILLNEED);
+  }
+
+  Buffer<Ty> *buf{ new Buffer<Ty>{ m_mem + first, bufElems, first }};
+  buf->setNumElements(count);
+  m_bytesHandedOut += static_cast<long long>(count * sizeof(Ty));
+
+  return buf;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+MmapReader<Ty>::waitReturnEmpty(Buffer<Ty> *buf)
+{
+  delete buf;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+MmapReader<Ty>::singleBufferElements() const
+{
+  size_t elems{ m_bufSizeBytes / sizeof(Ty) };
+  return elems > 0 ? elems : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+MmapReader<Ty>::totalBufferBytes() const
+{
+  return m_bufSizeBytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+size_t
+MmapReader<Ty>::fileSize() const
+{
+  return m_fileSizeBytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+MmapReader<Ty>::unmap()
+{
+  if (m_mem) {
+    munmap(m_mem, m_fileSizeBytes);
+    m_mem = nullptr;
+  }
+  m_fileSizeBytes = 0;
+  m_numElements = 0;
+  m_nextElement = 0;
+}
+
+
+} // namespace bd
+
+#endif // ! bd_mmapreader_h
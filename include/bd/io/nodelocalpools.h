@@ -0,0 +1,166 @@
+#ifndef bd_nodelocalpools_h
+#define bd_nodelocalpools_h
+
+#include <bd/io/bufferpool.h>
+#include <bd/io/poolallocator.h>
+
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief One BufferPool per NUMA node, each with its memory bound to that node.
+///
+/// Readers and consumers pick the pool of the node they run on with local(),
+/// so a buffer is filled and consumed by threads that share its memory
+/// controller. On a machine with a single node this is just one pool.
+///
+/// Template parameter \c Ty is the element type of the buffers.
+template<class Ty>
+class NodeLocalPools
+{
+public:
+  /// \param bufSize Total size in bytes of the buffers in each node's pool.
+  /// \param numBuffers Number of buffers in each node's pool.
+  /// \param policy Allocation policy for every pool, numaNode is overridden.
+  NodeLocalPools(size_t bufSize, int numBuffers,
+                 PoolAllocPolicy const &policy = PoolAllocPolicy{ });
+
+
+  ~NodeLocalPools();
+
+
+  NodeLocalPools(NodeLocalPools const &) = delete;
+  NodeLocalPools &operator=(NodeLocalPools const &) = delete;
+
+
+  /// \brief Allocate every node's pool.
+  /// \return False if any of the pools could not be allocated.
+  bool
+  allocate();
+
+
+  int
+  numNodes() const;
+
+
+  /// \brief The pool bound to \c node.
+  BufferPool<Ty> &
+  pool(int node);
+
+
+  /// \brief The pool of the node the calling thread is running on.
+  BufferPool<Ty> &
+  local();
+
+
+  /// \brief Request a stop on every pool.
+  void
+  requestStop();
+
+
+  /// \brief Reset every pool.
+  /// \note Function not thread safe.
+  void
+  reset();
+
+
+private:
+  std::vector<BufferPool<Ty> *> m_pools;
+
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+NodeLocalPools<Ty>::NodeLocalPools(size_t bufSize, int numBuffers,
+                                   PoolAllocPolicy const &policy)
+    : m_pools{ }
+{
+  int const nodes{ numaNodeCount() };
+  for (int n{ 0 }; n < nodes; ++n) {
+    PoolAllocPolicy p{ policy };
+    p.numaNode = nodes > 1 ? n : -1;
+    BufferPool<Ty> *pool{ new BufferPool<Ty>(bufSize, numBuffers) };
+    pool->setAllocPolicy(p);
+    m_pools.push_back(pool);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+NodeLocalPools<Ty>::~NodeLocalPools()
+{
+  for (BufferPool<Ty> *p : m_pools) {
+    delete p;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+bool
+NodeLocalPools<Ty>::allocate()
+{
+  bool ok{ true };
+  for (BufferPool<Ty> *p : m_pools) {
+    ok = p->allocate() && ok;
+  }
+  return ok;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+int
+NodeLocalPools<Ty>::numNodes() const
+{
+  return static_cast<int>(m_pools.size());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+BufferPool<Ty> &
+NodeLocalPools<Ty>::pool(int node)
+{
+  return *m_pools[static_cast<size_t>(node) % m_pools.size()];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+BufferPool<Ty> &
+NodeLocalPools<Ty>::local()
+{
+  return pool(currentNumaNode());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+NodeLocalPools<Ty>::requestStop()
+{
+  for (BufferPool<Ty> *p : m_pools) {
+    p->requestStop();
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+NodeLocalPools<Ty>::reset()
+{
+  for (BufferPool<Ty> *p : m_pools) {
+    p->reset();
+  }
+}
+
+
+} // namespace bd
+
+#endif // ! bd_nodelocalpools_h
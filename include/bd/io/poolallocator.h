@@ -0,0 +1,132 @@
+#ifndef bd_poolallocator_h
+#define bd_poolallocator_h
+
+#include <cstddef>
+
+namespace bd
+{
+
+/// \brief The kind of pages backing a BufferPool arena.
+enum class PageSize
+{
+  Default,      ///< Whatever the allocator gives (normally 4 KB pages).
+  Transparent,  ///< 2 MB aligned anonymous mapping advised with MADV_HUGEPAGE.
+  Huge2M,       ///< MAP_HUGETLB with 2 MB pages, falls back to Transparent.
+  Huge1G        ///< MAP_HUGETLB with 1 GB pages, falls back to Huge2M.
+};
+
+
+/// \brief How the memory of a BufferPool is allocated.
+struct PoolAllocPolicy
+{
+  PoolAllocPolicy()
+    : alignment{ 0 }
+    , pages{ PageSize::Default }
+    , numaNode{ -1 }
+    , prefault{ false }
+  { }
+
+
+  size_t alignment;  ///< Byte alignment of the arena and buffers, 0 for none.
+  PageSize pages;    ///< Page size of the arena.
+  int numaNode;      ///< NUMA node to bind the arena to, -1 to not bind.
+  bool prefault;     ///< Touch every page after allocating so no faults happen
+                     ///< on first use (and first touch can't move the pages).
+};
+
+
+/// \brief A block of memory allocated according to a PoolAllocPolicy.
+///
+/// Huge page and NUMA bound arenas come straight from mmap(2), everything
+/// else from posix_memalign(3). If huge pages are not available the next
+/// smaller page size is tried, so allocate() only fails if there is no
+/// memory at all.
+class PoolMemory
+{
+public:
+  PoolMemory();
+
+
+  ~PoolMemory();
+
+
+  PoolMemory(PoolMemory const &) = delete;
+  PoolMemory &operator=(PoolMemory const &) = delete;
+
+
+  /// \brief Allocate \c bytes of memory, releasing anything held before.
+  /// \return True on success, false if no memory could be allocated.
+  bool
+  allocate(size_t bytes, PoolAllocPolicy const &policy);
+
+
+  /// \brief Give the memory back to the system.
+  void
+  release();
+
+
+  void *
+  ptr() const;
+
+
+  /// \brief Number of usable bytes at ptr().
+  size_t
+  bytes() const;
+
+
+  /// \brief The page size actually used, which may be smaller than requested.
+  PageSize
+  pages() const;
+
+
+  /// \brief True if the memory was bound to a NUMA node.
+  bool
+  isNumaBound() const;
+
+
+private:
+  enum class Kind
+  {
+    None,
+    Heap,
+    Mapped
+  };
+
+
+  bool
+  mapHuge(size_t bytes, PageSize pages);
+
+
+  bool
+  mapAligned(size_t bytes, size_t alignment);
+
+
+  void *m_ptr;
+  size_t m_bytes;
+  size_t m_mappedBytes;
+  Kind m_kind;
+  PageSize m_pages;
+  bool m_numaBound;
+
+}; // class PoolMemory
+
+
+/// \brief Number of NUMA nodes on this machine (1 if unknown).
+int
+numaNodeCount();
+
+
+/// \brief The NUMA node of the CPU the calling thread is running on (0 if unknown).
+int
+currentNumaNode();
+
+
+/// \brief Bind the pages in [ptr, ptr+bytes) to NUMA \c node.
+/// \note \c ptr must be page aligned, and the pages should not have been touched yet.
+/// \return False if the kernel refused.
+bool
+bindToNumaNode(void *ptr, size_t bytes, int node);
+
+} // namespace bd
+
+#endif // ! bd_poolallocator_h
@@ -0,0 +1,27 @@
+#ifndef bd_posixio_h
+#define bd_posixio_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bd
+{
+
+/// \brief pread(2) \c bytes bytes at \c offset of \c fd into \c dst,
+///        retrying after signals and short reads.
+///
+/// Only pread is used, so threads can share the descriptor.
+/// \returns The bytes read, fewer than \c bytes only at end of file, or
+///          -errno if a read failed.
+long long
+preadFully(int fd, void *dst, size_t bytes, uint64_t offset);
+
+
+/// \brief Like preadFully(), but logs an error and fails on a short read.
+/// \returns True if all \c bytes were read.
+bool
+preadAll(int fd, void *dst, size_t bytes, uint64_t offset);
+
+} // namespace bd
+
+#endif // ! bd_posixio_h
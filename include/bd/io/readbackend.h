@@ -0,0 +1,113 @@
+#ifndef bd_readbackend_h
+#define bd_readbackend_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bd
+{
+
+/// \brief The kinds of ReadBackend that ReadBackend::create() can make.
+enum class ReadBackendType
+{
+  Pread,  ///< Pool of threads each issuing blocking pread(2)s.
+  Uring   ///< Linux io_uring (falls back to Pread if unavailable).
+};
+
+
+/// \brief Alignment of buffers, offsets and lengths used with O_DIRECT.
+size_t const DIRECT_IO_ALIGNMENT{ 4096 };
+
+
+/// \brief The result of a read submitted to a ReadBackend.
+struct ReadCompletion
+{
+  void *tag;        ///< The tag given to ReadBackend::submit().
+  long long bytes;  ///< Bytes read, 0 at end of file, or -errno on failure.
+};
+
+
+/// \brief Asynchronous positional reads from a single file.
+///
+/// Up to queueDepth() reads may be outstanding at once. Reads complete in
+/// whatever order the device finishes them, so callers identify each read
+/// with the tag they passed to submit().
+class ReadBackend
+{
+public:
+
+  /// \brief Create a backend of the given type.
+  /// \param queueDepth Max number of reads in flight.
+  /// \returns A new backend, or nullptr if one could not be created.
+  static ReadBackend *
+  create(ReadBackendType type, int queueDepth);
+
+
+  virtual
+  ~ReadBackend();
+
+
+  /// \brief Open the file at \c path for reading.
+  /// \param direct If true open with O_DIRECT. Destination pointers,
+  ///               offsets and lengths must then be DIRECT_IO_ALIGNMENT aligned.
+  bool
+  open(std::string const &path, bool direct);
+
+
+  /// \brief Close the file opened with open().
+  void
+  close();
+
+
+  /// \brief Queue a read of \c bytes at \c offset into \c dst.
+  /// \returns False if the read could not be queued.
+  virtual bool
+  submit(void *dst, size_t bytes, uint64_t offset, void *tag) = 0;
+
+
+  /// \brief Block until one of the submitted reads finishes.
+  /// \returns False if no reads are outstanding.
+  virtual bool
+  waitCompletion(ReadCompletion &c) = 0;
+
+
+  /// \brief Max number of reads that can be in flight.
+  int
+  queueDepth() const;
+
+
+  /// \brief Size of the open file in bytes.
+  uint64_t
+  fileSize() const;
+
+
+  /// \brief True if the file was opened with O_DIRECT.
+  bool
+  isDirect() const;
+
+
+protected:
+  ReadBackend(int queueDepth);
+
+
+  /// \brief Called after the file has been opened.
+  virtual bool
+  onOpen();
+
+
+  /// \brief Called before the file is closed.
+  virtual void
+  onClose();
+
+
+  int m_fd;
+  int m_queueDepth;
+  uint64_t m_fileSize;
+  bool m_direct;
+
+}; // class ReadBackend
+
+} // namespace bd
+
+#endif // ! bd_readbackend_h
@@ -4,10 +4,13 @@
 
 #include <bd/io/bufferpool.h>
 #include <bd/io/buffer.h>
+#include <bd/io/readbackend.h>
 #include <bd/log/logger.h>
 
 #include <fstream>
 #include <atomic>
+#include <cstdint>
+#include <limits>
 #include <string>
 
 namespace bd
@@ -19,10 +22,17 @@ class ReaderWorker
 {
 public:
 
-  ReaderWorker(BufferPool<Ty> &p)
+  /// \param backend If not null, reads are queued on \c backend rather than
+  ///        read one at a time from an ifstream. The worker does not own it.
+  ReaderWorker(BufferPool<Ty> &p, ReadBackend *backend = nullptr)
     //: m_reader{ &r }
     : m_pool{ &p }
     , m_is{ nullptr }
+    , m_backend{ backend }
+    , m_direct{ false }
+    , m_firstChunk{ 0 }
+    , m_chunkStride{ 1 }
+    , m_lastChunk{ std::numeric_limits<uint64_t>::max() }
   { }
 
   ~ReaderWorker()
@@ -36,18 +46,28 @@ public:
   long long
   operator()(std::atomic_bool const &quit)
   {
+    if (m_backend) {
+      return readQueued(quit);
+    }
+
     if (! open()) {
         Err() << "Could not open file " << m_path << ". Exiting readerworker loop.";
+        m_pool->producerDone();
         return -1;
     }
 
     // bytes to attempt to read from file.
-//    long long const buffer_size_bytes{ static_cast<long long>(m_pool->bufferSizeElements() * sizeof(Ty)) };
+    size_t const buffer_size_bytes{ m_pool->bufferSizeElements() * sizeof(Ty) };
     size_t total_read_bytes{ 0 };
 
     Dbg() << "Starting reader loop.";
     std::cout << std::endl;
-    while(!m_is->eof() && !quit) {
+    for (uint64_t chunk{ m_firstChunk }; chunk < m_lastChunk && !quit; chunk += m_chunkStride) {
+
+      uint64_t const offset{ chunk * buffer_size_bytes };
+      if (! m_pool->waitWindow(offset / sizeof(Ty))) {
+        break;
+      }
 
       // wait for the next empty buffer in the pool.
       Buffer<Ty> *buf = m_pool->nextEmpty();
@@ -57,10 +77,11 @@ public:
 
 
       // set the element index this buffer starts at.
-      buf->setIndexOffset(total_read_bytes/sizeof(Ty));
+      buf->setIndexOffset(offset/sizeof(Ty));
       Ty *data = buf->getPtr();
 
-      m_is->read(reinterpret_cast<char*>(data), buf->getMaxNumElements());
+      m_is->seekg(offset, std::ios::beg);
+      m_is->read(reinterpret_cast<char*>(data), buffer_size_bytes);
       std::streamsize amount{ m_is->gcount() };
       buf->setNumElements(amount / sizeof(Ty));
       
@@ -77,11 +98,15 @@ public:
 
       m_pool->returnFull(buf);
 
-    } // while
+      if (static_cast<size_t>(amount) < buffer_size_bytes) {
+        break; // end of file
+      }
+
+    } // for
 
     std::cout << std::endl;
 
-    m_pool->requestStop();
+    m_pool->producerDone();
 
     m_is->close();
     Dbg() << "Reader done after reading " << total_read_bytes << " bytes";
@@ -97,7 +122,125 @@ public:
   }
 
 
+  /// \brief Only read some of the file.
+  /// The file is divided into chunks the size of one pool buffer. This worker
+  /// reads chunks \c first, \c first+stride, ... up to but not including \c last.
+  /// The default reads every chunk until the end of the file.
+  void
+  setChunks(uint64_t first, uint64_t stride, uint64_t last)
+  {
+    m_firstChunk = first;
+    m_chunkStride = stride > 0 ? stride : 1;
+    m_lastChunk = last;
+  }
+
+
+  /// \brief Open the file with O_DIRECT when reading through a backend.
+  /// \note The pool must have been created with DIRECT_IO_ALIGNMENT.
+  void
+  setDirect(bool direct)
+  {
+    m_direct = direct;
+  }
+
+
 private:
+  /// \brief Fill buffers keeping up to m_backend->queueDepth() reads in flight.
+  /// Buffers are returned full in the order their reads complete.
+  /// \returns -1 if file could not be opened or a read failed, or the total bytes read.
+  long long
+  readQueued(std::atomic_bool const &quit)
+  {
+    if (! m_backend->open(m_path, m_direct)) {
+      Err() << "Could not open file " << m_path << ". Exiting readerworker loop.";
+      m_pool->producerDone();
+      return -1;
+    }
+
+    uint64_t const fileSize{ m_backend->fileSize() };
+    size_t const bufferBytes{ m_pool->bufferSizeElements() * sizeof(Ty) };
+    uint64_t chunk{ m_firstChunk };
+    size_t total_read_bytes{ 0 };
+    int inFlight{ 0 };
+    bool failed{ false };
+
+    Dbg() << "Starting queued reader loop, queue depth " << m_backend->queueDepth();
+    while (true) {
+
+      // Top up the queue. Only block for an empty buffer if nothing is in
+      // flight, otherwise we could wait on buffers only we can complete.
+      while (!quit && !failed && chunk < m_lastChunk && chunk * bufferBytes < fileSize &&
+             inFlight < m_backend->queueDepth()) {
+
+        uint64_t const nextOffset{ chunk * bufferBytes };
+        // Blocking in the window with reads in flight could deadlock too.
+        if (inFlight == 0 ? ! m_pool->waitWindow(nextOffset / sizeof(Ty))
+                          : nextOffset / sizeof(Ty) >= m_pool->windowEnd()) {
+          break;
+        }
+
+        Buffer<Ty> *buf{ inFlight == 0 ? m_pool->nextEmpty() : m_pool->tryNextEmpty() };
+        if (buf == nullptr) {
+          break;
+        }
+
+        buf->setIndexOffset(nextOffset / sizeof(Ty));
+        // O_DIRECT lengths must stay aligned, the tail read just comes back short.
+        size_t len{ bufferBytes };
+        if (! m_backend->isDirect() && fileSize - nextOffset < len) {
+          len = static_cast<size_t>(fileSize - nextOffset);
+        }
+
+        if (! m_backend->submit(buf->getPtr(), len, nextOffset, buf)) {
+          m_pool->returnEmpty(buf);
+          failed = true;
+          break;
+        }
+
+        chunk += m_chunkStride;
+        ++inFlight;
+      }
+
+      if (inFlight == 0) {
+        break;
+      }
+
+      ReadCompletion c;
+      if (! m_backend->waitCompletion(c)) {
+        failed = true;
+        break;
+      }
+      --inFlight;
+
+      Buffer<Ty> *buf{ static_cast<Buffer<Ty> *>(c.tag) };
+      if (c.bytes <= 0) {
+        if (c.bytes < 0) {
+          Err() << "Read failed in " << m_path << " (errno " << -c.bytes << ")";
+          failed = true;
+        }
+        m_pool->returnEmpty(buf);
+        continue;
+      }
+
+      buf->setNumElements(static_cast<size_t>(c.bytes) / sizeof(Ty));
+      total_read_bytes += c.bytes;
+      std::cout << "\rRead " << total_read_bytes << " bytes." << std::flush;
+
+      m_pool->returnFull(buf);
+
+    } // while
+
+    std::cout << std::endl;
+
+    m_pool->producerDone();
+
+    m_backend->close();
+    Dbg() << "Reader done after reading " << total_read_bytes << " bytes";
+    return failed ? -1 : static_cast<long long int>(total_read_bytes);
+  }
+
+
+
   bool
   open()
   {
@@ -108,7 +251,12 @@ private:
 
   BufferPool<Ty> *m_pool;
   std::ifstream *m_is;
+  ReadBackend *m_backend;
   std::string m_path;
+  bool m_direct;
+  uint64_t m_firstChunk;
+  uint64_t m_chunkStride;
+  uint64_t m_lastChunk;
 
 }; // ReaderWorker
 
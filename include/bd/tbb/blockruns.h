@@ -0,0 +1,106 @@
+#ifndef bd_blockruns_h
+#define bd_blockruns_h
+
+#include <bd/volume/volume.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace bd
+{
+
+
+/// \brief Splits a run of voxels of a row-major volume into pieces that each
+///        lie in one block.
+///
+/// Used by the parallel bodies that take a Buffer from a reader and need
+/// per-block results: rather than working out the block of every voxel, they
+/// walk the buffer a run of up to one block width at a time. Blocks are
+/// numbered by the to1D() of their ijk index, which is FileBlock::block_index
+/// for blocks laid out by IndexFile::init(). Voxels outside
+/// Volume::blocksExtent(), the remainder EdgeBlocks::Drop leaves uncovered,
+/// belong to no block and are skipped.
+class BlockRuns
+{
+public:
+  explicit BlockRuns(Volume const &volume)
+    : m_volDims{ volume.voxelDims() }
+    , m_blockDims{ volume.block_dims() }
+    , m_blockCount{ volume.block_count() }
+    , m_extent{ volume.blocksExtent() }
+  {
+  }
+
+
+  /// \brief Call \c fn(block, runBegin, runEnd) for each run of voxels
+  ///        [begin, end) of a buffer whose first voxel is voxel \c offset of
+  ///        the volume.
+  ///
+  /// runBegin and runEnd are positions in the buffer, like begin and end.
+  template<class Function>
+  void
+  forEachRun(uint64_t offset, size_t begin, size_t end, Function fn) const
+  {
+    uint64_t const rowLen{ m_volDims.x };
+    uint64_t const sliceLen{ m_volDims.x * m_volDims.y };
+
+    size_t i{ begin };
+    while (i < end) {
+      uint64_t const voxel{ offset + i };
+      uint64_t const x{ voxel % rowLen };
+      uint64_t const y{ ( voxel / rowLen ) % m_volDims.y };
+      uint64_t const z{ voxel / sliceLen };
+
+      // Skip what is left of the volume, the slice or the row when it is
+      // past the blocks.
+      if (z >= m_extent.z) {
+        return;
+      }
+      if (y >= m_extent.y) {
+        i = static_cast<size_t>(std::min<uint64_t>(end, i + ( sliceLen - y * rowLen - x )));
+        continue;
+      }
+      if (x >= m_extent.x) {
+        i = static_cast<size_t>(std::min<uint64_t>(end, i + ( rowLen - x )));
+        continue;
+      }
+
+      uint64_t const bi{ x / m_blockDims.x };
+      uint64_t const bj{ y / m_blockDims.y };
+      uint64_t const bk{ z / m_blockDims.z };
+
+      // The run ends at the next block boundary along x, the end of the
+      // blocks along the row, or the end of the range, whichever comes first.
+      uint64_t const blockEndX{ std::min<uint64_t>(( bi + 1 ) * m_blockDims.x, m_extent.x) };
+      size_t const runEnd{ static_cast<size_t>(
+          std::min<uint64_t>(end, i + ( blockEndX - x ))) };
+
+      fn(bi + m_blockCount.x * ( bj + m_blockCount.y * bk ), i, runEnd);
+      i = runEnd;
+    }
+  }
+
+
+  /// \brief Number of blocks in the volume.
+  uint64_t
+  numBlocks() const
+  {
+    return m_blockCount.x * m_blockCount.y * m_blockCount.z;
+  }
+
+
+private:
+  glm::u64vec3 m_volDims;
+  glm::u64vec3 m_blockDims;
+  glm::u64vec3 m_blockCount;
+  glm::u64vec3 m_extent;   ///< Volume::blocksExtent()
+
+}; // class BlockRuns
+
+
+} // namespace bd
+
+#endif // ! bd_blockruns_h
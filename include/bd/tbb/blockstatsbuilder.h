@@ -0,0 +1,238 @@
+#ifndef bd_blockstatsbuilder_h
+#define bd_blockstatsbuilder_h
+
+#include <bd/io/buffer.h>
+#include <bd/io/indexfile.h>
+#include <bd/tbb/blockruns.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief Relevance function that counts every voxel as relevant.
+template<class Ty>
+struct AllVoxelsRelevant
+{
+  bool
+  operator()(Ty const &) const
+  {
+    return true;
+  }
+};
+
+
+/// \brief Fills in the statistics of the FileBlocks of an IndexFile from
+///        the buffers of a reader, on all cores.
+///
+/// Each Buffer is a run of the row-major volume starting at voxel
+/// Buffer::getIndexOffset(), as handed out by BufferedReader or MmapReader.
+/// The voxels of a buffer are split over TBB worker threads. Each thread
+/// walks its part a run of up to one block width at a time (see BlockRuns),
+/// and adds the run to its own partial statistics for that block. The partials
+/// are merged only in finish(), so the threads never share a counter.
+///
+/// finish() sets min_val, max_val, avg_val, total_val, empty_voxels and rov
+/// of every block, is_empty for blocks without relevant voxels, and the
+/// min, max, avg, total and empty voxel count of the Volume. Voxels left
+/// outside the blocks by EdgeBlocks::Drop are not counted anywhere.
+///
+/// Template parameter \c Ty is the voxel type, \c Relevance a function
+/// object that returns true for voxels that are relevant (not empty).
+template<class Ty, class Relevance = AllVoxelsRelevant<Ty>>
+class BlockStatsBuilder
+{
+public:
+  /// \param index Index whose blocks are filled in, laid out by IndexFile::init().
+  ///              Must outlive the builder.
+  /// \param relevant Decides which voxels are relevant.
+  BlockStatsBuilder(IndexFile &index, Relevance relevant = Relevance());
+
+
+  /// \brief Add the voxels of \c buf. May be called from several threads.
+  void
+  add(Buffer<Ty> const &buf);
+
+
+  /// \brief Add every buffer of \c reader until it runs out, then return them.
+  /// \return The number of voxels added.
+  template<class Reader>
+  uint64_t
+  consume(Reader &reader);
+
+
+  /// \brief Merge the per-thread statistics into the IndexFile.
+  void
+  finish();
+
+
+private:
+  struct Partial
+  {
+    Partial()
+      : min{ std::numeric_limits<double>::max() }
+      , max{ std::numeric_limits<double>::lowest() }
+      , total{ 0.0 }
+      , count{ 0 }
+      , relevant{ 0 }
+    { }
+
+    double min;
+    double max;
+    double total;
+    uint64_t count;
+    uint64_t relevant;
+  };
+
+  using Partials = std::vector<Partial>;
+
+
+  /// \brief Add the voxels [begin, end) of \c buf to \c partials.
+  void
+  addRange(Buffer<Ty> const &buf, size_t begin, size_t end, Partials &partials) const;
+
+
+  IndexFile *m_index;
+  Relevance m_relevant;
+  BlockRuns m_runs;
+  tbb::enumerable_thread_specific<Partials> m_partials;
+
+}; // class BlockStatsBuilder
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, class Relevance>
+BlockStatsBuilder<Ty, Relevance>::BlockStatsBuilder(IndexFile &index, Relevance relevant)
+  : m_index{ &index }
+  , m_relevant{ relevant }
+  , m_runs{ index.getVolume() }
+  , m_partials{ Partials(index.blocks().size()) }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, class Relevance>
+void
+BlockStatsBuilder<Ty, Relevance>::add(Buffer<Ty> const &buf)
+{
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>{ 0, buf.getNumElements(), 4096 },
+      [this, &buf](tbb::blocked_range<size_t> const &r) {
+        addRange(buf, r.begin(), r.end(), m_partials.local());
+      });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, class Relevance>
+template<class Reader>
+uint64_t
+BlockStatsBuilder<Ty, Relevance>::consume(Reader &reader)
+{
+  uint64_t voxels{ 0 };
+  Buffer<Ty> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    add(*buf);
+    voxels += buf->getNumElements();
+    reader.waitReturnEmpty(buf);
+  }
+  return voxels;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, class Relevance>
+void
+BlockStatsBuilder<Ty, Relevance>::addRange(Buffer<Ty> const &buf,
+                                           size_t begin,
+                                           size_t end,
+                                           Partials &partials) const
+{
+  Ty const *data{ buf.getPtr() };
+  m_runs.forEachRun(buf.getIndexOffset(), begin, end,
+                    [&](uint64_t block, size_t runBegin, size_t runEnd) {
+    double mn{ std::numeric_limits<double>::max() };
+    double mx{ std::numeric_limits<double>::lowest() };
+    double total{ 0.0 };
+    uint64_t relevant{ 0 };
+    for (size_t v{ runBegin }; v < runEnd; ++v) {
+      double const d{ static_cast<double>(data[v]) };
+      mn = std::min(mn, d);
+      mx = std::max(mx, d);
+      total += d;
+      relevant += m_relevant(data[v]) ? 1 : 0;
+    }
+
+    Partial &p = partials[block];
+    p.min = std::min(p.min, mn);
+    p.max = std::max(p.max, mx);
+    p.total += total;
+    p.count += runEnd - runBegin;
+    p.relevant += relevant;
+  });
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, class Relevance>
+void
+BlockStatsBuilder<Ty, Relevance>::finish()
+{
+  std::vector<FileBlock> &blocks = m_index->getFileBlocks();
+  Partials merged(blocks.size());
+  for (Partials const &local : m_partials) {
+    for (size_t b{ 0 }; b < merged.size(); ++b) {
+      Partial &m = merged[b];
+      m.min = std::min(m.min, local[b].min);
+      m.max = std::max(m.max, local[b].max);
+      m.total += local[b].total;
+      m.count += local[b].count;
+      m.relevant += local[b].relevant;
+    }
+  }
+
+  double volMin{ std::numeric_limits<double>::max() };
+  double volMax{ std::numeric_limits<double>::lowest() };
+  double volTotal{ 0.0 };
+  uint64_t volCount{ 0 };
+  uint64_t volEmpty{ 0 };
+
+  for (FileBlock &fb : blocks) {
+    // Blocks are laid out by init(), so block_index is the partial's slot.
+    Partial const &m = merged[fb.block_index];
+    fb.min_val = m.min;
+    fb.max_val = m.max;
+    fb.total_val = m.total;
+    fb.avg_val = m.count > 0 ? m.total / m.count : 0.0;
+    fb.empty_voxels = m.count - m.relevant;
+    fb.rov = m.count > 0 ? static_cast<double>(m.relevant) / m.count : 0.0;
+    fb.is_empty = m.relevant == 0 ? 1 : 0;
+
+    volMin = std::min(volMin, m.min);
+    volMax = std::max(volMax, m.max);
+    volTotal += m.total;
+    volCount += m.count;
+    volEmpty += fb.empty_voxels;
+  }
+
+  Volume &vol = m_index->getVolume();
+  vol.min(volMin);
+  vol.max(volMax);
+  vol.total(volTotal);
+  vol.avg(volCount > 0 ? volTotal / volCount : 0.0);
+  vol.numEmptyVoxels(volEmpty);
+}
+
+
+} // namespace bd
+
+#endif // ! bd_blockstatsbuilder_h
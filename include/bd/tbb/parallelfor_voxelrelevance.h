@@ -0,0 +1,321 @@
+#ifndef bd_parallelfor_voxelrelevance_h
+#define bd_parallelfor_voxelrelevance_h
+
+#include <bd/io/buffer.h>
+#include <bd/tbb/blockruns.h>
+#include <bd/volume/volume.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief One bit of relevance per voxel, packed 64 to a word.
+///
+/// Bit i % 64 of word i / 64 belongs to voxel i. The parallel bodies below
+/// each write whole words, so threads never share one, which a
+/// std::vector<bool> written voxel by voxel can't promise.
+class RelevanceBitmap
+{
+public:
+  explicit RelevanceBitmap(size_t n = 0)
+    : m_size{ n }
+    , m_words(numWords(n), 0)
+  {
+  }
+
+
+  /// \brief Words needed for \c n voxels.
+  static size_t
+  numWords(size_t n)
+  {
+    return ( n + 63 ) / 64;
+  }
+
+
+  /// \brief Resize to \c n voxels, all irrelevant.
+  void
+  reset(size_t n)
+  {
+    m_size = n;
+    m_words.assign(numWords(n), 0);
+  }
+
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+
+  size_t
+  words() const
+  {
+    return m_words.size();
+  }
+
+
+  bool
+  operator[](size_t i) const
+  {
+    return ( ( m_words[i / 64] >> ( i % 64 ) ) & 1 ) != 0;
+  }
+
+
+  uint64_t
+  word(size_t w) const
+  {
+    return m_words[w];
+  }
+
+
+  void
+  setWord(size_t w, uint64_t bits)
+  {
+    m_words[w] = bits;
+  }
+
+
+  /// \brief Number of relevant voxels in [begin, end).
+  uint64_t
+  count(size_t begin, size_t end) const
+  {
+    uint64_t c{ 0 };
+    while (begin < end) {
+      size_t const w{ begin / 64 };
+      size_t const lo{ begin % 64 };
+      size_t const hi{ std::min<size_t>(64, lo + ( end - begin )) };
+      uint64_t bits{ m_words[w] >> lo };
+      if (hi - lo < 64) {
+        bits &= ( uint64_t(1) << ( hi - lo ) ) - 1;
+      }
+      c += std::bitset<64>(bits).count();
+      begin += hi - lo;
+    }
+    return c;
+  }
+
+
+  /// \brief Number of relevant voxels.
+  uint64_t
+  count() const
+  {
+    return count(0, m_size);
+  }
+
+
+private:
+  size_t m_size;
+  std::vector<uint64_t> m_words;
+
+}; // class RelevanceBitmap
+
+
+namespace detail
+{
+
+/// \brief Relevance of the \c count (at most 64) voxels at \c data as the
+///        bits of one word.
+template<class Ty, class Function>
+uint64_t
+relevanceWord(Ty const *data, size_t count, Function const &relevant)
+{
+  uint64_t word{ 0 };
+  for (size_t j{ 0 }; j < count; ++j) {
+    word |= static_cast<uint64_t>(relevant(data[j]) ? 1 : 0) << j;
+  }
+  return word;
+}
+
+} // namespace detail
+
+
+/// \brief tbb::parallel_for body that classifies the voxels of a Buffer
+///        into a RelevanceBitmap.
+///
+/// The range is of words of the bitmap, not of voxels, so each task owns
+/// whole words. Bit i of the bitmap is voxel i of the buffer.
+///
+/// Template parameter \c Function is any function object taking a Ty and
+/// returning true for relevant voxels.
+template<class Ty, class Function>
+class ParallelForVoxelRelevance
+{
+public:
+  /// \param map Sized for the buffer's elements, see RelevanceBitmap::reset().
+  ParallelForVoxelRelevance(RelevanceBitmap &map, Buffer<Ty> const *buf, Function relevant)
+    : m_map{ &map }
+    , m_buf{ buf }
+    , m_relevant{ relevant }
+  {
+  }
+
+
+  void
+  operator()(tbb::blocked_range<size_t> const &r) const
+  {
+    Ty const *data{ m_buf->getPtr() };
+    size_t const n{ m_buf->getNumElements() };
+    for (size_t w{ r.begin() }; w != r.end(); ++w) {
+      size_t const first{ w * 64 };
+      size_t const count{ std::min<size_t>(64, n - first) };
+      m_map->setWord(w, detail::relevanceWord(data + first, count, m_relevant));
+    }
+  }
+
+
+private:
+  RelevanceBitmap *m_map;
+  Buffer<Ty> const *m_buf;
+  Function m_relevant;
+
+}; // class ParallelForVoxelRelevance
+
+
+/// \brief tbb::parallel_reduce body that classifies the voxels of a Buffer
+///        into a RelevanceBitmap and counts the relevant voxels of each
+///        block of the volume.
+///
+/// The buffer is a run of the row-major volume starting at voxel
+/// Buffer::getIndexOffset(), as handed out by BufferedReader. Counts are
+/// kept by the block's to1D() index, which is FileBlock::block_index, only
+/// for the blocks the body's range touches, so splitting and joining cost
+/// the same for any number of blocks in the volume. Voxels outside the
+/// blocks (see BlockRuns) are classified, but not counted in any block.
+/// Like ParallelForVoxelRelevance the range is of words of the bitmap.
+template<class Ty, class Function>
+class ParallelReduceVoxelRelevance
+{
+public:
+  ParallelReduceVoxelRelevance(RelevanceBitmap &map,
+                               Buffer<Ty> const *buf,
+                               Function relevant,
+                               Volume const &volume)
+    : m_map{ &map }
+    , m_buf{ buf }
+    , m_relevant{ relevant }
+    , m_runs{ volume }
+    , m_counts{ }
+  {
+  }
+
+
+  ParallelReduceVoxelRelevance(ParallelReduceVoxelRelevance &other, tbb::split)
+    : m_map{ other.m_map }
+    , m_buf{ other.m_buf }
+    , m_relevant{ other.m_relevant }
+    , m_runs{ other.m_runs }
+    , m_counts{ }
+  {
+  }
+
+
+  void
+  operator()(tbb::blocked_range<size_t> const &r)
+  {
+    Ty const *data{ m_buf->getPtr() };
+    size_t const n{ m_buf->getNumElements() };
+    for (size_t w{ r.begin() }; w != r.end(); ++w) {
+      size_t const first{ w * 64 };
+      size_t const count{ std::min<size_t>(64, n - first) };
+      m_map->setWord(w, detail::relevanceWord(data + first, count, m_relevant));
+    }
+
+    m_runs.forEachRun(m_buf->getIndexOffset(), r.begin() * 64, std::min<size_t>(r.end() * 64, n),
+                      [this](uint64_t block, size_t runBegin, size_t runEnd) {
+      m_counts[block] += m_map->count(runBegin, runEnd);
+    });
+  }
+
+
+  void
+  join(ParallelReduceVoxelRelevance const &rhs)
+  {
+    for (auto const &c : rhs.m_counts) {
+      m_counts[c.first] += c.second;
+    }
+  }
+
+
+  /// \brief Relevant voxels of the blocks touched, by block_index.
+  std::unordered_map<uint64_t, uint64_t> const &
+  counts() const
+  {
+    return m_counts;
+  }
+
+
+  /// \brief Number of blocks in the volume.
+  uint64_t
+  numBlocks() const
+  {
+    return m_runs.numBlocks();
+  }
+
+
+private:
+  RelevanceBitmap *m_map;
+  Buffer<Ty> const *m_buf;
+  Function m_relevant;
+  BlockRuns m_runs;
+  std::unordered_map<uint64_t, uint64_t> m_counts;
+
+}; // class ParallelReduceVoxelRelevance
+
+
+/// \brief Classify the voxels of \c buf into \c map on all cores.
+/// \return The number of relevant voxels.
+template<class Ty, class Function>
+uint64_t
+parallelVoxelRelevance(Buffer<Ty> const &buf, Function relevant, RelevanceBitmap &map)
+{
+  map.reset(buf.getNumElements());
+  ParallelForVoxelRelevance<Ty, Function> body{ map, &buf, relevant };
+  tbb::parallel_for(tbb::blocked_range<size_t>{ 0, map.words(), 64 }, body);
+  return map.count();
+}
+
+
+/// \brief Classify the voxels of \c buf into \c map on all cores, and add
+///        the relevant voxels of each block of \c volume to \c counts.
+///
+/// \c counts is indexed by FileBlock::block_index and resized to the number
+/// of blocks if it is smaller, so it can collect the counts of every buffer
+/// of a volume. Relevant voxels outside the blocks are only in \c map.
+/// \return The number of relevant voxels in \c buf.
+template<class Ty, class Function>
+uint64_t
+parallelBlockRelevance(Buffer<Ty> const &buf,
+                       Function relevant,
+                       Volume const &volume,
+                       RelevanceBitmap &map,
+                       std::vector<uint64_t> &counts)
+{
+  map.reset(buf.getNumElements());
+  ParallelReduceVoxelRelevance<Ty, Function> body{ map, &buf, relevant, volume };
+  tbb::parallel_reduce(tbb::blocked_range<size_t>{ 0, map.words(), 64 }, body);
+
+  if (counts.size() < body.numBlocks()) {
+    counts.resize(body.numBlocks(), 0);
+  }
+  for (auto const &c : body.counts()) {
+    counts[c.first] += c.second;
+  }
+  return map.count();
+}
+
+
+} // namespace bd
+
+#endif // ! bd_parallelfor_voxelrelevance_h
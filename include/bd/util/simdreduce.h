@@ -0,0 +1,75 @@
+#ifndef bd_simdreduce_h
+#define bd_simdreduce_h
+
+#include <bd/io/datatypes.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bd
+{
+
+/// \brief Instruction sets the reduction kernels are built for.
+enum class SimdLevel : int
+{
+  Scalar = 0,
+  Sse2 = 1,
+  Avx2 = 2,
+  Avx512 = 3
+};
+
+
+std::string
+to_string(SimdLevel l);
+
+
+/// \brief The best SimdLevel this CPU supports (checked once).
+SimdLevel
+detectSimdLevel();
+
+
+/// \brief Min, max, sum and in-range count of a run of voxels.
+///
+/// For an empty run min is the largest double and max the lowest, like a
+/// freshly made FileBlock.
+struct ReduceResult
+{
+  double min;
+  double max;
+  double sum;
+  uint64_t inRange;  ///< Number of values v with lo <= v <= hi.
+};
+
+
+/// \brief Min, max, sum and the number of values in [lo, hi] of the \c n
+///        values at \c data, in one pass.
+///
+/// Uses the widest kernel detectSimdLevel() allows. Min, max and the count
+/// are exact. Integer sums are exact up to 2^53, float and double sums are
+/// added in double in a different order than a scalar loop would, so they
+/// may differ from one in the last bits. Results for data containing NaN
+/// are unspecified.
+///
+/// Defined for char, unsigned char, short, unsigned short, int,
+/// unsigned int, float and double.
+template<class Ty>
+ReduceResult
+reduce(Ty const *data, size_t n, double lo, double hi);
+
+
+/// \brief Like reduce(data, n, lo, hi), with a kernel no wider than \c level.
+template<class Ty>
+ReduceResult
+reduce(Ty const *data, size_t n, double lo, double hi, SimdLevel level);
+
+
+/// \brief Reduce \c n values of type \c type at \c data.
+/// \return False if \c type is DataType::Unknown.
+bool
+reduce(DataType type, void const *data, size_t n, double lo, double hi,
+       ReduceResult &result);
+
+} // namespace bd
+
+#endif // ! bd_simdreduce_h
@@ -0,0 +1,85 @@
+#ifndef bd_span_h
+#define bd_span_h
+
+#include <cstddef>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A non-owning view of \c n contiguous elements of type \c Ty.
+///
+/// Use Span<Ty const> for a read-only view. The viewed memory must outlive
+/// the span.
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+class Span
+{
+public:
+  using value_type = Ty;
+  using iterator = Ty *;
+
+
+  Span()
+    : m_data{ nullptr }
+    , m_size{ 0 }
+  { }
+
+
+  Span(Ty *data, size_t size)
+    : m_data{ data }
+    , m_size{ size }
+  { }
+
+
+  Ty *
+  data() const
+  {
+    return m_data;
+  }
+
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+
+  Ty &
+  operator[](size_t i) const
+  {
+    return m_data[i];
+  }
+
+
+  iterator
+  begin() const
+  {
+    return m_data;
+  }
+
+
+  iterator
+  end() const
+  {
+    return m_data + m_size;
+  }
+
+
+private:
+  Ty *m_data;
+  size_t m_size;
+
+}; // class Span
+
+} // namespace bd
+
+#endif // ! bd_span_h
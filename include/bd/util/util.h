@@ -24,6 +24,45 @@ void hsvToRgb(float h, float s, float v, glm::vec3& rgb);
 size_t to1D(size_t col, size_t row, size_t slab, size_t maxCols, size_t maxRows);
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Position of \c x,y,z along the Morton (Z-order) curve.
+///
+/// The bits of the coordinates are interleaved, x in the lowest bit. Each
+/// coordinate must fit in 21 bits.
+///////////////////////////////////////////////////////////////////////////////
+size_t toMorton(size_t col, size_t row, size_t slab);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert a position along the Morton curve back to \c x,y,z.
+///////////////////////////////////////////////////////////////////////////////
+void fromMorton(size_t code, size_t &col, size_t &row, size_t &slab);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Position of \c x,y,z along the Hilbert curve through a cube of
+///        2^bits on a side.
+///
+/// Unlike the Morton curve, consecutive positions are always neighbouring
+/// cells. \c bits must be between 1 and 21 and each coordinate less than
+/// 2^bits.
+///////////////////////////////////////////////////////////////////////////////
+size_t toHilbert(size_t col, size_t row, size_t slab, unsigned bits);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convert a position along the Hilbert curve of a cube of 2^bits
+///        on a side back to \c x,y,z.
+///////////////////////////////////////////////////////////////////////////////
+void fromHilbert(size_t code, unsigned bits, size_t &col, size_t &row, size_t &slab);
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Number of bits needed for coordinates less than \c n, at least 1.
+///////////////////////////////////////////////////////////////////////////////
+unsigned curveBits(size_t n);
+
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Compute product of components of \c v.
 ///////////////////////////////////////////////////////////////////////////////
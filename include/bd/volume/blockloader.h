@@ -0,0 +1,183 @@
+#ifndef bd_blockloader_h
+#define bd_blockloader_h
+
+#include <bd/datastructure/blockingqueue.h>
+#include <bd/io/indexfile.h>
+#include <bd/io/poolallocator.h>
+#include <bd/volume/block.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bd
+{
+
+
+/// \brief Loads the voxels of individual Blocks out of core, most wanted first.
+///
+/// Callers request() the blocks they need with a priority (for example the
+/// distance to the camera, lower loads sooner). A few worker threads each
+/// keep one pread(2) in flight, so several reads are outstanding at once,
+/// and read the brick of the highest priority request into a slab of
+/// memory owned by the loader. Requests that are no longer wanted can be
+/// cancelled; a cancelled request is dropped whether it is still queued,
+/// being read or waiting to be delivered.
+///
+/// Finished loads are handed to their Block with Block::pixelData() only in
+/// deliver(), so all Block updates happen on the caller's thread. The pixel
+/// data belongs to the loader: give it back with evict() once a block is no
+/// longer needed, and don't use it after the loader is destroyed.
+class BlockLoader
+{
+public:
+  /// \param index Describes the blocks and raw file layout. Must outlive the loader.
+  /// \param maxResident Number of blocks that may be loaded at once.
+  /// \param numWorkers Number of reads kept in flight.
+  BlockLoader(IndexFile const &index, size_t maxResident, int numWorkers = 4);
+
+
+  ~BlockLoader();
+
+
+  BlockLoader(BlockLoader const &) = delete;
+  BlockLoader &operator=(BlockLoader const &) = delete;
+
+
+  /// \brief Open the raw file at \c path and allocate the slabs.
+  /// \return True if opened, false otherwise.
+  bool
+  open(std::string const &path);
+
+
+  /// \brief Start the worker threads.
+  void
+  start();
+
+
+  /// \brief Stop and join the worker threads. Queued requests are kept.
+  void
+  stop();
+
+
+  /// \brief Ask for the voxels of \c b. Lower \c priority loads sooner.
+  ///
+  /// Requesting a block that is still queued updates its priority. Requests
+  /// for blocks that are being read or already have pixel data are ignored.
+  void
+  request(Block *b, float priority);
+
+
+  /// \brief Drop the request for \c b if there is one.
+  void
+  cancel(Block *b);
+
+
+  /// \brief Drop every outstanding request, for instance when the view changed.
+  void
+  cancelAll();
+
+
+  /// \brief Give finished loads to their Blocks.
+  /// \param max Deliver at most this many blocks.
+  /// \return The number of blocks that received pixel data.
+  size_t
+  deliver(size_t max = std::numeric_limits<size_t>::max());
+
+
+  /// \brief Take the pixel data from \c b and make it available for new loads.
+  void
+  evict(Block *b);
+
+
+  /// \brief Number of requests that have not been delivered or cancelled.
+  size_t
+  outstanding() const;
+
+
+  /// \brief Size in bytes of each slab (the largest brick in the index).
+  size_t
+  slabBytes() const;
+
+
+private:
+  struct Request
+  {
+    float priority;
+    uint64_t generation;  ///< Matches m_wanted[block] unless cancelled or re-requested.
+    Block *block;
+  };
+
+  struct RequestCompare
+  {
+    bool
+    operator()(Request const &a, Request const &b) const
+    {
+      // priority_queue pops the largest, we want the lowest priority value.
+      return a.priority > b.priority;
+    }
+  };
+
+  struct Want
+  {
+    uint64_t generation;
+    bool reading;         ///< A worker has taken the request.
+  };
+
+  struct Loaded
+  {
+    Block *block;
+    uint64_t generation;
+    char *data;
+  };
+
+
+  void
+  work();
+
+
+  /// \brief True if \c generation is still the live request for \c b.
+  /// \note Call with m_lock held.
+  bool
+  isWanted(Block *b, uint64_t generation) const;
+
+
+  /// \brief Put a slab back on the free list.
+  void
+  releaseSlab(char *slab);
+
+
+  IndexFile const *m_index;
+  size_t m_maxResident;
+  int m_numWorkers;
+
+  int m_fd;
+  size_t m_tySize;
+  unsigned m_halo;       ///< Halo of the bricks on disk, dropped after reading.
+  size_t m_slabBytes;
+  PoolMemory m_slabMemory;
+  std::vector<char *> m_freeSlabs;
+
+  std::priority_queue<Request, std::vector<Request>, RequestCompare> m_requests;
+  std::map<Block *, Want> m_wanted;  ///< The live request of each requested block.
+  uint64_t m_nextGeneration;
+
+  BlockingQueue<Loaded> m_loaded;
+
+  mutable std::mutex m_lock;
+  std::condition_variable m_workAvailable;
+  std::vector<std::thread> m_workers;
+  std::atomic_bool m_stop;
+
+}; // class BlockLoader
+
+} // namespace bd
+
+#endif // ! bd_blockloader_h
@@ -0,0 +1,92 @@
+#ifndef bd_opacityvisibility_h
+#define bd_opacityvisibility_h
+
+#include <bd/io/fileblock.h>
+#include <bd/volume/transferfunctionlut.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Answers in constant time whether any data value in a range gets
+///        a visible opacity.
+///
+/// Keeps a prefix sum over the entries of an OpacityLUT that are above a
+/// threshold, so a range of values is visible if the sum differs across
+/// it. The range is widened to the LUT entries on either side of its ends,
+/// so every value in it that OpacityLUT::lookup() finds visible is counted.
+///
+/// Rebuilding after a transfer function edit is one pass over the LUT, so
+/// blocks can be culled again on every edit (see isBlockVisible()).
+class OpacityVisibility
+{
+public:
+  OpacityVisibility();
+
+
+  /// \brief Visibility of \c lut, counting opacities above \c threshold.
+  explicit OpacityVisibility(OpacityLUT const &lut, double threshold = 0.0);
+
+
+  /// \brief Rebuild from \c lut.
+  void
+  update(OpacityLUT const &lut, double threshold = 0.0);
+
+
+  /// \brief True if some value in [lo, hi] has an opacity above the
+  ///        threshold. False if lo > hi.
+  bool
+  isVisible(double lo, double hi) const;
+
+
+  /// \brief Number of LUT entries with an opacity above the threshold
+  ///        between those nearest \c lo and \c hi.
+  uint64_t
+  visibleEntries(double lo, double hi) const;
+
+
+  /// \brief An n by n table of visibility for pairs of value ranges, for
+  ///        renderers that cull on the GPU.
+  ///
+  /// The LUT's entries are cut into n equal bins. Entry [i * n + j] is 1 if
+  /// some entry from the start of bin i to the end of bin j, or the one
+  /// just past either end, is visible, and 0 for i > j.
+  std::vector<uint8_t>
+  table2D(size_t n) const;
+
+
+  /// \brief Number of LUT entries covered.
+  size_t
+  size() const;
+
+
+private:
+  /// \brief Index of the LUT entry at or below data value \c v, clamped.
+  size_t
+  entryBelow(double v) const;
+
+
+  /// \brief Index of the LUT entry at or above data value \c v, clamped.
+  size_t
+  entryAbove(double v) const;
+
+
+  std::vector<uint64_t> m_prefix;  ///< m_prefix[i] is visible entries before i.
+  double m_lo;                     ///< Data value of the first entry.
+  double m_scale;                  ///< Entries per unit of data value.
+
+}; // class OpacityVisibility
+
+
+/// \brief True if any value between the min_val and max_val of \c block is
+///        visible. Blocks whose min is above their max (no statistics yet)
+///        are not.
+bool
+isBlockVisible(FileBlock const &block, OpacityVisibility const &visibility);
+
+} // namespace bd
+
+#endif // ! bd_opacityvisibility_h
@@ -0,0 +1,98 @@
+#ifndef bd_preintegratedtable_h
+#define bd_preintegratedtable_h
+
+#include <bd/volume/transferfunction.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief A 2D pre-integrated transfer function table.
+///
+/// Entry (front, back) is the color and opacity of a ray segment one step
+/// long whose scalar goes linearly from the front to the back value, so a
+/// raycaster that looks up each pair of consecutive samples in the table
+/// catches thin features between them and can take far fewer samples than
+/// point sampling the transfer functions needs. Scalar i of an axis is the
+/// normalized value i / (size - 1).
+///
+/// Each segment is integrated front to back with one sub-step per table
+/// entry it crosses, with self-attenuation, from the transfer functions
+/// sampled at the table's resolution. Opacities in the opacity function are
+/// taken as the opacity of a segment of unit length, the step size is in
+/// the same units. Entries are premultiplied RGBA floats, ready to upload
+/// as a size x size RGBA texture, front along x.
+///
+/// Rows of the table are computed in parallel. update() only recomputes
+/// the entries whose segments cross the part of the functions that changed.
+class PreIntegratedTable
+{
+public:
+  PreIntegratedTable();
+
+
+  /// \brief Compute the whole table.
+  /// \param size Entries along each axis, at least 2.
+  /// \param stepSize Length of the segment of each entry.
+  void
+  build(ColorTransferFunction const &color,
+        OpacityTransferFunction const &opacity,
+        size_t size = 256,
+        double stepSize = 1.0);
+
+
+  /// \brief Resample the functions and recompute the entries that change.
+  /// \return The number of entries recomputed.
+  size_t
+  update(ColorTransferFunction const &color, OpacityTransferFunction const &opacity);
+
+
+  size_t
+  size() const;
+
+
+  double
+  stepSize() const;
+
+
+  /// \brief The size * size RGBA entries, row by row of back values.
+  float const *
+  data() const;
+
+
+  /// \brief The RGBA of the segment from scalar index \c front to \c back.
+  float const *
+  entry(size_t front, size_t back) const;
+
+
+private:
+  /// \brief Sample the functions at the table's scalars.
+  void
+  sample(ColorTransferFunction const &color,
+         OpacityTransferFunction const &opacity,
+         std::vector<float> &rgbTau) const;
+
+
+  /// \brief Recompute the entries whose segments cross scalar indices
+  ///        [lo, hi], in parallel over rows.
+  size_t
+  integrate(size_t lo, size_t hi);
+
+
+  /// \brief Integrate the segment from \c front to \c back into \c rgba.
+  void
+  integrateEntry(size_t front, size_t back, float *rgba) const;
+
+
+  size_t m_size;
+  double m_stepSize;
+  std::vector<float> m_rgbTau;  ///< Color and extinction at each scalar.
+  std::vector<float> m_table;   ///< size * size RGBA.
+
+}; // class PreIntegratedTable
+
+} // namespace bd
+
+#endif // ! bd_preintegratedtable_h
@@ -0,0 +1,178 @@
+#ifndef bd_transferfunctionlut_h
+#define bd_transferfunctionlut_h
+
+#include <bd/volume/transferfunction.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace bd
+{
+
+/// \brief Entries in a TransferFunctionLUT made for a type with no entry
+///        per value.
+size_t const TF_LUT_DEFAULT_SIZE{ 4096 };
+
+
+/// \brief A transfer function baked into a table of evenly spaced samples.
+///
+/// The table spans the data values [lo, hi], entry i holding the function
+/// at the normalized scalar i / (size - 1). lookup() takes the nearest
+/// entry to a data value, clamped to the ends of the table, with no
+/// branches on the value, so classifying a voxel is one multiply-add and a
+/// load instead of a walk over the knots.
+///
+/// forType() makes a table with one entry per value for 8 and 16 bit
+/// integer types, which then gives the same result as interpolate() for
+/// every voxel value.
+///
+/// Template parameter \c Value is the type the function gives, double for
+/// an OpacityTransferFunction and Color for a ColorTransferFunction.
+template<class Value>
+class TransferFunctionLUT
+{
+public:
+  TransferFunctionLUT()
+    : m_table{ Value() }
+    , m_lo{ 0.0 }
+    , m_hi{ 1.0 }
+    , m_scale{ 0.0 }
+    , m_last{ 0.0 }
+  {
+  }
+
+
+  /// \brief Bake \c f over the data values [lo, hi] into \c size entries.
+  /// \param f The function, with scalars normalized to [lo, hi].
+  /// \param size Number of entries, at least 2.
+  template<class Knot>
+  TransferFunctionLUT(TransferFunction<Knot, Value> const &f,
+                      size_t size = TF_LUT_DEFAULT_SIZE,
+                      double lo = 0.0,
+                      double hi = 1.0)
+    : TransferFunctionLUT()
+  {
+    bake(f, size, lo, hi, lo, hi);
+  }
+
+
+  /// \brief A table for voxels of type \c Ty whose data range is
+  ///        [dataMin, dataMax].
+  ///
+  /// For 8 and 16 bit integers there is an entry for every value of the
+  /// type, values outside the data range getting the function at the
+  /// nearest end of it. Other types get TF_LUT_DEFAULT_SIZE entries over
+  /// the data range.
+  template<class Ty, class Knot>
+  static TransferFunctionLUT
+  forType(TransferFunction<Knot, Value> const &f, Ty dataMin, Ty dataMax)
+  {
+    TransferFunctionLUT lut;
+    if (std::is_integral<Ty>::value && sizeof(Ty) <= 2) {
+      double const lo{ static_cast<double>(std::numeric_limits<Ty>::lowest()) };
+      double const hi{ static_cast<double>(std::numeric_limits<Ty>::max()) };
+      lut.bake(f, static_cast<size_t>(hi - lo) + 1, lo, hi, dataMin, dataMax);
+    } else {
+      lut.bake(f, TF_LUT_DEFAULT_SIZE, dataMin, dataMax, dataMin, dataMax);
+    }
+    return lut;
+  }
+
+
+  /// \brief The entry nearest data value \c v, clamped to the table.
+  Value const &
+  lookup(double v) const
+  {
+    // max(0, x) first so NaN ends up at entry 0.
+    double x{ ( v - m_lo ) * m_scale + 0.5 };
+    x = std::max(0.0, x);
+    x = std::min(m_last, x);
+    return m_table[static_cast<size_t>(x)];
+  }
+
+
+  Value const &
+  operator[](size_t i) const
+  {
+    return m_table[i];
+  }
+
+
+  size_t
+  size() const
+  {
+    return m_table.size();
+  }
+
+
+  Value const *
+  data() const
+  {
+    return m_table.data();
+  }
+
+
+  /// \brief Data value of the first entry.
+  double
+  lo() const
+  {
+    return m_lo;
+  }
+
+
+  /// \brief Data value of the last entry.
+  double
+  hi() const
+  {
+    return m_hi;
+  }
+
+
+private:
+  /// \brief Fill \c size entries over the data values [lo, hi] with \c f,
+  ///        normalizing each by the data range [dataMin, dataMax].
+  template<class Knot>
+  void
+  bake(TransferFunction<Knot, Value> const &f,
+       size_t size,
+       double lo,
+       double hi,
+       double dataMin,
+       double dataMax)
+  {
+    size = std::max<size_t>(size, 2);
+    m_table.resize(size);
+    m_lo = lo;
+    m_hi = hi;
+    m_scale = hi > lo ? ( size - 1 ) / ( hi - lo ) : 0.0;
+    m_last = static_cast<double>(size - 1);
+
+    double const range{ dataMax - dataMin };
+    for (size_t i{ 0 }; i < size; ++i) {
+      double const v{ lo + ( hi - lo ) * i / ( size - 1 ) };
+      double s{ range > 0.0 ? ( v - dataMin ) / range : 0.0 };
+      s = std::min(1.0, std::max(0.0, s));
+      m_table[i] = f.interpolate(s);
+    }
+  }
+
+
+  std::vector<Value> m_table;
+  double m_lo;
+  double m_hi;
+  double m_scale;  ///< Entries per unit of data value.
+  double m_last;   ///< Index of the last entry.
+
+}; // class TransferFunctionLUT
+
+
+using OpacityLUT = TransferFunctionLUT<double>;
+using ColorLUT = TransferFunctionLUT<Color>;
+
+} // namespace bd
+
+#endif // ! bd_transferfunctionlut_h
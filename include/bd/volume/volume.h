@@ -11,6 +11,17 @@
 
 namespace bd
 {
+
+/// \brief What to do with the voxels left over when the voxel dimensions
+///        aren't a multiple of the block count.
+enum class EdgeBlocks
+{
+  Drop,   ///< Every block is voxelDims / numBlocks, the remainder isn't covered.
+  Ragged  ///< Blocks are ceil(voxelDims / numBlocks) and the last block along
+          ///< each axis only covers what is left.
+};
+
+
 class Volume
 {
 public:
@@ -31,6 +42,13 @@ public:
   block_dims() const;
 
 
+  /// \brief Set the number of voxels in each block.
+  /// \note block_count() and voxelDims() work the block dimensions out
+  ///       again, so set them first.
+  void
+  block_dims(glm::u64vec3 const &);
+
+
   /// \brief Get/Set the number of blocks along each axis.
   glm::u64vec3 const&
   block_count() const;
@@ -40,6 +58,22 @@ public:
   void
   block_count(glm::u64vec3 const &);
 
+
+  /// \brief Set the number of blocks along each axis, handling the remainder
+  ///        voxels as \c edges says.
+  ///
+  /// With EdgeBlocks::Ragged the block count may come out lower than \c nb
+  /// along an axis where ceil(voxelDims / nb) blocks already cover it, like
+  /// 9 voxels in 4 blocks, which takes 3 blocks of 3.
+  /// \note Set the voxel dimensions first, voxelDims() divides again.
+  void
+  block_count(glm::u64vec3 const &nb, EdgeBlocks edges);
+
+
+  /// \brief True if the last block along some axis is smaller than the others.
+  bool
+  hasRaggedBlocks() const;
+
   /// \brief Calculate the total number of blocks in this volume.
   uint64_t
   total_block_count() const;
@@ -145,7 +179,7 @@ public:
   ///
   /// If volume voxel dimensions are not divisible by the number of
   /// blocks, then the blocks may not span the entire extent of the
-  /// volume's voxels.
+  /// volume's voxels, unless they were made with EdgeBlocks::Ragged.
   ///
   /// \return x, y, z dims of the voxel extent.
   glm::u64vec3
@@ -0,0 +1,276 @@
+#include <bd/io/blockhistograms.h>
+#include <bd/io/blockio.h>
+#include <bd/io/brickedvolume.h>
+#include <bd/io/datatypes.h>
+#include <bd/log/logger.h>
+
+#include <glm/glm.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace bd
+{
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+addBrick(BlockHistograms &h, size_t block, std::vector<char> const &brick, size_t bytes)
+{
+  h.add(block, reinterpret_cast<Ty const *>(brick.data()), bytes / sizeof(Ty));
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockHistograms::BlockHistograms()
+  : BlockHistograms(0, 2, 0.0, 1.0)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockHistograms::BlockHistograms(size_t numBlocks, uint32_t bins,
+                                 double dataMin, double dataMax)
+  : m_numBlocks{ numBlocks }
+  , m_bins{ bins < 2 ? 2 : bins }
+  , m_dataMin{ dataMin }
+  , m_dataMax{ dataMax }
+  , m_scale{ dataMax > dataMin ? ( m_bins - 1 ) / ( dataMax - dataMin ) : 0.0 }
+  , m_counts(numBlocks * m_bins, 0)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+BlockHistograms::binOf(double value) const
+{
+  double const b{ std::round(( value - m_dataMin ) * m_scale) };
+  if (! ( b > 0.0 )) {
+    return 0;
+  }
+  return b >= m_bins - 1 ? m_bins - 1 : static_cast<uint32_t>(b);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+BlockHistograms::binValue(uint32_t b) const
+{
+  return static_cast<double>(b) / ( m_bins - 1 );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t const *
+BlockHistograms::counts(size_t block) const
+{
+  return m_counts.data() + block * m_bins;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockHistograms::numBlocks() const
+{
+  return m_numBlocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+BlockHistograms::bins() const
+{
+  return m_bins;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+BlockHistograms::dataMin() const
+{
+  return m_dataMin;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+BlockHistograms::dataMax() const
+{
+  return m_dataMax;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockHistograms::store(IndexFile &index) const
+{
+  if (m_numBlocks != index.blocks().size()) {
+    Err() << "Have histograms for " << m_numBlocks << " blocks, but the index has "
+          << index.blocks().size();
+    return false;
+  }
+
+  SectionHeader h;
+  h.bins = m_bins;
+  h.count_bytes = sizeof(uint32_t);
+  h.num_blocks = m_numBlocks;
+  h.data_min = m_dataMin;
+  h.data_max = m_dataMax;
+
+  size_t const countBytes{ m_counts.size() * sizeof(uint32_t) };
+  std::vector<char> bytes(sizeof(SectionHeader) + countBytes);
+  memcpy(bytes.data(), &h, sizeof(SectionHeader));
+  memcpy(bytes.data() + sizeof(SectionHeader), m_counts.data(), countBytes);
+
+  return index.setSection(SectionType::Histograms, std::move(bytes));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockHistograms::load(IndexFile const &index)
+{
+  Span<char const> const bytes{ index.section(SectionType::Histograms) };
+  if (bytes.size() < sizeof(SectionHeader)) {
+    Err() << "The index has no block histograms.";
+    return false;
+  }
+
+  SectionHeader h;
+  memcpy(&h, bytes.data(), sizeof(SectionHeader));
+  if (h.count_bytes != sizeof(uint32_t) || h.bins < 2 ||
+      h.num_blocks != index.blocks().size() ||
+      bytes.size() != sizeof(SectionHeader) + h.num_blocks * h.bins * sizeof(uint32_t)) {
+    Err() << "The block histograms don't match the blocks of the index.";
+    return false;
+  }
+
+  *this = BlockHistograms(h.num_blocks, h.bins, h.data_min, h.data_max);
+  memcpy(m_counts.data(), bytes.data() + sizeof(SectionHeader),
+         m_counts.size() * sizeof(uint32_t));
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+buildBlockHistograms(IndexFile const &index,
+                     std::string const &path,
+                     BlockHistograms &histograms)
+{
+  DataType const type{ IndexFileHeader::getType(index.getHeader()) };
+  size_t const tySize{ to_sizeType(type) };
+  glm::u64vec3 const volDims{ index.getVolume().voxelDims() };
+  Span<FileBlock const> const blocks{ index.blocks() };
+
+  if (histograms.numBlocks() != blocks.size()) {
+    Err() << "Have histograms for " << histograms.numBlocks() << " blocks, but the index has "
+          << blocks.size();
+    return false;
+  }
+
+  int fd{ ::open(path.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    Err() << "Unable to open file: " + path;
+    return false;
+  }
+
+  unsigned const halo{ brickHalo(index) };
+  std::vector<char> brick;
+  std::vector<char> scratch;
+  bool ok{ true };
+  for (size_t i{ 0 }; i < blocks.size() && ok; ++i) {
+    brick.resize(fileBlockBrickBytes(blocks[i], tySize, halo));
+    long long bytes{ readBlockData(fd, index.getHeader(), blocks[i], volDims, tySize,
+                                   brick.data(), scratch, halo) };
+    if (bytes < 0) {
+      Err() << "Could not read block " << blocks[i].block_index << " from " << path;
+      ok = false;
+      break;
+    }
+
+    // Halo voxels belong to the neighbours' histograms.
+    stripHalo(brick.data(), blocks[i], tySize, halo);
+    size_t const n{ fileBlockBrickBytes(blocks[i], tySize) };
+    switch (type) {
+      case DataType::Character:         addBrick<char>(histograms, i, brick, n); break;
+      case DataType::UnsignedCharacter: addBrick<unsigned char>(histograms, i, brick, n); break;
+      case DataType::Short:             addBrick<short>(histograms, i, brick, n); break;
+      case DataType::UnsignedShort:     addBrick<unsigned short>(histograms, i, brick, n); break;
+      case DataType::Integer:           addBrick<int>(histograms, i, brick, n); break;
+      case DataType::UnsignedInteger:   addBrick<unsigned int>(histograms, i, brick, n); break;
+      case DataType::Float:             addBrick<float>(histograms, i, brick, n); break;
+      case DataType::Double:            addBrick<double>(histograms, i, brick, n); break;
+      default:
+        Err() << "Can't histogram data of type " << to_string(type);
+        ok = false;
+        break;
+    }
+  }
+
+  ::close(fd);
+  return ok;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+updateRelevance(IndexFile &index,
+                BlockHistograms const &histograms,
+                OpacityTransferFunction const &otf,
+                double minOpacity,
+                double maxOpacity,
+                double minRov)
+{
+  uint32_t const bins{ histograms.bins() };
+
+  // Classify each bin once, every block then just sums its relevant counts.
+  std::vector<uint32_t> relevant(bins);
+  for (uint32_t b{ 0 }; b < bins; ++b) {
+    double const a{ otf.interpolate(histograms.binValue(b)) };
+    relevant[b] = a >= minOpacity && a < maxOpacity ? 1 : 0;
+  }
+
+  std::vector<FileBlock> &blocks = index.getFileBlocks();
+  uint64_t volEmpty{ 0 };
+  double rovMin{ std::numeric_limits<double>::max() };
+  double rovMax{ std::numeric_limits<double>::lowest() };
+
+  for (size_t i{ 0 }; i < blocks.size() && i < histograms.numBlocks(); ++i) {
+    uint32_t const *c{ histograms.counts(i) };
+    uint64_t total{ 0 };
+    uint64_t rel{ 0 };
+    for (uint32_t b{ 0 }; b < bins; ++b) {
+      total += c[b];
+      rel += c[b] * relevant[b];
+    }
+
+    FileBlock &fb = blocks[i];
+    fb.empty_voxels = total - rel;
+    fb.rov = total > 0 ? static_cast<double>(rel) / total : 0.0;
+    fb.is_empty = ( rel == 0 || fb.rov < minRov ) ? 1 : 0;
+
+    volEmpty += fb.empty_voxels;
+    rovMin = std::min(rovMin, fb.rov);
+    rovMax = std::max(rovMax, fb.rov);
+  }
+
+  index.getVolume().numEmptyVoxels(volEmpty);
+  if (! blocks.empty()) {
+    index.getVolume().rovMin(rovMin);
+    index.getVolume().rovMax(rovMax);
+  }
+}
+
+} // namespace bd
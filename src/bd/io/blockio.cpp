@@ -0,0 +1,251 @@
+#include <bd/io/blockio.h>
+#include <bd/io/posixio.h>
+#include <bd/log/logger.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace bd
+{
+
+namespace
+{
+
+/// Coalesce the rows of a slab into one read unless it would read more than
+/// this many times the bytes actually needed.
+size_t const MAX_COALESCE_WASTE{ 4 };
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Spread the \c w voxels at the start of \c brick out to the \c p
+///        voxels of a haloed brick, repeating edge voxels into the halo.
+///
+/// \c off is where the w voxels start within the haloed brick. Rows are
+/// moved last to first, which never overwrites a row that is still to be
+/// moved, since no voxel moves to a lower address.
+void
+expandHalo(char *brick, glm::u64vec3 const &w, glm::u64vec3 const &p,
+           glm::u64vec3 const &off, size_t tySize)
+{
+  auto clampTo = [](uint64_t v, uint64_t o, uint64_t n) -> uint64_t {
+    return v < o ? 0 : std::min(v - o, n - 1);
+  };
+
+  size_t const rowBytes{ w.x * tySize };
+  size_t const leftBytes{ off.x * tySize };
+  size_t const rightBytes{ ( p.x - off.x - w.x ) * tySize };
+  char first[8];
+  char last[8];
+
+  for (uint64_t z{ p.z }; z-- > 0;) {
+    uint64_t const cz{ clampTo(z, off.z, w.z) };
+    for (uint64_t y{ p.y }; y-- > 0;) {
+      uint64_t const cy{ clampTo(y, off.y, w.y) };
+      char const *src{ brick + ( cz * w.y + cy ) * rowBytes };
+      char *dst{ brick + ( z * p.y + y ) * p.x * tySize };
+
+      memcpy(first, src, tySize);
+      memcpy(last, src + rowBytes - tySize, tySize);
+      memmove(dst + leftBytes, src, rowBytes);
+      for (size_t b{ 0 }; b < leftBytes; b += tySize) {
+        memcpy(dst + b, first, tySize);
+      }
+      for (size_t b{ 0 }; b < rightBytes; b += tySize) {
+        memcpy(dst + leftBytes + rowBytes + b, last, tySize);
+      }
+    }
+  }
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+fileBlockBrickBytes(FileBlock const &block, size_t tySize, unsigned halo)
+{
+  return ( block.voxel_dims[0] + 2 * halo ) *
+         ( block.voxel_dims[1] + 2 * halo ) *
+         ( block.voxel_dims[2] + 2 * halo ) * tySize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+stripHalo(char *brick, FileBlock const &block, size_t tySize, unsigned halo)
+{
+  if (halo == 0) {
+    return;
+  }
+
+  size_t const bx{ block.voxel_dims[0] };
+  size_t const by{ block.voxel_dims[1] };
+  size_t const bz{ block.voxel_dims[2] };
+  size_t const px{ bx + 2 * halo };
+  size_t const py{ by + 2 * halo };
+  size_t const rowBytes{ bx * tySize };
+
+  // Rows only move towards the start of the brick.
+  for (size_t z{ 0 }; z < bz; ++z) {
+    for (size_t y{ 0 }; y < by; ++y) {
+      char const *src{ brick + ( ( ( z + halo ) * py + y + halo ) * px + halo ) * tySize };
+      memmove(brick + ( z * by + y ) * rowBytes, src, rowBytes);
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+readFileBlock(int fd,
+              FileBlock const &block,
+              glm::u64vec3 const &volDims,
+              size_t tySize,
+              char *dst,
+              std::vector<char> &scratch,
+              unsigned halo)
+{
+  if (halo > 0) {
+    glm::u64vec3 const dims{ block.voxel_dims[0], block.voxel_dims[1], block.voxel_dims[2] };
+    if (dims.x == 0 || dims.y == 0 || dims.z == 0) {
+      return 0;
+    }
+
+    // First voxel of the block, from its offset into the row-major file.
+    uint64_t const first{ block.data_offset / tySize };
+    glm::u64vec3 const start{ first % volDims.x,
+                              ( first / volDims.x ) % volDims.y,
+                              first / ( volDims.x * volDims.y ) };
+
+    // The part of the haloed block that is inside the volume.
+    glm::u64vec3 const h{ halo };
+    glm::u64vec3 const lo{ start - glm::min(start, h) };
+    glm::u64vec3 const hi{ glm::min(start + dims + h, volDims) };
+
+    FileBlock inside{ block };
+    inside.data_offset = tySize * ( lo.x + volDims.x * ( lo.y + volDims.y * lo.z ) );
+    inside.voxel_dims[0] = hi.x - lo.x;
+    inside.voxel_dims[1] = hi.y - lo.y;
+    inside.voxel_dims[2] = hi.z - lo.z;
+
+    if (readFileBlock(fd, inside, volDims, tySize, dst, scratch) < 0) {
+      return -1;
+    }
+
+    glm::u64vec3 const padded{ dims + h + h };
+    expandHalo(dst, hi - lo, padded, h - ( start - lo ), tySize);
+    return static_cast<long long>(fileBlockBrickBytes(block, tySize, halo));
+  }
+
+  size_t const bx{ block.voxel_dims[0] };
+  size_t const by{ block.voxel_dims[1] };
+  size_t const bz{ block.voxel_dims[2] };
+
+  size_t const rowBytes{ bx * tySize };
+  size_t const fileRowBytes{ volDims.x * tySize };
+  size_t const fileSlabBytes{ volDims.x * volDims.y * tySize };
+  size_t const brickSlabBytes{ rowBytes * by };
+
+  if (bx == 0 || by == 0 || bz == 0) {
+    return 0;
+  }
+
+  // Whole block is one contiguous run of the file.
+  if (bx == volDims.x && by == volDims.y) {
+    if (! preadAll(fd, dst, brickSlabBytes * bz, block.data_offset)) {
+      return -1;
+    }
+    return static_cast<long long>(brickSlabBytes * bz);
+  }
+
+  // Bytes covered by one slab, from the start of its first row to the end of its last.
+  size_t const spanBytes{ ( by - 1 ) * fileRowBytes + rowBytes };
+  bool const contiguousRows{ bx == volDims.x };
+  bool const coalesce{ contiguousRows || spanBytes <= MAX_COALESCE_WASTE * brickSlabBytes };
+  if (coalesce && ! contiguousRows && scratch.size() < spanBytes) {
+    scratch.resize(spanBytes);
+  }
+
+  for (size_t z{ 0 }; z < bz; ++z) {
+    uint64_t const slabOffset{ block.data_offset + z * fileSlabBytes };
+    char *slabDst{ dst + z * brickSlabBytes };
+
+    if (contiguousRows) {
+      if (! preadAll(fd, slabDst, brickSlabBytes, slabOffset)) {
+        return -1;
+      }
+    } else if (coalesce) {
+      if (! preadAll(fd, scratch.data(), spanBytes, slabOffset)) {
+        return -1;
+      }
+      for (size_t y{ 0 }; y < by; ++y) {
+        memcpy(slabDst + y * rowBytes, scratch.data() + y * fileRowBytes, rowBytes);
+      }
+    } else {
+      for (size_t y{ 0 }; y < by; ++y) {
+        if (! preadAll(fd, slabDst + y * rowBytes, rowBytes, slabOffset + y * fileRowBytes)) {
+          return -1;
+        }
+      }
+    }
+  }
+
+  return static_cast<long long>(brickSlabBytes * bz);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+readBlockData(int fd,
+              IndexFileHeader const &header,
+              FileBlock const &block,
+              glm::u64vec3 const &volDims,
+              size_t tySize,
+              char *dst,
+              std::vector<char> &scratch,
+              unsigned halo)
+{
+  if (IndexFileHeader::getStorage(header) != BlockStorage::Bricked) {
+    return readFileBlock(fd, block, volDims, tySize, dst, scratch, halo);
+  }
+
+  size_t const brickBytes{ fileBlockBrickBytes(block, tySize, halo) };
+  if (block.data_bytes == 0) {
+    memset(dst, 0, brickBytes);
+    return static_cast<long long>(brickBytes);
+  }
+
+  // Bricks that didn't shrink were stored as they are.
+  if (block.data_bytes == brickBytes) {
+    if (! preadAll(fd, dst, brickBytes, block.data_offset)) {
+      return -1;
+    }
+    return static_cast<long long>(brickBytes);
+  }
+
+  Codec const codec{ IndexFileHeader::getCodec(header) };
+  if (codec == Codec::None || block.data_bytes > brickBytes) {
+    Err() << "Block " << block.block_index << " has " << block.data_bytes
+          << " bytes on disk, expected " << brickBytes;
+    return -1;
+  }
+
+  if (scratch.size() < block.data_bytes) {
+    scratch.resize(block.data_bytes);
+  }
+  if (! preadAll(fd, scratch.data(), block.data_bytes, block.data_offset)) {
+    return -1;
+  }
+
+  long long n{ decompressChunk(codec, scratch.data(), block.data_bytes, dst, brickBytes) };
+  if (n >= 0 && static_cast<size_t>(n) != brickBytes) {
+    Err() << "Block " << block.block_index << " decompressed to " << n
+          << " bytes, expected " << brickBytes;
+    return -1;
+  }
+  return n;
+}
+
+} // namespace bd
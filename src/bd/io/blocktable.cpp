@@ -0,0 +1,222 @@
+#include <bd/io/blocktable.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace bd
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockTable::BlockTable()
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockTable::BlockTable(IndexFile const &index)
+  : BlockTable(index.blocks())
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockTable::BlockTable(Span<FileBlock const> blocks)
+{
+  size_t const n{ blocks.size() };
+  blockIndex.resize(n);
+  i.resize(n);
+  j.resize(n);
+  k.resize(n);
+  dataOffset.resize(n);
+  dataBytes.resize(n);
+  minVal.resize(n);
+  maxVal.resize(n);
+  avgVal.resize(n);
+  totalVal.resize(n);
+  rov.resize(n);
+  emptyVoxels.resize(n);
+  isEmpty.resize(n);
+  worldMinX.resize(n);
+  worldMinY.resize(n);
+  worldMinZ.resize(n);
+  worldMaxX.resize(n);
+  worldMaxY.resize(n);
+  worldMaxZ.resize(n);
+
+  for (size_t r{ 0 }; r < n; ++r) {
+    FileBlock const &b{ blocks[r] };
+    blockIndex[r] = b.block_index;
+    i[r] = static_cast<uint32_t>(b.ijk_index[0]);
+    j[r] = static_cast<uint32_t>(b.ijk_index[1]);
+    k[r] = static_cast<uint32_t>(b.ijk_index[2]);
+    dataOffset[r] = b.data_offset;
+    dataBytes[r] = b.data_bytes;
+    minVal[r] = b.min_val;
+    maxVal[r] = b.max_val;
+    avgVal[r] = b.avg_val;
+    totalVal[r] = b.total_val;
+    rov[r] = b.rov;
+    emptyVoxels[r] = b.empty_voxels;
+    isEmpty[r] = b.is_empty ? 1 : 0;
+    worldMinX[r] = b.world_oigin[0] - 0.5 * b.world_dims[0];
+    worldMinY[r] = b.world_oigin[1] - 0.5 * b.world_dims[1];
+    worldMinZ[r] = b.world_oigin[2] - 0.5 * b.world_dims[2];
+    worldMaxX[r] = b.world_oigin[0] + 0.5 * b.world_dims[0];
+    worldMaxY[r] = b.world_oigin[1] + 0.5 * b.world_dims[1];
+    worldMaxZ[r] = b.world_oigin[2] + 0.5 * b.world_dims[2];
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::size() const
+{
+  return blockIndex.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<double> const &
+BlockTable::column(BlockStat s) const
+{
+  switch (s) {
+    case BlockStat::Min: return minVal;
+    case BlockStat::Max: return maxVal;
+    case BlockStat::Total: return totalVal;
+    case BlockStat::Rov: return rov;
+    case BlockStat::Avg:
+    default: return avgVal;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockTable::inRangeMask(BlockStat s, double lo, double hi, std::vector<uint8_t> &mask) const
+{
+  std::vector<double> const &col{ column(s) };
+  size_t const n{ col.size() };
+  mask.resize(n);
+
+  double const *v{ col.data() };
+  uint8_t *m{ mask.data() };
+  for (size_t r{ 0 }; r < n; ++r) {
+    m[r] = static_cast<uint8_t>(( v[r] >= lo ) & ( v[r] <= hi ));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::countInRange(BlockStat s, double lo, double hi) const
+{
+  std::vector<double> const &col{ column(s) };
+  size_t const n{ col.size() };
+
+  double const *v{ col.data() };
+  size_t count{ 0 };
+  for (size_t r{ 0 }; r < n; ++r) {
+    count += static_cast<size_t>(( v[r] >= lo ) & ( v[r] <= hi ));
+  }
+  return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::filterInRange(BlockStat s, double lo, double hi, std::vector<size_t> &out) const
+{
+  std::vector<double> const &col{ column(s) };
+  size_t const n{ col.size() };
+  out.resize(n);
+
+  // Always store, only advance on a hit, so there is no branch to mispredict.
+  double const *v{ col.data() };
+  size_t *o{ out.data() };
+  size_t count{ 0 };
+  for (size_t r{ 0 }; r < n; ++r) {
+    o[count] = r;
+    count += static_cast<size_t>(( v[r] >= lo ) & ( v[r] <= hi ));
+  }
+
+  out.resize(count);
+  return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::filterOverlapping(double lo, double hi, std::vector<size_t> &out) const
+{
+  size_t const n{ size() };
+  out.resize(n);
+
+  double const *mn{ minVal.data() };
+  double const *mx{ maxVal.data() };
+  size_t *o{ out.data() };
+  size_t count{ 0 };
+  for (size_t r{ 0 }; r < n; ++r) {
+    o[count] = r;
+    count += static_cast<size_t>(( mn[r] <= hi ) & ( mx[r] >= lo ));
+  }
+
+  out.resize(count);
+  return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::countEmpty() const
+{
+  size_t const n{ isEmpty.size() };
+  uint8_t const *e{ isEmpty.data() };
+  size_t count{ 0 };
+  for (size_t r{ 0 }; r < n; ++r) {
+    count += e[r];
+  }
+  return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockTable::filterNonEmpty(std::vector<size_t> &out) const
+{
+  size_t const n{ isEmpty.size() };
+  out.resize(n);
+
+  uint8_t const *e{ isEmpty.data() };
+  size_t *o{ out.data() };
+  size_t count{ 0 };
+  for (size_t r{ 0 }; r < n; ++r) {
+    o[count] = r;
+    count += static_cast<size_t>(e[r] ^ 1);
+  }
+
+  out.resize(count);
+  return count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockTable::argsort(BlockStat s, std::vector<size_t> &out, bool descending) const
+{
+  std::vector<double> const &col{ column(s) };
+  out.resize(col.size());
+  std::iota(out.begin(), out.end(), 0);
+
+  if (descending) {
+    std::stable_sort(out.begin(), out.end(),
+                     [&col](size_t a, size_t b) { return col[a] > col[b]; });
+  } else {
+    std::stable_sort(out.begin(), out.end(),
+                     [&col](size_t a, size_t b) { return col[a] < col[b]; });
+  }
+}
+
+
+} // namespace bd
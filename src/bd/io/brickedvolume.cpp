@@ -0,0 +1,169 @@
+#include <bd/io/brickedvolume.h>
+#include <bd/io/blockio.h>
+#include <bd/io/datatypes.h>
+#include <bd/log/logger.h>
+
+#include <glm/glm.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace bd
+{
+
+namespace
+{
+
+/// \brief The Bricks section.
+struct BrickLayout
+{
+  uint32_t halo;       ///< Halo width in voxels.
+  uint32_t reserved[3];
+};
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+writeBrickedVolume(IndexFile &index,
+                   std::string const &rawPath,
+                   std::string const &brickPath,
+                   Codec codec,
+                   int level,
+                   bool skipEmpty,
+                   unsigned halo)
+{
+  IndexFileHeader const &header{ index.getHeader() };
+  if (IndexFileHeader::getStorage(header) != BlockStorage::RowMajor) {
+    Err() << "Only row-major raw files can be bricked.";
+    return false;
+  }
+  if (! codecAvailable(codec)) {
+    Err() << "Codec " << to_string(codec) << " is not available in this build.";
+    return false;
+  }
+  if (halo > MAX_BRICK_HALO) {
+    Err() << "A halo of " << halo << " voxels is wider than the most allowed, "
+          << MAX_BRICK_HALO << ".";
+    return false;
+  }
+
+  size_t const tySize{ to_sizeType(IndexFileHeader::getType(header)) };
+  glm::u64vec3 const volDims{ index.getVolume().voxelDims() };
+
+  int fd{ ::open(rawPath.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    Err() << "Unable to open file: " + rawPath;
+    return false;
+  }
+
+  std::ofstream out(brickPath, std::ios::binary | std::ios::trunc);
+  if (! out.is_open()) {
+    Err() << "Unable to open file: " + brickPath;
+    ::close(fd);
+    return false;
+  }
+
+  // New offsets are kept aside until every brick is out.
+  Span<FileBlock const> const current{ index.blocks() };
+  std::vector<FileBlock> blocks(current.begin(), current.end());
+  std::vector<char> brick;
+  std::vector<char> packed;
+  std::vector<char> scratch;
+  uint64_t offset{ 0 };
+  uint64_t rawTotal{ 0 };
+  bool ok{ true };
+
+  for (FileBlock &b : blocks) {
+    size_t const brickBytes{ fileBlockBrickBytes(b, tySize, halo) };
+    rawTotal += brickBytes;
+
+    if (skipEmpty && b.is_empty) {
+      b.data_offset = offset;
+      b.data_bytes = 0;
+      continue;
+    }
+
+    brick.resize(brickBytes);
+    if (readFileBlock(fd, b, volDims, tySize, brick.data(), scratch, halo) < 0) {
+      Err() << "Could not read block " << b.block_index << " from " << rawPath;
+      ok = false;
+      break;
+    }
+
+    char const *data{ brick.data() };
+    size_t bytes{ brickBytes };
+    if (codec != Codec::None) {
+      packed.resize(compressBound(codec, brickBytes));
+      long long n{ compressChunk(codec, brick.data(), brickBytes,
+                                 packed.data(), packed.size(), level) };
+      if (n < 0) {
+        Err() << "Could not compress block " << b.block_index;
+        ok = false;
+        break;
+      }
+      // readBlockData() takes a full sized brick to be uncompressed.
+      if (static_cast<size_t>(n) < brickBytes) {
+        data = packed.data();
+        bytes = static_cast<size_t>(n);
+      }
+    }
+
+    out.write(data, static_cast<std::streamsize>(bytes));
+    b.data_offset = offset;
+    b.data_bytes = bytes;
+    offset += bytes;
+  }
+
+  ::close(fd);
+  out.flush();
+  if (ok && ! out) {
+    Err() << "Could not write " << brickPath;
+    ok = false;
+  }
+  if (! ok) {
+    return false;
+  }
+
+  index.getFileBlocks() = blocks;
+  index.setStorage(BlockStorage::Bricked, codec);
+  index.setRawFileName(brickPath);
+  if (halo > 0) {
+    BrickLayout layout{};
+    layout.halo = halo;
+    char const *p{ reinterpret_cast<char const *>(&layout) };
+    index.setSection(SectionType::Bricks, std::vector<char>(p, p + sizeof(layout)));
+  } else {
+    index.removeSection(SectionType::Bricks);
+  }
+
+  Info() << "Bricked " << blocks.size() << " blocks, " << rawTotal << " bytes into "
+         << offset << " bytes (" << to_string(codec) << ", halo " << halo << ").";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned
+brickHalo(IndexFile const &index)
+{
+  if (IndexFileHeader::getStorage(index.getHeader()) != BlockStorage::Bricked) {
+    return 0;
+  }
+
+  BrickLayout layout{};
+  Span<char const> const bytes{ index.section(SectionType::Bricks) };
+  if (bytes.size() < sizeof(layout)) {
+    return 0;
+  }
+  memcpy(&layout, bytes.data(), sizeof(layout));
+  return layout.halo;
+}
+
+
+} // namespace bd
@@ -0,0 +1,445 @@
+#include <bd/io/compression.h>
+#include <bd/io/posixio.h>
+#include <bd/log/logger.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef BD_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef BD_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+namespace bd
+{
+
+namespace
+{
+
+#ifdef BD_HAVE_ZSTD
+/// \brief A zstd context per thread, so decompressing doesn't allocate.
+struct ZstdContexts
+{
+  ZstdContexts()
+    : cctx{ ZSTD_createCCtx() }
+    , dctx{ ZSTD_createDCtx() }
+  { }
+
+  ~ZstdContexts()
+  {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+  }
+
+  ZSTD_CCtx *cctx;
+  ZSTD_DCtx *dctx;
+};
+
+
+ZstdContexts &
+zstdContexts()
+{
+  thread_local ZstdContexts ctx;
+  return ctx;
+}
+#endif
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+codecAvailable(Codec c)
+{
+  switch (c) {
+    case Codec::None:
+      return true;
+    case Codec::Lz4:
+#ifdef BD_HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    case Codec::Zstd:
+#ifdef BD_HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(Codec c)
+{
+  switch (c) {
+    case Codec::None: return "none";
+    case Codec::Lz4: return "lz4";
+    case Codec::Zstd: return "zstd";
+    default: return "unknown";
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+compressBound(Codec c, size_t rawBytes)
+{
+  switch (c) {
+#ifdef BD_HAVE_LZ4
+    case Codec::Lz4:
+      return static_cast<size_t>(LZ4_compressBound(static_cast<int>(rawBytes)));
+#endif
+#ifdef BD_HAVE_ZSTD
+    case Codec::Zstd:
+      return ZSTD_compressBound(rawBytes);
+#endif
+    case Codec::None:
+    default:
+      return rawBytes;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+compressChunk(Codec c, char const *src, size_t n, char *dst, size_t dstCap, int level)
+{
+  switch (c) {
+    case Codec::None:
+      if (n > dstCap) {
+        return -1;
+      }
+      std::memcpy(dst, src, n);
+      return static_cast<long long>(n);
+
+#ifdef BD_HAVE_LZ4
+    case Codec::Lz4:
+    {
+      if (n > static_cast<size_t>(INT_MAX) || dstCap > static_cast<size_t>(INT_MAX)) {
+        Err() << "Chunk is too large for lz4.";
+        return -1;
+      }
+      int rval{ LZ4_compress_default(src, dst, static_cast<int>(n), static_cast<int>(dstCap)) };
+      return rval > 0 ? rval : -1;
+    }
+#endif
+
+#ifdef BD_HAVE_ZSTD
+    case Codec::Zstd:
+    {
+      size_t rval{ ZSTD_compressCCtx(zstdContexts().cctx, dst, dstCap, src, n, level) };
+      if (ZSTD_isError(rval)) {
+        Err() << "zstd compression failed: " << ZSTD_getErrorName(rval);
+        return -1;
+      }
+      return static_cast<long long>(rval);
+    }
+#endif
+
+    default:
+      (void)level;
+      Err() << "Codec " << to_string(c) << " is not available in this build.";
+      return -1;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+decompressChunk(Codec c, char const *src, size_t n, char *dst, size_t dstCap)
+{
+  switch (c) {
+    case Codec::None:
+      if (n > dstCap) {
+        return -1;
+      }
+      std::memcpy(dst, src, n);
+      return static_cast<long long>(n);
+
+#ifdef BD_HAVE_LZ4
+    case Codec::Lz4:
+    {
+      if (n > static_cast<size_t>(INT_MAX) || dstCap > static_cast<size_t>(INT_MAX)) {
+        Err() << "Chunk is too large for lz4.";
+        return -1;
+      }
+      int rval{ LZ4_decompress_safe(src, dst, static_cast<int>(n), static_cast<int>(dstCap)) };
+      if (rval < 0) {
+        Err() << "lz4 decompression failed: " << rval;
+        return -1;
+      }
+      return rval;
+    }
+#endif
+
+#ifdef BD_HAVE_ZSTD
+    case Codec::Zstd:
+    {
+      size_t rval{ ZSTD_decompressDCtx(zstdContexts().dctx, dst, dstCap, src, n) };
+      if (ZSTD_isError(rval)) {
+        Err() << "zstd decompression failed: " << ZSTD_getErrorName(rval);
+        return -1;
+      }
+      return static_cast<long long>(rval);
+    }
+#endif
+
+    default:
+      Err() << "Codec " << to_string(c) << " is not available in this build.";
+      return -1;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+writeCompressedFile(std::string const &rawPath, std::string const &outPath,
+                    Codec codec, size_t chunkBytes, int level)
+{
+  if (! codecAvailable(codec)) {
+    Err() << "Codec " << to_string(codec) << " is not available in this build.";
+    return false;
+  }
+  if (chunkBytes == 0) {
+    Err() << "Chunk size must be larger than 0.";
+    return false;
+  }
+
+  std::ifstream raw(rawPath, std::ios::binary);
+  if (! raw.is_open()) {
+    Err() << "Unable to open file: " + rawPath;
+    return false;
+  }
+
+  std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+  if (! out.is_open()) {
+    Err() << "Unable to open file: " + outPath;
+    return false;
+  }
+
+  CompressedHeader h;
+  std::memset(&h, 0, sizeof(h));
+  h.magic = COMPRESSED_MAGIC;
+  h.version = COMPRESSED_VERSION;
+  h.codec = static_cast<uint16_t>(codec);
+  h.chunk_bytes = chunkBytes;
+  // Written again with the real counts once all chunks are out.
+  out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+
+  std::vector<CompressedChunk> table;
+  std::vector<char> in(chunkBytes);
+  std::vector<char> packed(compressBound(codec, chunkBytes));
+  uint64_t offset{ sizeof(h) };
+
+  while (raw) {
+    raw.read(in.data(), static_cast<std::streamsize>(chunkBytes));
+    size_t const n{ static_cast<size_t>(raw.gcount()) };
+    if (n == 0) {
+      break;
+    }
+
+    long long packedBytes{ compressChunk(codec, in.data(), n, packed.data(), packed.size(), level) };
+    if (packedBytes < 0) {
+      return false;
+    }
+
+    CompressedChunk c;
+    c.offset = offset;
+    c.bytes = static_cast<uint64_t>(packedBytes);
+    c.raw_offset = h.raw_bytes;
+    c.raw_bytes = n;
+    table.push_back(c);
+
+    out.write(packed.data(), packedBytes);
+    offset += c.bytes;
+    h.raw_bytes += n;
+  }
+
+  h.num_chunks = table.size();
+  h.table_offset = offset;
+  out.write(reinterpret_cast<char const *>(table.data()),
+            static_cast<std::streamsize>(table.size() * sizeof(CompressedChunk)));
+
+  out.seekp(0);
+  out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+  if (! out) {
+    Err() << "Could not write " << outPath;
+    return false;
+  }
+
+  Info() << "Compressed " << h.raw_bytes << " bytes into " << offset << " bytes ("
+         << to_string(codec) << ", " << h.num_chunks << " chunks).";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+CompressedFile::CompressedFile()
+  : m_fd{ -1 }
+  , m_header{ }
+  , m_chunks{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+CompressedFile::~CompressedFile()
+{
+  close();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+CompressedFile::open(std::string const &path)
+{
+  close();
+
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    Err() << "Unable to open file: " + path;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    Err() << "Unable to stat file: " + path;
+    close();
+    return false;
+  }
+  uint64_t const fileBytes{ static_cast<uint64_t>(st.st_size) };
+
+  if (! preadAll(m_fd, reinterpret_cast<char *>(&m_header), sizeof(m_header), 0)) {
+    close();
+    return false;
+  }
+
+  if (m_header.magic != COMPRESSED_MAGIC || m_header.version != COMPRESSED_VERSION) {
+    Err() << path << " is not a chunked compressed volume.";
+    close();
+    return false;
+  }
+
+  if (! codecAvailable(codec())) {
+    Err() << path << " uses codec " << to_string(codec())
+          << ", which is not available in this build.";
+    close();
+    return false;
+  }
+
+  // Check the table fits in the file before trusting its size.
+  if (m_header.table_offset > fileBytes ||
+      m_header.num_chunks > ( fileBytes - m_header.table_offset ) / sizeof(CompressedChunk)) {
+    Err() << path << " has a corrupt chunk table.";
+    close();
+    return false;
+  }
+
+  m_chunks.resize(m_header.num_chunks);
+  if (! preadAll(m_fd, reinterpret_cast<char *>(m_chunks.data()),
+                 m_chunks.size() * sizeof(CompressedChunk), m_header.table_offset)) {
+    close();
+    return false;
+  }
+
+  // Chunks lie between the header and the table, and cover the volume in
+  // order with chunk_bytes each but the last, so readChunk() never reads or
+  // allocates past them.
+  uint64_t rawEnd{ 0 };
+  for (size_t i{ 0 }; i < m_chunks.size(); ++i) {
+    CompressedChunk const &c{ m_chunks[i] };
+    bool const last{ i + 1 == m_chunks.size() };
+    if (c.offset < sizeof(CompressedHeader) ||
+        c.offset > m_header.table_offset ||
+        c.bytes > m_header.table_offset - c.offset ||
+        c.raw_bytes > m_header.chunk_bytes ||
+        ( ! last && c.raw_bytes != m_header.chunk_bytes ) ||
+        c.raw_offset != rawEnd) {
+      Err() << path << " has a corrupt entry for chunk " << i << " in its chunk table.";
+      close();
+      return false;
+    }
+    rawEnd += c.raw_bytes;
+  }
+
+  if (rawEnd != m_header.raw_bytes) {
+    Err() << path << " has chunks of " << rawEnd << " bytes, expected "
+          << m_header.raw_bytes << " bytes.";
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+CompressedFile::close()
+{
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+  m_fd = -1;
+  m_chunks.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+CompressedHeader const &
+CompressedFile::header() const
+{
+  return m_header;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+Codec
+CompressedFile::codec() const
+{
+  return static_cast<Codec>(m_header.codec);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<CompressedChunk> const &
+CompressedFile::chunks() const
+{
+  return m_chunks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+CompressedFile::readChunk(size_t i, char *dst, size_t dstCap, std::vector<char> &scratch) const
+{
+  CompressedChunk const &c{ m_chunks[i] };
+  if (scratch.size() < c.bytes) {
+    scratch.resize(c.bytes);
+  }
+
+  if (! preadAll(m_fd, scratch.data(), c.bytes, c.offset)) {
+    return -1;
+  }
+
+  long long n{ decompressChunk(codec(), scratch.data(), c.bytes, dst, dstCap) };
+  if (n >= 0 && static_cast<uint64_t>(n) != c.raw_bytes) {
+    Err() << "Chunk " << i << " decompressed to " << n << " bytes, expected " << c.raw_bytes;
+    return -1;
+  }
+  return n;
+}
+
+} // namespace bd
@@ -1,15 +1,93 @@
 #include <bd/io/indexfile.h>
+#include <bd/io/indexrecord.h>
 #include <bd/filter/blockaveragefilter.h>
 #include <bd/util/util.h>
 
 #include <glm/glm.hpp>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <istream>
+#include <iterator>
 #include <ostream>
+#include <utility>
 
 
 namespace bd
 {
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+alignSection(uint64_t offset)
+{
+  return ( offset + SECTION_ALIGNMENT - 1 ) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Check the preamble and directory of a sectioned index file.
+/// \return An empty string if they are fine, or what is wrong with them.
+std::string
+checkDirectory(IndexPreamble const &pre,
+               char const *dirBytes,
+               std::vector<SectionEntry> const &dir,
+               uint64_t fileBytes)
+{
+  if (pre.byte_order != INDEX_BYTE_ORDER) {
+    return "was written with a different byte order";
+  }
+  if (pre.directory_checksum !=
+      indexChecksum(dirBytes, dir.size() * SECTION_ENTRY_RECORD_BYTES)) {
+    return "has a corrupt section directory";
+  }
+  for (SectionEntry const &e : dir) {
+    if (e.offset > fileBytes || e.length > fileBytes - e.offset) {
+      return "is too short for its " + to_string(static_cast<SectionType>(e.type)) +
+             " section";
+    }
+  }
+  return "";
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SectionEntry const *
+findSection(std::vector<SectionEntry> const &dir, SectionType type)
+{
+  for (SectionEntry const &e : dir) {
+    if (e.type == static_cast<uint32_t>(type)) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(BlockOrder o)
+{
+  switch (o) {
+    case BlockOrder::Linear: return "linear";
+    case BlockOrder::Morton: return "morton";
+    case BlockOrder::Hilbert: return "hilbert";
+    default: return "unknown";
+  }
+}
+
+
 /*****************************************************************************
  * IndexFile                                                                 *
 *****************************************************************************/
@@ -28,16 +106,33 @@ IndexFile::fromBinaryIndexFile(std::string const &path, bool &ok)
   }
 
   ok = idxfile->readBinaryIndexFile();
-  if (! ok) {
+  return idxfile;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<IndexFile>
+IndexFile::mapBinaryIndexFile(std::string const &path, bool &ok)
+{
+  std::unique_ptr<IndexFile> idxfile{ new IndexFile() };
+  idxfile->m_fileName = path;
+
+  if (path.empty()) {
+    ok = false;
     return idxfile;
   }
 
-  ok = (idxfile->getHeader().version == VERSION);
-  if (! ok) {
-    Err() << "The index file provided is the wrong version! You should regenerate the "
-      "index file.";
+  int mapped{ idxfile->mapIndexFile() };
+  if (mapped < 0) {
+    ok = false;
+    return idxfile;
+  }
+  if (mapped == 0) {
+    ok = idxfile->readBinaryIndexFile();
+    return idxfile;
   }
 
+  ok = true;
   return idxfile;
 }
 
@@ -47,6 +142,13 @@ IndexFile::IndexFile()
   : m_header{ }
   , m_fileName{ }
   , m_fileBlocks()
+  , m_volume{ }
+  , m_sections{ }
+  , m_map{ nullptr }
+  , m_mapBytes{ 0 }
+  , m_mappedBlocks{ }
+  , m_mappedCopied{ false }
+  , m_copyLock{ }
 {
 }
 
@@ -54,6 +156,7 @@ IndexFile::IndexFile()
 ///////////////////////////////////////////////////////////////////////////////
 IndexFile::~IndexFile()
 {
+  unmap();
 }
 
 
@@ -69,12 +172,68 @@ IndexFile::getHeader() const
 void
 IndexFile::writeBinaryIndexFile(std::ostream &os) const
 {
-  os.write(reinterpret_cast<const char *>(&m_header), sizeof(IndexFileHeader));
-  os.write(reinterpret_cast<const char *>(&m_volume), sizeof(Volume));
+  struct Out
+  {
+    SectionType type;
+    uint32_t recordBytes;
+    char const *data;
+    size_t length;
+  };
+
+  std::vector<char> header(HEADER_RECORD_BYTES);
+  encodeHeader(m_header, header.data());
+  std::vector<char> volume(VOLUME_RECORD_BYTES);
+  encodeVolume(m_volume, volume.data());
+  Span<FileBlock const> const blks{ blocks() };
+  std::vector<char> table(blks.size() * FILEBLOCK_RECORD_BYTES);
+  encodeFileBlocks(blks.data(), blks.size(), table.data());
+
+  std::vector<Out> outs;
+  outs.push_back({ SectionType::Header, 0, header.data(), header.size() });
+  outs.push_back({ SectionType::Volume, 0, volume.data(), volume.size() });
+  outs.push_back({ SectionType::Blocks, FILEBLOCK_RECORD_BYTES, table.data(), table.size() });
+  for (auto const &kv : m_sections) {
+    Span<char const> const bytes{ section(kv.first) };
+    outs.push_back({ kv.first, kv.second.recordBytes, bytes.data(), bytes.size() });
+  }
+
+  size_t const dirBytes{ outs.size() * SECTION_ENTRY_RECORD_BYTES };
+  std::vector<char> dir(dirBytes);
+  uint64_t offset{ alignSection(PREAMBLE_RECORD_BYTES + dirBytes) };
+  std::vector<uint64_t> offsets(outs.size());
+  for (size_t i{ 0 }; i < outs.size(); ++i) {
+    SectionEntry e;
+    e.type = static_cast<uint32_t>(outs[i].type);
+    e.record_bytes = outs[i].recordBytes;
+    e.offset = offset;
+    e.length = outs[i].length;
+    e.checksum = indexChecksum(outs[i].data, outs[i].length);
+    e.reserved = 0;
+    encodeSectionEntry(e, dir.data() + i * SECTION_ENTRY_RECORD_BYTES);
+    offsets[i] = offset;
+    offset = alignSection(offset + e.length);
+  }
 
-  // read all the blocks
-  for (auto &b : m_fileBlocks) {
-    os.write(reinterpret_cast<const char *>(&b), sizeof(FileBlock));
+  IndexPreamble pre;
+  pre.magic_number = MAGIC;
+  pre.version = VERSION;
+  pre.header_length = PREAMBLE_RECORD_BYTES;
+  pre.byte_order = INDEX_BYTE_ORDER;
+  pre.num_sections = static_cast<uint32_t>(outs.size());
+  pre.directory_checksum = indexChecksum(dir.data(), dir.size());
+  pre.reserved = 0;
+
+  char preBytes[PREAMBLE_RECORD_BYTES];
+  encodePreamble(pre, preBytes);
+  os.write(preBytes, PREAMBLE_RECORD_BYTES);
+  os.write(dir.data(), static_cast<std::streamsize>(dir.size()));
+
+  char const zeros[SECTION_ALIGNMENT]{ };
+  uint64_t written{ PREAMBLE_RECORD_BYTES + dir.size() };
+  for (size_t i{ 0 }; i < outs.size(); ++i) {
+    os.write(zeros, static_cast<std::streamsize>(offsets[i] - written));
+    os.write(outs[i].data, static_cast<std::streamsize>(outs[i].length));
+    written = offsets[i] + outs[i].length;
   }
 }
 
@@ -107,12 +266,13 @@ IndexFile::writeAsciiIndexFile(std::ostream &os) const
   os << m_header << ",\n"
         << m_volume << ",\n";
 
+  Span<FileBlock const> const blks{ blocks() };
   os << "\"blocks\": { \n";
-  if (m_fileBlocks.size() > 0) {
-    for (size_t i{ 0 }; i < m_fileBlocks.size() - 1; ++i) {
-      os << m_fileBlocks[i] << ",\n";
+  if (blks.size() > 0) {
+    for (size_t i{ 0 }; i < blks.size() - 1; ++i) {
+      os << blks[i] << ",\n";
     }
-    os << m_fileBlocks[m_fileBlocks.size() - 1] << "\n";
+    os << blks[blks.size() - 1] << "\n";
   }
 
   os << "}}\n";
@@ -137,10 +297,30 @@ IndexFile::writeAsciiIndexFile(std::string const &outpath) const
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+Span<FileBlock const>
+IndexFile::blocks() const
+{
+  if (m_map) {
+    return m_mappedBlocks;
+  }
+  return Span<FileBlock const>{ m_fileBlocks.data(), m_fileBlocks.size() };
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+IndexFile::isMapped() const
+{
+  return m_map != nullptr;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 std::vector<FileBlock> const&
 IndexFile::getFileBlocks() const
 {
+  copyMappedBlocks();
   return m_fileBlocks;
 }
 
@@ -149,6 +329,10 @@ IndexFile::getFileBlocks() const
 std::vector<FileBlock>&
 IndexFile::getFileBlocks()
 {
+  // Writes have to land somewhere blocks() sees them.
+  copyMappedBlocks();
+  copyMappedSections();
+  unmap();
   return m_fileBlocks;
 }
 
@@ -202,8 +386,11 @@ IndexFile::getTFFileName()
 void
 IndexFile::setRawFileName(std::string const &f)
 {
-  size_t lenght = f.size() > 256 ? 256 : f.size();
-  for (int i = 0; i < lenght; ++i){
+  // Keep the last char as the terminator, and don't leave the tail of a
+  // longer previous name behind.
+  std::fill(std::begin(m_header.raw_file), std::end(m_header.raw_file), '\0');
+  size_t lenght = f.size() > 255 ? 255 : f.size();
+  for (size_t i = 0; i < lenght; ++i){
     m_header.raw_file[i] = f[i];
   }
 }
@@ -220,6 +407,66 @@ IndexFile::setTFFileName(std::string const &f)
   }
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::setStorage(BlockStorage storage, Codec codec)
+{
+  m_header.storage = static_cast<uint16_t>(storage);
+  m_header.codec = static_cast<uint16_t>(codec);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+Span<char const>
+IndexFile::section(SectionType type) const
+{
+  auto it = m_sections.find(type);
+  if (it == m_sections.end()) {
+    return Span<char const>{ };
+  }
+  if (it->second.mapped.data() != nullptr) {
+    return it->second.mapped;
+  }
+  return Span<char const>{ it->second.bytes.data(), it->second.bytes.size() };
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+IndexFile::sectionRecordBytes(SectionType type) const
+{
+  auto it = m_sections.find(type);
+  return it == m_sections.end() ? 0 : it->second.recordBytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+IndexFile::setSection(SectionType type, std::vector<char> bytes, uint32_t recordBytes)
+{
+  if (type == SectionType::Header || type == SectionType::Volume ||
+      type == SectionType::Blocks) {
+    Err() << "The " << to_string(type) << " section can't be replaced.";
+    return false;
+  }
+
+  Section &s = m_sections[type];
+  s.recordBytes = recordBytes;
+  s.bytes = std::move(bytes);
+  s.mapped = Span<char const>{ };
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::removeSection(SectionType type)
+{
+  m_sections.erase(type);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 bool
 IndexFile::readBinaryIndexFile()
@@ -231,35 +478,359 @@ IndexFile::readBinaryIndexFile()
     return false;
   }
 
+  is.seekg(0, std::ios::end);
+  uint64_t const fileBytes{ static_cast<uint64_t>(is.tellg()) };
   is.seekg(0, std::ios::beg);
 
-  // read header
-  IndexFileHeader ifh;
-  is.read(reinterpret_cast<char *>(&ifh), sizeof(IndexFileHeader));
-  m_header = ifh;
+  char preBytes[PREAMBLE_RECORD_BYTES];
+  is.read(preBytes, PREAMBLE_RECORD_BYTES);
+  IndexPreamble pre;
+  if (! is || ! decodePreamble(preBytes, PREAMBLE_RECORD_BYTES, pre) ||
+      pre.magic_number != MAGIC) {
+    Err() << "The file " << m_fileName << " is not an index file.";
+    return false;
+  }
+
+  if (pre.version >= LEGACY_VERSION && pre.version < VERSION) {
+    Info() << m_fileName << " is a flat version " << pre.version << " index file.";
+    return readLegacyIndexFile(is);
+  }
 
-  // read volume
+  if (pre.version != VERSION) {
+    Err() << "The index file provided is the wrong version! You should regenerate the "
+      "index file.";
+    return false;
+  }
+
+  return readSections(is, pre, fileBytes);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+IndexFile::readSections(std::istream &is, IndexPreamble const &pre, uint64_t fileBytes)
+{
+  if (pre.num_sections > fileBytes / SECTION_ENTRY_RECORD_BYTES) {
+    Err() << "The index file " << m_fileName << " has a corrupt section directory.";
+    return false;
+  }
+
+  std::vector<char> dirBytes(pre.num_sections * SECTION_ENTRY_RECORD_BYTES);
+  is.read(dirBytes.data(), static_cast<std::streamsize>(dirBytes.size()));
+  std::vector<SectionEntry> dir(pre.num_sections);
+  decodeSectionEntries(dirBytes.data(), dir.size(), dir.data());
+  std::string problem{ is ? checkDirectory(pre, dirBytes.data(), dir, fileBytes)
+                          : "has a corrupt section directory" };
+  if (! problem.empty()) {
+    Err() << "The index file " << m_fileName << " " << problem << ".";
+    return false;
+  }
+
+  // Read section e into dst and check it against its checksum.
+  auto readSection = [&](SectionEntry const &e, char *dst) -> bool {
+    is.seekg(static_cast<std::streamoff>(e.offset), std::ios::beg);
+    is.read(dst, static_cast<std::streamsize>(e.length));
+    if (! is || indexChecksum(dst, e.length) != e.checksum) {
+      Err() << "The " << to_string(static_cast<SectionType>(e.type)) << " section of "
+            << m_fileName << " is corrupt.";
+      return false;
+    }
+    return true;
+  };
+
+  SectionEntry const *head{ findSection(dir, SectionType::Header) };
+  SectionEntry const *vol{ findSection(dir, SectionType::Volume) };
+  SectionEntry const *blks{ findSection(dir, SectionType::Blocks) };
+  if (head == nullptr || vol == nullptr || blks == nullptr) {
+    Err() << "The index file " << m_fileName << " is missing a core section.";
+    return false;
+  }
+
+  std::vector<char> bytes(head->length);
+  if (! readSection(*head, bytes.data()) ||
+      ! decodeHeader(bytes.data(), bytes.size(), m_header)) {
+    Err() << "Could not read the header of " << m_fileName;
+    return false;
+  }
+
+  bytes.resize(vol->length);
+  if (! readSection(*vol, bytes.data()) ||
+      ! decodeVolume(bytes.data(), bytes.size(), m_volume)) {
+    Err() << "Could not read the volume of " << m_fileName;
+    return false;
+  }
+
+  size_t const numBlocks{ m_volume.total_block_count() };
+  size_t const recordBytes{ blks->record_bytes };
+  if (recordBytes == 0 || blks->length != numBlocks * recordBytes) {
+    Err() << "The block table of " << m_fileName << " doesn't hold " << numBlocks
+          << " blocks.";
+    return false;
+  }
+
+  // Records written by other versions of FileBlock keep the fields both
+  // have in common, see decodeFileBlock().
+  bytes.resize(blks->length);
+  if (! readSection(*blks, bytes.data())) {
+    return false;
+  }
+  m_fileBlocks.resize(numBlocks);
+  decodeFileBlocks(bytes.data(), numBlocks, recordBytes, m_fileBlocks.data());
+
+  m_sections.clear();
+  for (SectionEntry const &e : dir) {
+    if (&e == head || &e == vol || &e == blks) {
+      continue;
+    }
+    Section s;
+    s.recordBytes = e.record_bytes;
+    s.bytes.resize(e.length);
+    if (! readSection(e, s.bytes.data())) {
+      return false;
+    }
+    m_sections[static_cast<SectionType>(e.type)] = std::move(s);
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+IndexFile::readLegacyIndexFile(std::istream &is)
+{
+  is.clear();
+  is.seekg(0, std::ios::beg);
+
+  // Flat files are the header, the volume and the blocks back to back, in
+  // the same records as the sections. Version 13 headers are shorter.
+  m_header = IndexFileHeader::fromStream(is);
+  if (! is) {
+    Err() << "The file " << m_fileName << " is too short for an index file.";
+    return false;
+  }
+
+  char volBytes[VOLUME_RECORD_BYTES];
+  is.read(volBytes, VOLUME_RECORD_BYTES);
+  if (! is || ! decodeVolume(volBytes, VOLUME_RECORD_BYTES, m_volume)) {
+    Err() << "The file " << m_fileName << " is too short for an index file.";
+    return false;
+  }
+
+  // Read all the things, in one go.
+  size_t const numBlocks{ m_volume.total_block_count() };
+  std::vector<char> table(numBlocks * FILEBLOCK_RECORD_BYTES);
+  is.read(table.data(), static_cast<std::streamsize>(table.size()));
+  if (! is) {
+    Err() << "The file " << m_fileName << " is too short for "
+          << numBlocks << " blocks.";
+    return false;
+  }
+  m_fileBlocks.resize(numBlocks);
+  decodeFileBlocks(table.data(), numBlocks, FILEBLOCK_RECORD_BYTES, m_fileBlocks.data());
+
+  // Written back out in the current format.
+  m_header.version = VERSION;
+  m_header.header_length = HEAD_LEN;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int
+IndexFile::mapIndexFile()
+{
+  int fd{ ::open(m_fileName.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    Err() << "The file " << m_fileName << " could not be opened.";
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return 0;
+  }
+
+  size_t const fileBytes{ static_cast<size_t>(st.st_size) };
+  if (fileBytes < PREAMBLE_RECORD_BYTES) {
+    Err() << "The file " << m_fileName << " is too short to be an index file.";
+    ::close(fd);
+    return -1;
+  }
+
+  // Shared, so every process with the index open uses the same pages.
+  void *mem{ mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, fd, 0) };
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    Warn() << "Could not map " << m_fileName << " (" << strerror(errno)
+           << "), reading it instead.";
+    return 0;
+  }
+
+  char const *bytes{ static_cast<char const *>(mem) };
+  IndexPreamble pre;
+  decodePreamble(bytes, fileBytes, pre);
+
+  // Anything that can't be viewed in place is left to readBinaryIndexFile().
+  auto fallBack = [&](char const *why) -> int {
+    Info() << m_fileName << " " << why << ", reading it instead of mapping it.";
+    munmap(mem, fileBytes);
+    return 0;
+  };
+
+  std::string problem;
+  if (pre.magic_number != MAGIC) {
+    problem = "is not an index file";
+  } else if (pre.version >= LEGACY_VERSION && pre.version < VERSION) {
+    return fallBack("is a flat index file");
+  } else if (pre.version != VERSION) {
+    problem = "is the wrong version! You should regenerate the index file";
+  }
+
+  std::vector<SectionEntry> dir;
+  if (problem.empty()) {
+    if (pre.num_sections > ( fileBytes - PREAMBLE_RECORD_BYTES ) / SECTION_ENTRY_RECORD_BYTES) {
+      problem = "has a corrupt section directory";
+    } else {
+      dir.resize(pre.num_sections);
+      decodeSectionEntries(bytes + PREAMBLE_RECORD_BYTES, dir.size(), dir.data());
+      problem = checkDirectory(pre, bytes + PREAMBLE_RECORD_BYTES, dir, fileBytes);
+    }
+  }
+
+  SectionEntry const *head{ nullptr };
+  SectionEntry const *vol{ nullptr };
+  SectionEntry const *blks{ nullptr };
+  if (problem.empty()) {
+    head = findSection(dir, SectionType::Header);
+    vol = findSection(dir, SectionType::Volume);
+    blks = findSection(dir, SectionType::Blocks);
+    if (head == nullptr || vol == nullptr || blks == nullptr) {
+      problem = "is missing a core section";
+    }
+  }
+
+  IndexFileHeader h;
   Volume v;
-  is.read(reinterpret_cast<char *>(&v), sizeof(Volume));
+  if (problem.empty()) {
+    if (indexChecksum(bytes + head->offset, head->length) != head->checksum ||
+        ! decodeHeader(bytes + head->offset, head->length, h)) {
+      problem = "has a corrupt header section";
+    } else if (indexChecksum(bytes + vol->offset, vol->length) != vol->checksum ||
+               ! decodeVolume(bytes + vol->offset, vol->length, v)) {
+      problem = "has a corrupt volume section";
+    }
+  }
+
+  size_t numBlocks{ 0 };
+  if (problem.empty()) {
+    numBlocks = v.total_block_count();
+    if (blks->record_bytes == 0 || blks->length != numBlocks * blks->record_bytes) {
+      problem = "has a block table of the wrong size";
+    }
+  }
+
+  if (! problem.empty()) {
+    Err() << "The index file " << m_fileName << " " << problem << ".";
+    munmap(mem, fileBytes);
+    return -1;
+  }
+
+  if (blks->record_bytes != FILEBLOCK_RECORD_BYTES) {
+    return fallBack("has blocks of a different size");
+  }
+  if (! fileBlockIsRecord()) {
+    return fallBack("has blocks that have to be decoded on this host");
+  }
+  if (reinterpret_cast<uintptr_t>(bytes + blks->offset) % alignof(FileBlock) != 0) {
+    return fallBack("has a misaligned block table");
+  }
+
+  m_header = h;
   m_volume = v;
+  m_map = mem;
+  m_mapBytes = fileBytes;
+  m_mappedBlocks = Span<FileBlock const>{
+      reinterpret_cast<FileBlock const *>(bytes + blks->offset), numBlocks };
+  m_mappedCopied = false;
+  m_fileBlocks.clear();
+
+  m_sections.clear();
+  for (SectionEntry const &e : dir) {
+    if (&e == head || &e == vol || &e == blks) {
+      continue;
+    }
+    Section s;
+    s.recordBytes = e.record_bytes;
+    s.mapped = Span<char const>{ bytes + e.offset, e.length };
+    m_sections[static_cast<SectionType>(e.type)] = std::move(s);
+  }
+
+  return 1;
+}
+
 
-  // Read all the things!
-  FileBlock fb;
-  for (size_t i = 0; i < m_volume.total_block_count(); ++i) {
-    is.read(reinterpret_cast<char *>(&fb), sizeof(FileBlock));
-    m_fileBlocks.push_back(fb);
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::copyMappedBlocks() const
+{
+  if (m_map == nullptr) {
+    return;
   }
 
-  return true;
+  std::lock_guard<std::mutex> lck(m_copyLock);
+  if (! m_mappedCopied) {
+    m_fileBlocks.assign(m_mappedBlocks.begin(), m_mappedBlocks.end());
+    m_mappedCopied = true;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::copyMappedSections()
+{
+  for (auto &kv : m_sections) {
+    Section &s = kv.second;
+    if (s.mapped.data() != nullptr) {
+      s.bytes.assign(s.mapped.begin(), s.mapped.end());
+      s.mapped = Span<char const>{ };
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::unmap()
+{
+  if (m_map) {
+    munmap(m_map, m_mapBytes);
+  }
+  for (auto it = m_sections.begin(); it != m_sections.end(); ) {
+    it = it->second.mapped.data() != nullptr ? m_sections.erase(it) : std::next(it);
+  }
+  m_map = nullptr;
+  m_mapBytes = 0;
+  m_mappedBlocks = Span<FileBlock const>{ };
+  m_mappedCopied = false;
 }
 
 
 ///////////////////////////////////////////////////////////////////////////////
 void
-IndexFile::init(bd::DataType type)
+IndexFile::init(bd::DataType type, EdgeBlocks edges, BlockOrder order)
 {
+  unmap();
+  m_sections.clear();
   size_t tySize{ bd::to_sizeType(type) };
 
+  if (edges == EdgeBlocks::Ragged) {
+    m_volume.block_count(m_volume.block_count(), EdgeBlocks::Ragged);
+  }
+  bool const ragged{ m_volume.hasRaggedBlocks() };
+
   // bc: number of blocks
   glm::u64vec3 bc{ m_volume.block_count() };
 
@@ -287,15 +858,26 @@ IndexFile::init(bd::DataType type)
         // i,j,k block identifier
         glm::u64vec3 const blkId{ bxi, byj, bzk };
 
-        glm::vec3 const worldLoc{ wd * glm::vec3(blkId) - 0.5f };
-
-        // block center in world coordinates
-        glm::vec3 const blkOrigin{ (worldLoc + (worldLoc + wd)) * 0.5f };
-
         // voxel start of block within volume 
         // (ijk index times the voxel dimensions of each block)
         glm::u64vec3 const startVoxel{ blkId * bd };
 
+        // ragged edge blocks only cover what is left of the volume
+        glm::u64vec3 const blkDims{ glm::min(bd, vd - startVoxel) };
+
+        // world extent of this block, in proportion to its voxels for
+        // ragged blocks since they aren't all the same size
+        glm::vec3 const blkWorld{ ragged
+            ? m_volume.worldDims() * glm::vec3(blkDims) / glm::vec3(vd)
+            : wd };
+
+        glm::vec3 const worldLoc{ ragged
+            ? m_volume.worldDims() * glm::vec3(startVoxel) / glm::vec3(vd) - 0.5f
+            : wd * glm::vec3(blkId) - 0.5f };
+
+        // block center in world coordinates
+        glm::vec3 const blkOrigin{ (worldLoc + (worldLoc + blkWorld)) * 0.5f };
+
         FileBlock blk;
         blk.block_index = bd::to1D(bxi, byj, bzk, bc.x, bc.y);
         blk.ijk_index[0] = bxi;
@@ -304,19 +886,19 @@ IndexFile::init(bd::DataType type)
         blk.data_offset = tySize *
           bd::to1D(startVoxel.x, startVoxel.y, startVoxel.z, vd.x, vd.y);
 
-        blk.data_bytes = tySize * bd.x * bd.y * bd.z;
+        blk.data_bytes = tySize * blkDims.x * blkDims.y * blkDims.z;
           
-        blk.voxel_dims[0] = static_cast<decltype(blk.voxel_dims[0])>(bd.x);
-        blk.voxel_dims[1] = static_cast<decltype(blk.voxel_dims[1])>(bd.y);
-        blk.voxel_dims[2] = static_cast<decltype(blk.voxel_dims[2])>(bd.z);
+        blk.voxel_dims[0] = blkDims.x;
+        blk.voxel_dims[1] = blkDims.y;
+        blk.voxel_dims[2] = blkDims.z;
 
         blk.world_oigin[0] = blkOrigin.x;
         blk.world_oigin[1] = blkOrigin.y;
         blk.world_oigin[2] = blkOrigin.z;
 
-        blk.world_dims[0] = wd.x;
-        blk.world_dims[1] = wd.y;
-        blk.world_dims[2] = wd.z;
+        blk.world_dims[0] = blkWorld.x;
+        blk.world_dims[1] = blkWorld.y;
+        blk.world_dims[2] = blkWorld.z;
 
         m_fileBlocks.push_back(blk);
       }
@@ -325,12 +907,56 @@ IndexFile::init(bd::DataType type)
   
   m_fileBlocks.shrink_to_fit();
 
+  if (order != BlockOrder::Linear) {
+    sortBlocks(order);
+  }
+
   initHeader(type);
 
   Dbg() << "Total blocks is: " << m_fileBlocks.size();
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+IndexFile::sortBlocks(BlockOrder order)
+{
+  std::vector<FileBlock> &blocks = getFileBlocks();
+  glm::u64vec3 const bc{ m_volume.block_count() };
+  unsigned const bits{ curveBits(std::max(bc.x, std::max(bc.y, bc.z))) };
+
+  auto key = [order, bits](FileBlock const &b) -> size_t {
+    switch (order) {
+      case BlockOrder::Morton:
+        return toMorton(b.ijk_index[0], b.ijk_index[1], b.ijk_index[2]);
+      case BlockOrder::Hilbert:
+        return toHilbert(b.ijk_index[0], b.ijk_index[1], b.ijk_index[2], bits);
+      case BlockOrder::Linear:
+      default:
+        return b.block_index;
+    }
+  };
+
+  std::vector<std::pair<size_t, FileBlock>> keyed;
+  keyed.reserve(blocks.size());
+  for (FileBlock const &b : blocks) {
+    keyed.emplace_back(key(b), b);
+  }
+  std::sort(keyed.begin(), keyed.end(),
+            [](std::pair<size_t, FileBlock> const &a, std::pair<size_t, FileBlock> const &b) {
+              return a.first < b.first;
+            });
+  for (size_t i{ 0 }; i < keyed.size(); ++i) {
+    blocks[i] = keyed[i].second;
+  }
+
+  if (m_sections.erase(SectionType::Histograms) > 0) {
+    Warn() << "Dropped the block histograms, they no longer match the block order.";
+  }
+  Dbg() << "Blocks sorted in " << to_string(order) << " order.";
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 void
 IndexFile::initHeader(DataType dt)
@@ -339,6 +965,8 @@ IndexFile::initHeader(DataType dt)
   m_header.version = VERSION;
   m_header.header_length = HEAD_LEN;
   m_header.dataType = IndexFileHeader::getTypeInt(dt);
+  m_header.storage = static_cast<uint16_t>(BlockStorage::RowMajor);
+  m_header.codec = static_cast<uint16_t>(Codec::None);
 
   //  m_header.numblocks[0] = m_volume.block_count().x;
   //  m_header.numblocks[1] = m_volume.block_count().y;
@@ -2,10 +2,26 @@
 // Created by jim on 10/3/16.
 //
 #include <bd/io/indexfileheader.h>
+#include <bd/io/indexrecord.h>
 
 namespace bd
 {
 
+static_assert(IFH_V13_LENGTH == 524, "Version 13 index files have a 524 byte header.");
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(BlockStorage s)
+{
+  switch (s) {
+    case BlockStorage::RowMajor: return "row_major";
+    case BlockStorage::Bricked: return "bricked";
+    default: return "unknown";
+  }
+}
+
+
 /*****************************************************************************
  * I n d e x F i l e H e a d e r                                             *
 *****************************************************************************/
@@ -16,9 +32,15 @@ IndexFileHeader
 IndexFileHeader::fromStream(std::istream &is)
 {
   IndexFileHeader ifh;
+  char bytes[HEADER_RECORD_BYTES];
   is.seekg(0, std::ios::beg);
 
-  is.read(reinterpret_cast<char *>(&ifh), sizeof(IndexFileHeader));
+  is.read(bytes, IFH_V13_LENGTH);
+  decodeHeader(bytes, IFH_V13_LENGTH, ifh);
+  if (is && ifh.version > 13) {
+    is.read(bytes + IFH_V13_LENGTH, HEADER_RECORD_BYTES - IFH_V13_LENGTH);
+    decodeHeader(bytes, HEADER_RECORD_BYTES, ifh);
+  }
 
   return ifh;
 }
@@ -28,7 +50,9 @@ IndexFileHeader::fromStream(std::istream &is)
 void
 IndexFileHeader::writeToStream(std::ostream &os, IndexFileHeader const &ifh)
 {
-  os.write(reinterpret_cast<const char *>(&ifh), sizeof(IndexFileHeader));
+  char bytes[HEADER_RECORD_BYTES];
+  encodeHeader(ifh, bytes);
+  os.write(bytes, HEADER_RECORD_BYTES);
 }
 
 
@@ -50,6 +74,8 @@ IndexFileHeader::getType(IndexFileHeader const &ifh)
       return DataType::UnsignedShort;
     case 0x5:
       return DataType::UnsignedInteger;
+    case 0x7:
+      return DataType::Double;
     case 0x6:
     default:
       return DataType::Float;
@@ -74,6 +100,8 @@ IndexFileHeader::getTypeInt(DataType ty)
       return 0x4;
     case DataType::UnsignedInteger:
       return 0x5;
+    case DataType::Double:
+      return 0x7;
     case DataType::Float:
     default:
       return 0x6;
@@ -81,6 +109,21 @@ IndexFileHeader::getTypeInt(DataType ty)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+BlockStorage
+IndexFileHeader::getStorage(IndexFileHeader const &ifh)
+{
+  return static_cast<BlockStorage>(ifh.storage);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+Codec
+IndexFileHeader::getCodec(IndexFileHeader const &ifh)
+{
+  return static_cast<Codec>(ifh.codec);
+}
+
 
 // IndexFileHeader operator<<
 std::ostream &
@@ -93,7 +136,9 @@ operator<<(std::ostream &os, bd::IndexFileHeader const &h)
          "  \"header_length\": " << h.header_length << ",\n"
          "  \"data_type\": \"" << bd::to_string(IndexFileHeader::getType(h)) << "\",\n"
          "  \"raw_file\": \"" << std::string(h.raw_file) << "\",\n"
-         "  \"tf_file:\": \"" << std::string(h.tf_file) << "\"\n"
+         "  \"tf_file:\": \"" << std::string(h.tf_file) << "\",\n"
+         "  \"storage\": \"" << bd::to_string(IndexFileHeader::getStorage(h)) << "\",\n"
+         "  \"codec\": \"" << bd::to_string(IndexFileHeader::getCodec(h)) << "\"\n"
          "}";
 
   return os;
@@ -0,0 +1,321 @@
+#include <bd/io/indexrecord.h>
+
+#include <glm/glm.hpp>
+
+namespace bd
+{
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+hostIsLittleEndian()
+{
+  uint32_t const probe{ 1 };
+  unsigned char first;
+  memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodePreamble(IndexPreamble const &pre, char *out)
+{
+  RecordWriter w{ out };
+  w.put(pre.magic_number);
+  w.put(pre.version);
+  w.put(pre.header_length);
+  w.put(pre.byte_order);
+  w.put(pre.num_sections);
+  w.put(pre.directory_checksum);
+  w.skip(4);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+decodePreamble(char const *in, size_t size, IndexPreamble &pre)
+{
+  pre = IndexPreamble{ };
+  RecordReader r{ in, size };
+  r.get(pre.magic_number);
+  r.get(pre.version);
+  r.get(pre.header_length);
+  r.get(pre.byte_order);
+  r.get(pre.num_sections);
+  r.get(pre.directory_checksum);
+  r.skip(4);
+  return r.ok();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodeSectionEntry(SectionEntry const &e, char *out)
+{
+  RecordWriter w{ out };
+  w.put(e.type);
+  w.put(e.record_bytes);
+  w.put(e.offset);
+  w.put(e.length);
+  w.put(e.checksum);
+  w.skip(4);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+decodeSectionEntries(char const *in, size_t n, SectionEntry *dir)
+{
+  for (size_t i{ 0 }; i < n; ++i) {
+    SectionEntry &e = dir[i];
+    e = SectionEntry{ };
+    RecordReader r{ in + i * SECTION_ENTRY_RECORD_BYTES, SECTION_ENTRY_RECORD_BYTES };
+    r.get(e.type);
+    r.get(e.record_bytes);
+    r.get(e.offset);
+    r.get(e.length);
+    r.get(e.checksum);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodeHeader(IndexFileHeader const &h, char *out)
+{
+  RecordWriter w{ out };
+  w.put(h.magic_number);
+  w.put(h.version);
+  w.put(h.header_length);
+  w.put(h.dataType);
+  w.putRaw(h.raw_file, sizeof(h.raw_file));
+  w.putRaw(h.tf_file, sizeof(h.tf_file));
+  w.put(h.storage);
+  w.put(h.codec);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+decodeHeader(char const *in, size_t size, IndexFileHeader &h)
+{
+  h = IndexFileHeader{ };
+  h.storage = static_cast<uint16_t>(BlockStorage::RowMajor);
+  h.codec = static_cast<uint16_t>(Codec::None);
+
+  RecordReader r{ in, size };
+  r.get(h.magic_number);
+  r.get(h.version);
+  r.get(h.header_length);
+  r.get(h.dataType);
+  r.getRaw(h.raw_file, sizeof(h.raw_file));
+  r.getRaw(h.tf_file, sizeof(h.tf_file));
+  if (! r.ok()) {
+    return false;
+  }
+  if (h.version <= 13) {
+    return true;
+  }
+  r.get(h.storage);
+  r.get(h.codec);
+  return r.ok();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodeVolume(Volume const &v, char *out)
+{
+  RecordWriter w{ out };
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(static_cast<uint64_t>(v.block_dims()[a]));
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(static_cast<uint64_t>(v.block_count()[a]));
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(static_cast<uint64_t>(v.voxelDims()[a]));
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(static_cast<float>(v.worldDims()[a]));
+  }
+  w.skip(4);
+  w.put(static_cast<uint64_t>(v.numEmptyVoxels()));
+  w.put(v.max());
+  w.put(v.min());
+  w.put(v.avg());
+  w.put(v.total());
+  w.put(v.rovMin());
+  w.put(v.rovMax());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+decodeVolume(char const *in, size_t size, Volume &v)
+{
+  glm::u64vec3 blockDims{ 0 };
+  glm::u64vec3 blockCount{ 0 };
+  glm::u64vec3 voxelDims{ 0 };
+  glm::f32vec3 worldDims{ 0 };
+  uint64_t empty{ 0 };
+  double mx{ 0 }, mn{ 0 }, avg{ 0 }, total{ 0 }, rovMin{ 0 }, rovMax{ 0 };
+
+  RecordReader r{ in, size };
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(blockDims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(blockCount[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(voxelDims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(worldDims[a]);
+  }
+  r.skip(4);
+  r.get(empty);
+  r.get(mx);
+  r.get(mn);
+  r.get(avg);
+  r.get(total);
+  r.get(rovMin);
+  r.get(rovMax);
+  if (! r.ok() || blockCount.x == 0 || blockCount.y == 0 || blockCount.z == 0) {
+    return false;
+  }
+
+  // The setters work out the block dimensions, which ragged volumes don't
+  // follow, so they are set last.
+  v.block_count(blockCount);
+  v.voxelDims(voxelDims);
+  v.block_dims(blockDims);
+  v.worldDims(worldDims);
+  v.numEmptyVoxels(empty);
+  v.max(mx);
+  v.min(mn);
+  v.avg(avg);
+  v.total(total);
+  v.rovMin(rovMin);
+  v.rovMax(rovMax);
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodeFileBlock(FileBlock const &b, char *out)
+{
+  RecordWriter w{ out };
+  w.put(b.block_index);
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(b.ijk_index[a]);
+  }
+  w.put(b.data_offset);
+  w.put(b.data_bytes);
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(b.voxel_dims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(b.world_dims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    w.put(b.world_oigin[a]);
+  }
+  w.put(b.min_val);
+  w.put(b.max_val);
+  w.put(b.avg_val);
+  w.put(b.total_val);
+  w.put(b.rov);
+  w.put(b.empty_voxels);
+  w.put(b.is_empty);
+  w.skip(4);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+decodeFileBlock(char const *in, size_t recordBytes, FileBlock &b)
+{
+  b = FileBlock{ };
+  RecordReader r{ in, recordBytes };
+  r.get(b.block_index);
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(b.ijk_index[a]);
+  }
+  r.get(b.data_offset);
+  r.get(b.data_bytes);
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(b.voxel_dims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(b.world_dims[a]);
+  }
+  for (int a{ 0 }; a < 3; ++a) {
+    r.get(b.world_oigin[a]);
+  }
+  r.get(b.min_val);
+  r.get(b.max_val);
+  r.get(b.avg_val);
+  r.get(b.total_val);
+  r.get(b.rov);
+  r.get(b.empty_voxels);
+  r.get(b.is_empty);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+encodeFileBlocks(FileBlock const *blocks, size_t n, char *out)
+{
+  for (size_t i{ 0 }; i < n; ++i) {
+    encodeFileBlock(blocks[i], out + i * FILEBLOCK_RECORD_BYTES);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+decodeFileBlocks(char const *in, size_t n, size_t recordBytes, FileBlock *blocks)
+{
+  if (recordBytes == FILEBLOCK_RECORD_BYTES && fileBlockIsRecord()) {
+    memcpy(static_cast<void *>(blocks), in, n * FILEBLOCK_RECORD_BYTES);
+    return;
+  }
+  for (size_t i{ 0 }; i < n; ++i) {
+    decodeFileBlock(in + i * recordBytes, recordBytes, blocks[i]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+fileBlockIsRecord()
+{
+  static bool const same{
+      hostIsLittleEndian() &&
+      sizeof(FileBlock) == FILEBLOCK_RECORD_BYTES &&
+      offsetof(FileBlock, block_index) == 0 &&
+      offsetof(FileBlock, ijk_index) == 8 &&
+      offsetof(FileBlock, data_offset) == 32 &&
+      offsetof(FileBlock, data_bytes) == 40 &&
+      offsetof(FileBlock, voxel_dims) == 48 &&
+      offsetof(FileBlock, world_dims) == 72 &&
+      offsetof(FileBlock, world_oigin) == 96 &&
+      offsetof(FileBlock, min_val) == 120 &&
+      offsetof(FileBlock, max_val) == 128 &&
+      offsetof(FileBlock, avg_val) == 136 &&
+      offsetof(FileBlock, total_val) == 144 &&
+      offsetof(FileBlock, rov) == 152 &&
+      offsetof(FileBlock, empty_voxels) == 160 &&
+      offsetof(FileBlock, is_empty) == 168 };
+  return same;
+}
+
+} // namespace bd
@@ -0,0 +1,59 @@
+#include <bd/io/indexsection.h>
+
+#include <array>
+
+namespace bd
+{
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+std::array<uint32_t, 256>
+makeCrcTable()
+{
+  std::array<uint32_t, 256> table;
+  for (uint32_t i{ 0 }; i < 256; ++i) {
+    uint32_t c{ i };
+    for (int k{ 0 }; k < 8; ++k) {
+      c = ( c & 1 ) ? 0xEDB88320u ^ ( c >> 1 ) : c >> 1;
+    }
+    table[i] = c;
+  }
+  return table;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(SectionType t)
+{
+  switch (t) {
+    case SectionType::Header: return "header";
+    case SectionType::Volume: return "volume";
+    case SectionType::Blocks: return "blocks";
+    case SectionType::Histograms: return "histograms";
+    case SectionType::Lod: return "lod";
+    case SectionType::Bricks: return "bricks";
+    default: return "unknown(" + std::to_string(static_cast<uint32_t>(t)) + ")";
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint32_t
+indexChecksum(void const *data, size_t bytes, uint32_t crc)
+{
+  static std::array<uint32_t, 256> const table{ makeCrcTable() };
+
+  unsigned char const *p{ static_cast<unsigned char const *>(data) };
+  crc = ~crc;
+  for (size_t i{ 0 }; i < bytes; ++i) {
+    crc = table[( crc ^ p[i] ) & 0xFF] ^ ( crc >> 8 );
+  }
+  return ~crc;
+}
+
+} // namespace bd
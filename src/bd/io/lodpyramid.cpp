@@ -0,0 +1,438 @@
+#include <bd/io/lodpyramid.h>
+#include <bd/io/blockio.h>
+#include <bd/io/datatypes.h>
+#include <bd/log/logger.h>
+#include <bd/util/simdreduce.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace bd
+{
+
+namespace
+{
+
+///////////////////////////////////////////////////////////////////////////////
+glm::u64vec3
+halve(glm::u64vec3 const &v)
+{
+  return ( v + glm::u64vec3{ 1 } ) / glm::u64vec3{ 2 };
+}
+
+
+/// \brief Combine \c n voxels with \c filter.
+template<class Ty>
+Ty
+combine(Ty const *v, int n, LodFilter filter)
+{
+  switch (filter) {
+    case LodFilter::Max:
+      return *std::max_element(v, v + n);
+    case LodFilter::Min:
+      return *std::min_element(v, v + n);
+    case LodFilter::Average:
+    default: {
+      double sum{ 0.0 };
+      for (int i{ 0 }; i < n; ++i) {
+        sum += static_cast<double>(v[i]);
+      }
+      double const avg{ sum / n };
+      return static_cast<Ty>(std::numeric_limits<Ty>::is_integer ? std::round(avg) : avg);
+    }
+  }
+}
+
+
+/// \brief Write the next coarser level of the row-major \c in voxel volume
+///        at \c inPath to \c outPath.
+template<class Ty>
+bool
+downsample(std::string const &inPath, glm::u64vec3 const &in,
+           std::string const &outPath, LodFilter filter)
+{
+  std::ifstream is(inPath, std::ios::binary);
+  if (! is.is_open()) {
+    Err() << "Unable to open file: " + inPath;
+    return false;
+  }
+  std::ofstream os(outPath, std::ios::binary | std::ios::trunc);
+  if (! os.is_open()) {
+    Err() << "Unable to open file: " + outPath;
+    return false;
+  }
+
+  glm::u64vec3 const out{ halve(in) };
+  size_t const slice{ in.x * in.y };
+  std::vector<Ty> src(2 * slice);
+  std::vector<Ty> dst(out.x * out.y);
+
+  for (uint64_t z{ 0 }; z < out.z; ++z) {
+    uint64_t const nz{ std::min<uint64_t>(2, in.z - 2 * z) };
+    is.read(reinterpret_cast<char *>(src.data()), nz * slice * sizeof(Ty));
+    if (! is) {
+      Err() << "Could not read slices " << 2 * z << "+ of " << inPath;
+      return false;
+    }
+
+    for (uint64_t y{ 0 }; y < out.y; ++y) {
+      uint64_t const ny{ std::min<uint64_t>(2, in.y - 2 * y) };
+      for (uint64_t x{ 0 }; x < out.x; ++x) {
+        uint64_t const nx{ std::min<uint64_t>(2, in.x - 2 * x) };
+
+        Ty v[8]{ };
+        int n{ 0 };
+        for (uint64_t k{ 0 }; k < nz; ++k)
+        for (uint64_t j{ 0 }; j < ny; ++j)
+        for (uint64_t i{ 0 }; i < nx; ++i) {
+          v[n++] = src[k * slice + ( 2 * y + j ) * in.x + 2 * x + i];
+        }
+        dst[y * out.x + x] = combine(v, n, filter);
+      }
+    }
+
+    os.write(reinterpret_cast<char const *>(dst.data()), dst.size() * sizeof(Ty));
+  }
+
+  if (! os) {
+    Err() << "Could not write " << outPath;
+    return false;
+  }
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+downsampleAs(DataType type, std::string const &inPath, glm::u64vec3 const &in,
+             std::string const &outPath, LodFilter filter)
+{
+  switch (type) {
+    case DataType::Character:         return downsample<char>(inPath, in, outPath, filter);
+    case DataType::UnsignedCharacter: return downsample<unsigned char>(inPath, in, outPath, filter);
+    case DataType::Short:             return downsample<short>(inPath, in, outPath, filter);
+    case DataType::UnsignedShort:     return downsample<unsigned short>(inPath, in, outPath, filter);
+    case DataType::Integer:           return downsample<int>(inPath, in, outPath, filter);
+    case DataType::UnsignedInteger:   return downsample<unsigned int>(inPath, in, outPath, filter);
+    case DataType::Float:             return downsample<float>(inPath, in, outPath, filter);
+    case DataType::Double:            return downsample<double>(inPath, in, outPath, filter);
+    default:
+      Err() << "Can't downsample data of type " << to_string(type);
+      return false;
+  }
+}
+
+
+/// \brief Fill in the value statistics of the blocks of \c index from \c path.
+bool
+blockStats(IndexFile &index, std::string const &path)
+{
+  DataType const type{ IndexFileHeader::getType(index.getHeader()) };
+  size_t const tySize{ to_sizeType(type) };
+  glm::u64vec3 const volDims{ index.getVolume().voxelDims() };
+
+  int fd{ ::open(path.c_str(), O_RDONLY) };
+  if (fd < 0) {
+    Err() << "Unable to open file: " + path;
+    return false;
+  }
+
+  std::vector<char> brick;
+  std::vector<char> scratch;
+  bool ok{ true };
+  for (FileBlock &fb : index.getFileBlocks()) {
+    brick.resize(fileBlockBrickBytes(fb, tySize));
+    long long bytes{ readBlockData(fd, index.getHeader(), fb, volDims, tySize,
+                                   brick.data(), scratch) };
+    ReduceResult r;
+    if (bytes < 0 || ! reduce(type, brick.data(), bytes / tySize, 0.0, 0.0, r)) {
+      Err() << "Could not read block " << fb.block_index << " from " << path;
+      ok = false;
+      break;
+    }
+
+    uint64_t const n{ static_cast<uint64_t>(bytes) / tySize };
+    fb.min_val = r.min;
+    fb.max_val = r.max;
+    fb.total_val = r.sum;
+    fb.avg_val = n > 0 ? r.sum / n : 0.0;
+  }
+
+  ::close(fd);
+  return ok;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(LodFilter f)
+{
+  switch (f) {
+    case LodFilter::Max: return "max";
+    case LodFilter::Min: return "min";
+    case LodFilter::Average:
+    default: return "average";
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+LodPyramid::LodPyramid()
+  : m_filter{ LodFilter::Average }
+  , m_levels{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+LodPyramid::numLevels() const
+{
+  return m_levels.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+LodLevel const &
+LodPyramid::level(size_t l) const
+{
+  return m_levels[l];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+LodFilter
+LodPyramid::filter() const
+{
+  return m_filter;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+LodPyramid::levelScale(size_t l) const
+{
+  glm::dvec3 const base{ m_levels[0].voxelDims };
+  glm::dvec3 const dims{ m_levels[l].voxelDims };
+  glm::dvec3 const s{ base / glm::max(dims, glm::dvec3{ 1.0 }) };
+  return std::max(s.x, std::max(s.y, s.z));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+LodPyramid::selectLevel(double pixelsPerVoxel, double maxPixelError) const
+{
+  size_t l{ 0 };
+  while (l + 1 < m_levels.size() && levelScale(l + 1) * pixelsPerVoxel <= maxPixelError) {
+    ++l;
+  }
+  return l;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+LodPyramid::reset(IndexFile const &index, LodFilter filter)
+{
+  Span<FileBlock const> const blocks{ index.blocks() };
+  char const *raw{ index.getHeader().raw_file };
+
+  LodLevel base;
+  base.voxelDims = index.getVolume().voxelDims();
+  base.blockCount = index.getVolume().block_count();
+  base.rawFile.assign(raw, strnlen(raw, sizeof(index.getHeader().raw_file)));
+  base.blocks.assign(blocks.begin(), blocks.end());
+
+  m_filter = filter;
+  m_levels.clear();
+  m_levels.push_back(std::move(base));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+LodPyramid::addLevel(LodLevel level)
+{
+  m_levels.push_back(std::move(level));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+LodPyramid::store(IndexFile &index) const
+{
+  if (m_levels.empty()) {
+    Err() << "The LOD pyramid has no levels.";
+    return false;
+  }
+
+  SectionHeader h;
+  h.num_levels = static_cast<uint32_t>(m_levels.size() - 1);
+  h.filter = static_cast<uint32_t>(m_filter);
+  h.block_bytes = sizeof(FileBlock);
+  h.reserved = 0;
+
+  size_t numBlocks{ 0 };
+  for (size_t l{ 1 }; l < m_levels.size(); ++l) {
+    numBlocks += m_levels[l].blocks.size();
+  }
+
+  std::vector<char> bytes(sizeof(SectionHeader) + h.num_levels * sizeof(LevelRecord) +
+                          numBlocks * sizeof(FileBlock));
+  char *p{ bytes.data() };
+  memcpy(p, &h, sizeof(SectionHeader));
+  p += sizeof(SectionHeader);
+
+  for (size_t l{ 1 }; l < m_levels.size(); ++l) {
+    LodLevel const &lvl = m_levels[l];
+    if (lvl.rawFile.size() >= sizeof(LevelRecord::raw_file)) {
+      Err() << "LOD file name is too long: " << lvl.rawFile;
+      return false;
+    }
+
+    LevelRecord r;
+    memset(&r, 0, sizeof(LevelRecord));
+    for (int a{ 0 }; a < 3; ++a) {
+      r.voxel_dims[a] = lvl.voxelDims[a];
+      r.block_count[a] = lvl.blockCount[a];
+    }
+    r.num_blocks = lvl.blocks.size();
+    memcpy(r.raw_file, lvl.rawFile.data(), lvl.rawFile.size());
+    memcpy(p, &r, sizeof(LevelRecord));
+    p += sizeof(LevelRecord);
+  }
+
+  for (size_t l{ 1 }; l < m_levels.size(); ++l) {
+    std::vector<FileBlock> const &blocks = m_levels[l].blocks;
+    memcpy(static_cast<void *>(p), blocks.data(), blocks.size() * sizeof(FileBlock));
+    p += blocks.size() * sizeof(FileBlock);
+  }
+
+  return index.setSection(SectionType::Lod, std::move(bytes));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+LodPyramid::load(IndexFile const &index)
+{
+  Span<char const> const bytes{ index.section(SectionType::Lod) };
+  SectionHeader h;
+  if (bytes.size() < sizeof(SectionHeader)) {
+    Err() << "The index has no LOD pyramid.";
+    return false;
+  }
+  memcpy(&h, bytes.data(), sizeof(SectionHeader));
+  if (h.block_bytes != sizeof(FileBlock) ||
+      bytes.size() < sizeof(SectionHeader) + h.num_levels * sizeof(LevelRecord)) {
+    Err() << "The LOD pyramid section doesn't match this build.";
+    return false;
+  }
+
+  LodPyramid pyramid;
+  pyramid.reset(index, static_cast<LodFilter>(h.filter));
+
+  char const *records{ bytes.data() + sizeof(SectionHeader) };
+  size_t offset{ sizeof(SectionHeader) + h.num_levels * sizeof(LevelRecord) };
+  for (uint32_t l{ 0 }; l < h.num_levels; ++l) {
+    LevelRecord r;
+    memcpy(&r, records + l * sizeof(LevelRecord), sizeof(LevelRecord));
+    if (offset + r.num_blocks * sizeof(FileBlock) > bytes.size()) {
+      Err() << "The LOD pyramid section is truncated.";
+      return false;
+    }
+
+    LodLevel lvl;
+    lvl.voxelDims = { r.voxel_dims[0], r.voxel_dims[1], r.voxel_dims[2] };
+    lvl.blockCount = { r.block_count[0], r.block_count[1], r.block_count[2] };
+    lvl.rawFile.assign(r.raw_file, strnlen(r.raw_file, sizeof(r.raw_file)));
+    lvl.blocks.resize(r.num_blocks);
+    memcpy(static_cast<void *>(lvl.blocks.data()), bytes.data() + offset,
+           r.num_blocks * sizeof(FileBlock));
+    offset += r.num_blocks * sizeof(FileBlock);
+
+    pyramid.addLevel(std::move(lvl));
+  }
+
+  *this = std::move(pyramid);
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+projectedVoxelSize(double voxelSize, double distance, double fovY, double viewportHeight)
+{
+  double const view{ 2.0 * distance * std::tan(0.5 * fovY) };
+  return view > 0.0 ? voxelSize / view * viewportHeight
+                    : std::numeric_limits<double>::max();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+buildLodPyramid(IndexFile const &index,
+                std::string const &rawPath,
+                size_t numLevels,
+                LodFilter filter,
+                LodPyramid &pyramid)
+{
+  if (IndexFileHeader::getStorage(index.getHeader()) != BlockStorage::RowMajor) {
+    Err() << "LOD levels can only be built from a row-major volume.";
+    return false;
+  }
+
+  DataType const type{ IndexFileHeader::getType(index.getHeader()) };
+  pyramid.reset(index, filter);
+
+  std::string prevPath{ rawPath };
+  glm::u64vec3 dims{ index.getVolume().voxelDims() };
+  glm::u64vec3 count{ index.getVolume().block_count() };
+  // coarser levels keep the edge blocks if level 0 has them
+  EdgeBlocks const edges{ index.getVolume().hasRaggedBlocks()
+                              ? EdgeBlocks::Ragged : EdgeBlocks::Drop };
+
+  for (size_t l{ 1 }; l < numLevels; ++l) {
+    if (dims == glm::u64vec3{ 1 }) {
+      break;
+    }
+
+    glm::u64vec3 const nextDims{ halve(dims) };
+    glm::u64vec3 const nextCount{ glm::min(halve(count), nextDims) };
+    std::string const path{ rawPath + ".lod" + std::to_string(l) };
+
+    if (! downsampleAs(type, prevPath, dims, path, filter)) {
+      return false;
+    }
+
+    Volume vol{ nextDims, nextCount };
+    vol.worldDims(index.getVolume().worldDims());
+    IndexFile lvl;
+    lvl.setVolume(vol);
+    lvl.init(type, edges);
+    if (! blockStats(lvl, path)) {
+      return false;
+    }
+
+    Info() << "LOD level " << l << ": " << nextDims.x << "x" << nextDims.y << "x"
+           << nextDims.z << " voxels in " << lvl.blocks().size() << " blocks";
+
+    pyramid.addLevel(LodLevel{ nextDims, nextCount, path, lvl.getFileBlocks() });
+    prevPath = path;
+    dims = nextDims;
+    count = nextCount;
+  }
+
+  return true;
+}
+
+} // namespace bd
@@ -0,0 +1,339 @@
+#include <bd/io/poolallocator.h>
+#include <bd/log/logger.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace bd
+{
+
+namespace
+{
+
+size_t const HUGE_2M{ size_t(1) << 21 };
+size_t const HUGE_1G{ size_t(1) << 30 };
+
+/// Memory policy from <numaif.h>, which we avoid needing libnuma for.
+int const MPOL_BIND_MODE{ 2 };
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+roundUp(size_t v, size_t multiple)
+{
+  return ( v + multiple - 1 ) / multiple * multiple;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+systemPageSize()
+{
+  long page{ sysconf(_SC_PAGESIZE) };
+  return page > 0 ? static_cast<size_t>(page) : 4096;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+PoolMemory::PoolMemory()
+  : m_ptr{ nullptr }
+  , m_bytes{ 0 }
+  , m_mappedBytes{ 0 }
+  , m_kind{ Kind::None }
+  , m_pages{ PageSize::Default }
+  , m_numaBound{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+PoolMemory::~PoolMemory()
+{
+  release();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+PoolMemory::allocate(size_t bytes, PoolAllocPolicy const &policy)
+{
+  release();
+  if (bytes == 0) {
+    bytes = 1;
+  }
+
+  PageSize pages{ policy.pages };
+  bool ok{ false };
+
+  if (pages == PageSize::Huge1G) {
+    ok = mapHuge(bytes, PageSize::Huge1G);
+    if (! ok) {
+      Warn() << "1 GB huge pages not available, trying 2 MB huge pages.";
+      pages = PageSize::Huge2M;
+    }
+  }
+
+  if (! ok && pages == PageSize::Huge2M) {
+    ok = mapHuge(bytes, PageSize::Huge2M);
+    if (! ok) {
+      Warn() << "2 MB huge pages not available, using transparent huge pages.";
+      pages = PageSize::Transparent;
+    }
+  }
+
+  if (! ok && pages == PageSize::Transparent) {
+    size_t align{ policy.alignment > HUGE_2M ? policy.alignment : HUGE_2M };
+    ok = mapAligned(bytes, align);
+    if (ok) {
+#ifdef MADV_HUGEPAGE
+      if (madvise(m_ptr, m_mappedBytes, MADV_HUGEPAGE) != 0) {
+        Warn() << "madvise(MADV_HUGEPAGE) failed: " << strerror(errno);
+      }
+#else
+      Warn() << "Transparent huge pages are not supported on this platform.";
+#endif
+      m_pages = PageSize::Transparent;
+    }
+  }
+
+  if (! ok && policy.numaNode >= 0) {
+    // mbind needs whole pages that nothing else shares.
+    size_t page{ systemPageSize() };
+    ok = mapAligned(bytes, policy.alignment > page ? policy.alignment : page);
+  }
+
+  if (! ok) {
+    void *mem{ nullptr };
+    size_t align{ policy.alignment > sizeof(void *) ? policy.alignment : sizeof(void *) };
+    if (posix_memalign(&mem, align, bytes) != 0) {
+      Err() << "Could not allocate " << bytes << " bytes of pool memory.";
+      return false;
+    }
+    m_ptr = mem;
+    m_bytes = bytes;
+    m_kind = Kind::Heap;
+    m_pages = PageSize::Default;
+  }
+
+  if (policy.numaNode >= 0) {
+    if (m_kind == Kind::Mapped) {
+      m_numaBound = bindToNumaNode(m_ptr, m_mappedBytes, policy.numaNode);
+    } else {
+      Warn() << "Pool memory is not page aligned, not binding to NUMA node "
+             << policy.numaNode;
+    }
+  }
+
+  if (policy.prefault) {
+    size_t page{ systemPageSize() };
+    char *p{ static_cast<char *>(m_ptr) };
+    for (size_t i{ 0 }; i < m_bytes; i += page) {
+      p[i] = 0;
+    }
+  }
+
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+PoolMemory::release()
+{
+  if (m_kind == Kind::Heap) {
+    free(m_ptr);
+  } else if (m_kind == Kind::Mapped) {
+    munmap(m_ptr, m_mappedBytes);
+  }
+
+  m_ptr = nullptr;
+  m_bytes = 0;
+  m_mappedBytes = 0;
+  m_kind = Kind::None;
+  m_pages = PageSize::Default;
+  m_numaBound = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void *
+PoolMemory::ptr() const
+{
+  return m_ptr;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+PoolMemory::bytes() const
+{
+  return m_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+PageSize
+PoolMemory::pages() const
+{
+  return m_pages;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+PoolMemory::isNumaBound() const
+{
+  return m_numaBound;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+PoolMemory::mapHuge(size_t bytes, PageSize pages)
+{
+#ifdef MAP_HUGETLB
+  size_t const pageBytes{ pages == PageSize::Huge1G ? HUGE_1G : HUGE_2M };
+  int const sizeFlag{ pages == PageSize::Huge1G ? MAP_HUGE_1GB : MAP_HUGE_2MB };
+  size_t const len{ roundUp(bytes, pageBytes) };
+
+  void *mem{ mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | sizeFlag, -1, 0) };
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+
+  m_ptr = mem;
+  m_bytes = bytes;
+  m_mappedBytes = len;
+  m_kind = Kind::Mapped;
+  m_pages = pages;
+  return true;
+#else
+  (void)bytes;
+  (void)pages;
+  return false;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+PoolMemory::mapAligned(size_t bytes, size_t alignment)
+{
+  size_t const page{ systemPageSize() };
+  alignment = roundUp(alignment, page);
+  size_t const len{ roundUp(bytes, alignment) };
+
+  // Over-map by one alignment and trim both ends so the start is aligned.
+  size_t const overLen{ len + alignment };
+  void *mem{ mmap(nullptr, overLen, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+  if (mem == MAP_FAILED) {
+    Warn() << "mmap of " << overLen << " bytes failed: " << strerror(errno);
+    return false;
+  }
+
+  uintptr_t const base{ reinterpret_cast<uintptr_t>(mem) };
+  uintptr_t const start{ roundUp(base, alignment) };
+  size_t const front{ start - base };
+  size_t const back{ overLen - front - len };
+  if (front > 0) {
+    munmap(mem, front);
+  }
+  if (back > 0) {
+    munmap(reinterpret_cast<void *>(start + len), back);
+  }
+
+  m_ptr = reinterpret_cast<void *>(start);
+  m_bytes = bytes;
+  m_mappedBytes = len;
+  m_kind = Kind::Mapped;
+  m_pages = PageSize::Default;
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int
+numaNodeCount()
+{
+  // Looks like "0" or "0-1" (or "0,2-3" on odd machines).
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string online;
+  if (! (in >> online) || online.empty()) {
+    return 1;
+  }
+
+  size_t const pos{ online.find_last_of(",-") };
+  std::string const last{ pos == std::string::npos ? online : online.substr(pos + 1) };
+  int const highest{ std::atoi(last.c_str()) };
+  return highest >= 0 ? highest + 1 : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int
+currentNumaNode()
+{
+#ifdef SYS_getcpu
+  unsigned cpu{ 0 };
+  unsigned node{ 0 };
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return static_cast<int>(node);
+  }
+#endif
+  return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+bindToNumaNode(void *ptr, size_t bytes, int node)
+{
+#ifdef SYS_mbind
+  if (node < 0) {
+    return false;
+  }
+
+  size_t const bitsPerWord{ sizeof(unsigned long) * 8 };
+  std::vector<unsigned long> mask(node / bitsPerWord + 1, 0);
+  mask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+
+  // maxnode is one more than the highest bit the kernel should look at.
+  long rval{ syscall(SYS_mbind, ptr, bytes, MPOL_BIND_MODE, mask.data(),
+                     mask.size() * bitsPerWord + 1, 0) };
+  if (rval != 0) {
+    Warn() << "Could not bind pool memory to NUMA node " << node << ": " << strerror(errno);
+    return false;
+  }
+  return true;
+#else
+  (void)ptr;
+  (void)bytes;
+  Warn() << "NUMA binding is not supported on this platform, ignoring node " << node;
+  return false;
+#endif
+}
+
+} // namespace bd
@@ -0,0 +1,52 @@
+#include <bd/io/posixio.h>
+#include <bd/log/logger.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace bd
+{
+
+///////////////////////////////////////////////////////////////////////////////
+long long
+preadFully(int fd, void *dst, size_t bytes, uint64_t offset)
+{
+  char *p{ static_cast<char *>(dst) };
+  size_t done{ 0 };
+  while (done < bytes) {
+    ssize_t rval{ pread(fd, p + done, bytes - done, static_cast<off_t>(offset + done)) };
+    if (rval < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (rval == 0) {
+      break; // end of file
+    }
+    done += static_cast<size_t>(rval);
+  }
+
+  return static_cast<long long>(done);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+preadAll(int fd, void *dst, size_t bytes, uint64_t offset)
+{
+  long long const rval{ preadFully(fd, dst, bytes, offset) };
+  if (rval < 0) {
+    Err() << "pread failed at offset " << offset << ": " << strerror(static_cast<int>(-rval));
+    return false;
+  }
+  if (static_cast<size_t>(rval) < bytes) {
+    Err() << "Unexpected end of file at offset " << offset + rval;
+    return false;
+  }
+  return true;
+}
+
+} // namespace bd
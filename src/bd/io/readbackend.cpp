@@ -0,0 +1,407 @@
+#include <bd/io/readbackend.h>
+#include <bd/io/posixio.h>
+#include <bd/datastructure/blockingqueue.h>
+#include <bd/log/logger.h>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef BD_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace bd
+{
+
+namespace
+{
+
+/*****************************************************************************
+ * PreadBackend                                                              *
+*****************************************************************************/
+
+/// \brief Keeps reads in flight with a pool of threads doing blocking preads.
+class PreadBackend : public ReadBackend
+{
+public:
+  PreadBackend(int queueDepth)
+    : ReadBackend{ queueDepth }
+    , m_outstanding{ 0 }
+  { }
+
+
+  ~PreadBackend()
+  {
+    close();
+  }
+
+
+  bool
+  submit(void *dst, size_t bytes, uint64_t offset, void *tag) override
+  {
+    if (m_threads.empty()) {
+      return false;
+    }
+
+    Request r{ dst, bytes, offset, tag };
+    m_requests.push(r);
+    ++m_outstanding;
+    return true;
+  }
+
+
+  bool
+  waitCompletion(ReadCompletion &c) override
+  {
+    if (m_outstanding == 0) {
+      return false;
+    }
+
+    c = m_completions.pop();
+    --m_outstanding;
+    return true;
+  }
+
+
+protected:
+  bool
+  onOpen() override
+  {
+    for (int i = 0; i < m_queueDepth; ++i) {
+      m_threads.push_back(std::thread{ [this]() { work(); } });
+    }
+    return true;
+  }
+
+
+  void
+  onClose() override
+  {
+    // Drain anything still in flight, then send each thread a stop request.
+    ReadCompletion c;
+    while (waitCompletion(c)) { }
+
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+      m_requests.push(Request{ nullptr, 0, 0, nullptr });
+    }
+    for (auto &t : m_threads) {
+      t.join();
+    }
+    m_threads.clear();
+  }
+
+
+private:
+  struct Request
+  {
+    void *dst;
+    size_t bytes;
+    uint64_t offset;
+    void *tag;
+  };
+
+
+  void
+  work()
+  {
+    while (true) {
+      Request r{ m_requests.pop() };
+      if (r.dst == nullptr) {
+        break;
+      }
+
+      m_completions.push(ReadCompletion{ r.tag, preadFully(m_fd, r.dst, r.bytes, r.offset) });
+    }
+  }
+
+
+  BlockingQueue<Request> m_requests;
+  BlockingQueue<ReadCompletion> m_completions;
+  std::vector<std::thread> m_threads;
+  int m_outstanding;  ///< Only touched by the submitting thread.
+
+}; // class PreadBackend
+
+
+#ifdef BD_HAVE_LIBURING
+/*****************************************************************************
+ * UringBackend                                                              *
+*****************************************************************************/
+
+/// \brief Keeps reads in flight with a Linux io_uring.
+class UringBackend : public ReadBackend
+{
+public:
+  UringBackend(int queueDepth)
+    : ReadBackend{ queueDepth }
+    , m_ring{ }
+    , m_outstanding{ 0 }
+    , m_ringOk{ false }
+  { }
+
+
+  ~UringBackend()
+  {
+    close();
+    if (m_ringOk) {
+      io_uring_queue_exit(&m_ring);
+    }
+  }
+
+
+  /// \brief Set up the ring.
+  /// \returns False if the kernel does not support io_uring.
+  bool
+  init()
+  {
+    int rval{ io_uring_queue_init(static_cast<unsigned>(m_queueDepth), &m_ring, 0) };
+    if (rval < 0) {
+      Warn() << "io_uring_queue_init failed: " << strerror(-rval);
+      return false;
+    }
+    m_ringOk = true;
+    return true;
+  }
+
+
+  bool
+  submit(void *dst, size_t bytes, uint64_t offset, void *tag) override
+  {
+    Pending *p{ new Pending{ static_cast<char *>(dst), bytes, offset, tag, 0 }};
+    if (! queue(p)) {
+      delete p;
+      return false;
+    }
+    ++m_outstanding;
+    return true;
+  }
+
+
+  bool
+  waitCompletion(ReadCompletion &c) override
+  {
+    while (m_outstanding > 0) {
+      io_uring_cqe *cqe{ nullptr };
+      int rval{ io_uring_wait_cqe(&m_ring, &cqe) };
+      if (rval < 0) {
+        if (rval == -EINTR) {
+          continue;
+        }
+        Err() << "io_uring_wait_cqe failed: " << strerror(-rval);
+        return false;
+      }
+
+      Pending *p{ static_cast<Pending *>(io_uring_cqe_get_data(cqe)) };
+      int res{ cqe->res };
+      io_uring_cqe_seen(&m_ring, cqe);
+
+      if (res > 0) {
+        p->done += static_cast<size_t>(res);
+        // Short read before end of file, queue the rest of it.
+        if (p->done < p->bytes && p->offset + p->done < m_fileSize && queue(p)) {
+          continue;
+        }
+      }
+
+      c.tag = p->tag;
+      c.bytes = res < 0 ? res : static_cast<long long>(p->done);
+      delete p;
+      --m_outstanding;
+      return true;
+    }
+
+    return false;
+  }
+
+
+private:
+  struct Pending
+  {
+    char *dst;
+    size_t bytes;
+    uint64_t offset;
+    void *tag;
+    size_t done;
+  };
+
+
+  bool
+  queue(Pending *p)
+  {
+    io_uring_sqe *sqe{ io_uring_get_sqe(&m_ring) };
+    if (sqe == nullptr) {
+      Err() << "io_uring submission queue is full.";
+      return false;
+    }
+
+    io_uring_prep_read(sqe, m_fd, p->dst + p->done,
+                       static_cast<unsigned>(p->bytes - p->done), p->offset + p->done);
+    io_uring_sqe_set_data(sqe, p);
+
+    int rval{ io_uring_submit(&m_ring) };
+    if (rval < 0) {
+      Err() << "io_uring_submit failed: " << strerror(-rval);
+      return false;
+    }
+    return true;
+  }
+
+
+  io_uring m_ring;
+  int m_outstanding;
+  bool m_ringOk;
+
+}; // class UringBackend
+#endif // BD_HAVE_LIBURING
+
+} // namespace
+
+
+/*****************************************************************************
+ * ReadBackend                                                               *
+*****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+ReadBackend *
+ReadBackend::create(ReadBackendType type, int queueDepth)
+{
+  if (queueDepth < 1) {
+    queueDepth = 1;
+  }
+
+  switch (type) {
+    case ReadBackendType::Uring:
+    {
+#ifdef BD_HAVE_LIBURING
+      UringBackend *ub{ new UringBackend(queueDepth) };
+      if (ub->init()) {
+        return ub;
+      }
+      delete ub;
+#endif
+      Warn() << "io_uring backend is not available, using pread backend.";
+      return new PreadBackend(queueDepth);
+    }
+
+    case ReadBackendType::Pread:
+    default:
+      return new PreadBackend(queueDepth);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+ReadBackend::ReadBackend(int queueDepth)
+  : m_fd{ -1 }
+  , m_queueDepth{ queueDepth }
+  , m_fileSize{ 0 }
+  , m_direct{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+ReadBackend::~ReadBackend()
+{
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+ReadBackend::open(std::string const &path, bool direct)
+{
+  close();
+
+  int flags{ O_RDONLY };
+  if (direct) {
+#ifdef O_DIRECT
+    flags |= O_DIRECT;
+#else
+    Warn() << "O_DIRECT is not supported on this platform, ignoring.";
+    direct = false;
+#endif
+  }
+
+  m_fd = ::open(path.c_str(), flags);
+  if (m_fd < 0) {
+    Err() << "Could not open file " << path << ": " << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    Err() << "Could not stat file " << path << ": " << strerror(errno);
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_fileSize = static_cast<uint64_t>(st.st_size);
+  m_direct = direct;
+
+  return onOpen();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+ReadBackend::close()
+{
+  if (m_fd < 0) {
+    return;
+  }
+
+  onClose();
+  ::close(m_fd);
+  m_fd = -1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+int
+ReadBackend::queueDepth() const
+{
+  return m_queueDepth;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+ReadBackend::fileSize() const
+{
+  return m_fileSize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+ReadBackend::isDirect() const
+{
+  return m_direct;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+ReadBackend::onOpen()
+{
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+ReadBackend::onClose()
+{
+}
+
+} // namespace bd
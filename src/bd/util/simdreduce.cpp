@@ -0,0 +1,1001 @@
+#include <bd/util/simdreduce.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define BD_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace bd
+{
+
+namespace
+{
+
+/// \brief The type each voxel type is widened to for min, max and the
+///        range test.
+template<class Ty> struct Lane;
+
+template<> struct Lane<char>
+{ using Cmp = int32_t; };
+
+template<> struct Lane<unsigned char>
+{ using Cmp = int32_t; };
+
+template<> struct Lane<short>
+{ using Cmp = int32_t; };
+
+template<> struct Lane<unsigned short>
+{ using Cmp = int32_t; };
+
+template<> struct Lane<int>
+{ using Cmp = int32_t; };
+
+template<> struct Lane<unsigned int>
+{ using Cmp = uint32_t; };
+
+template<> struct Lane<float>
+{ using Cmp = float; };
+
+template<> struct Lane<double>
+{ using Cmp = double; };
+
+
+/// \brief Vector iterations between flushes of the lane sums and counts.
+///        32768 * 65535 still fits the 32 bit sum lanes of 16 bit data.
+size_t const CHUNK_ITERATIONS{ 32768 };
+
+
+///////////////////////////////////////////////////////////////////////////////
+ReduceResult
+emptyResult()
+{
+  return ReduceResult{ std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::lowest(),
+                       0.0, 0 };
+}
+
+
+/// \brief Convert the range [lo, hi] to the Cmp values of Ty in it. An empty
+///        range becomes one no value passes.
+template<class Ty>
+void
+toCmpRange(double lo, double hi,
+           typename Lane<Ty>::Cmp &clo, typename Lane<Ty>::Cmp &chi)
+{
+  using C = typename Lane<Ty>::Cmp;
+  clo = std::numeric_limits<C>::max();
+  chi = std::numeric_limits<C>::lowest();
+
+  if (! ( lo <= hi )) {
+    return;
+  }
+
+  if (std::numeric_limits<Ty>::is_integer) {
+    double const tmin{ static_cast<double>(std::numeric_limits<Ty>::lowest()) };
+    double const tmax{ static_cast<double>(std::numeric_limits<Ty>::max()) };
+    double const l{ std::max(std::ceil(lo), tmin) };
+    double const h{ std::min(std::floor(hi), tmax) };
+    if (l <= h) {
+      clo = static_cast<C>(l);
+      chi = static_cast<C>(h);
+    }
+  } else if (sizeof(Ty) == sizeof(float)) {
+    // The smallest float >= lo and the largest float <= hi.
+    float const inf{ std::numeric_limits<float>::infinity() };
+    float l{ lo < -std::numeric_limits<float>::max() ? -inf : static_cast<float>(lo) };
+    float h{ hi > std::numeric_limits<float>::max() ? inf : static_cast<float>(hi) };
+    if (static_cast<double>(l) < lo) {
+      l = std::nextafter(l, inf);
+    }
+    if (static_cast<double>(h) > hi) {
+      h = std::nextafter(h, -inf);
+    }
+    if (l <= h) {
+      clo = static_cast<C>(l);
+      chi = static_cast<C>(h);
+    }
+  } else {
+    clo = static_cast<C>(lo);
+    chi = static_cast<C>(hi);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+void
+reduceScalar(Ty const *p, size_t n,
+             typename Lane<Ty>::Cmp lo, typename Lane<Ty>::Cmp hi,
+             ReduceResult &r)
+{
+  using C = typename Lane<Ty>::Cmp;
+  for (size_t i{ 0 }; i < n; ++i) {
+    C const v{ static_cast<C>(p[i]) };
+    double const d{ static_cast<double>(p[i]) };
+    r.min = std::min(r.min, d);
+    r.max = std::max(r.max, d);
+    r.sum += d;
+    r.inRange += ( v >= lo && v <= hi ) ? 1 : 0;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, size_t N>
+void
+foldMinMax(Ty const (&mn)[N], Ty const (&mx)[N], ReduceResult &r)
+{
+  for (size_t k{ 0 }; k < N; ++k) {
+    r.min = std::min(r.min, static_cast<double>(mn[k]));
+    r.max = std::max(r.max, static_cast<double>(mx[k]));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, size_t N>
+void
+foldSum(Ty const (&sum)[N], ReduceResult &r)
+{
+  for (size_t k{ 0 }; k < N; ++k) {
+    r.sum += static_cast<double>(sum[k]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty, size_t N>
+void
+foldCount(Ty const (&count)[N], ReduceResult &r)
+{
+  for (size_t k{ 0 }; k < N; ++k) {
+    r.inRange += static_cast<uint64_t>(count[k]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief End of the chunk of whole vectors that starts at \c i.
+size_t
+chunkEnd(size_t i, size_t n, size_t lanes)
+{
+  return i + std::min(( n - i ) / lanes, CHUNK_ITERATIONS) * lanes;
+}
+
+
+#ifdef BD_SIMD_X86
+
+// The kernels below widen every value to a 32 bit lane (64 bit for double)
+// so min, max and the range test are one instruction each whatever the type.
+// Sums of 8 and 16 bit data are kept in 32 bit lanes and of 32 bit data in
+// 64 bit lanes, and flushed to the result every CHUNK_ITERATIONS. Without
+// mask registers an integer is in range iff clamping it to [lo, hi] leaves
+// it alone, which needs only the min and max the kernels use anyway. That
+// test only holds for lo <= hi; reduce() handles empty ranges.
+
+
+// SSE2 ///////////////////////////////////////////////////////////////////////
+//
+// SSE2 has no 32 bit min/max, sign extension or unsigned compare, so those
+// are made of compares and shuffles. Unsigned ints are biased by 2^31 to
+// compare them as signed.
+
+uint32_t const SIGN_BIAS{ 0x80000000u };
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(char const *p)
+{
+  int32_t x;
+  memcpy(&x, p, sizeof(x));
+  __m128i v{ _mm_cvtsi32_si128(x) };
+  v = _mm_unpacklo_epi8(v, v);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24);
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(unsigned char const *p)
+{
+  int32_t x;
+  memcpy(&x, p, sizeof(x));
+  __m128i const zero{ _mm_setzero_si128() };
+  return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(x), zero), zero);
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(short const *p)
+{
+  __m128i const v{ _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p)) };
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(unsigned short const *p)
+{
+  __m128i const v{ _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p)) };
+  return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(int const *p)
+{
+  return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+loadSse2(unsigned int const *p)
+{
+  return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)),
+                       _mm_set1_epi32(static_cast<int32_t>(SIGN_BIAS)));
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+minSse2(__m128i a, __m128i b)
+{
+  __m128i const gt{ _mm_cmpgt_epi32(a, b) };
+  return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+
+__attribute__((target("sse2"))) inline __m128i
+maxSse2(__m128i a, __m128i b)
+{
+  __m128i const gt{ _mm_cmpgt_epi32(a, b) };
+  return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+__attribute__((target("sse2"))) void
+reduceSse2(Ty const *p, size_t n,
+              typename Lane<Ty>::Cmp lo, typename Lane<Ty>::Cmp hi,
+              ReduceResult &r)
+{
+  using C = typename Lane<Ty>::Cmp;
+  using Wide = typename std::conditional<std::is_same<Ty, unsigned int>::value,
+                                         uint64_t, int64_t>::type;
+  size_t const N{ 4 };
+  bool const isUnsigned{ std::is_same<Ty, unsigned int>::value };
+  bool const narrow{ sizeof(Ty) < sizeof(int32_t) };
+  int32_t const bias{ isUnsigned ? static_cast<int32_t>(SIGN_BIAS) : 0 };
+
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m128i const vbias{ _mm_set1_epi32(bias) };
+  __m128i const vlo{ _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(lo)), vbias) };
+  __m128i const vhi{ _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(hi)), vbias) };
+  __m128i const zero{ _mm_setzero_si128() };
+  __m128i mn{ _mm_set1_epi32(std::numeric_limits<int32_t>::max()) };
+  __m128i mx{ _mm_set1_epi32(std::numeric_limits<int32_t>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m128i sum32{ zero };
+    __m128i sum64{ zero };
+    __m128i count{ zero };
+    for (; i < end; i += N) {
+      __m128i const v{ loadSse2(p + i) };
+      mn = minSse2(mn, v);
+      mx = maxSse2(mx, v);
+      count = _mm_sub_epi32(count, _mm_cmpeq_epi32(v, minSse2(maxSse2(v, vlo), vhi)));
+      if (narrow) {
+        sum32 = _mm_add_epi32(sum32, v);
+      } else {
+        __m128i const u{ _mm_xor_si128(v, vbias) };
+        __m128i const ext{ isUnsigned ? zero : _mm_cmpgt_epi32(zero, u) };
+        sum64 = _mm_add_epi64(sum64, _mm_unpacklo_epi32(u, ext));
+        sum64 = _mm_add_epi64(sum64, _mm_unpackhi_epi32(u, ext));
+      }
+    }
+
+    alignas(16) int32_t s32[N];
+    alignas(16) Wide s64[N / 2];
+    alignas(16) uint32_t c[N];
+    _mm_store_si128(reinterpret_cast<__m128i *>(s32), sum32);
+    _mm_store_si128(reinterpret_cast<__m128i *>(s64), sum64);
+    _mm_store_si128(reinterpret_cast<__m128i *>(c), count);
+    foldSum(s32, r);
+    foldSum(s64, r);
+    foldCount(c, r);
+  }
+
+  alignas(16) C lmn[N];
+  alignas(16) C lmx[N];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lmn), _mm_xor_si128(mn, vbias));
+  _mm_store_si128(reinterpret_cast<__m128i *>(lmx), _mm_xor_si128(mx, vbias));
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2"))) void
+reduceSse2(float const *p, size_t n, float lo, float hi, ReduceResult &r)
+{
+  size_t const N{ 4 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m128 const vlo{ _mm_set1_ps(lo) };
+  __m128 const vhi{ _mm_set1_ps(hi) };
+  __m128 mn{ _mm_set1_ps(std::numeric_limits<float>::max()) };
+  __m128 mx{ _mm_set1_ps(std::numeric_limits<float>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m128d sum{ _mm_setzero_pd() };
+    __m128i count{ _mm_setzero_si128() };
+    for (; i < end; i += N) {
+      __m128 const v{ _mm_loadu_ps(p + i) };
+      mn = _mm_min_ps(mn, v);
+      mx = _mm_max_ps(mx, v);
+      sum = _mm_add_pd(sum, _mm_cvtps_pd(v));
+      sum = _mm_add_pd(sum, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+      __m128 const in{ _mm_and_ps(_mm_cmpge_ps(v, vlo), _mm_cmple_ps(v, vhi)) };
+      count = _mm_sub_epi32(count, _mm_castps_si128(in));
+    }
+
+    alignas(16) double s[N / 2];
+    alignas(16) uint32_t c[N];
+    _mm_store_pd(s, sum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(c), count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(16) float lmn[N];
+  alignas(16) float lmx[N];
+  _mm_store_ps(lmn, mn);
+  _mm_store_ps(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2"))) void
+reduceSse2(double const *p, size_t n, double lo, double hi, ReduceResult &r)
+{
+  size_t const N{ 2 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m128d const vlo{ _mm_set1_pd(lo) };
+  __m128d const vhi{ _mm_set1_pd(hi) };
+  __m128d mn{ _mm_set1_pd(std::numeric_limits<double>::max()) };
+  __m128d mx{ _mm_set1_pd(std::numeric_limits<double>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m128d sum{ _mm_setzero_pd() };
+    __m128i count{ _mm_setzero_si128() };
+    for (; i < end; i += N) {
+      __m128d const v{ _mm_loadu_pd(p + i) };
+      mn = _mm_min_pd(mn, v);
+      mx = _mm_max_pd(mx, v);
+      sum = _mm_add_pd(sum, v);
+      __m128d const in{ _mm_and_pd(_mm_cmpge_pd(v, vlo), _mm_cmple_pd(v, vhi)) };
+      count = _mm_sub_epi64(count, _mm_castpd_si128(in));
+    }
+
+    alignas(16) double s[N];
+    alignas(16) uint64_t c[N];
+    _mm_store_pd(s, sum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(c), count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(16) double lmn[N];
+  alignas(16) double lmx[N];
+  _mm_store_pd(lmn, mn);
+  _mm_store_pd(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+// AVX2 ///////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(char const *p)
+{
+  return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(unsigned char const *p)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(short const *p)
+{
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(unsigned short const *p)
+{
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(int const *p)
+{
+  return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+}
+
+
+__attribute__((target("avx2"))) inline __m256i
+loadAvx2(unsigned int const *p)
+{
+  return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+__attribute__((target("avx2"))) void
+reduceAvx2(Ty const *p, size_t n,
+              typename Lane<Ty>::Cmp lo, typename Lane<Ty>::Cmp hi,
+              ReduceResult &r)
+{
+  using C = typename Lane<Ty>::Cmp;
+  using Wide = typename std::conditional<std::is_same<Ty, unsigned int>::value,
+                                         uint64_t, int64_t>::type;
+  size_t const N{ 8 };
+  bool const isUnsigned{ std::is_same<Ty, unsigned int>::value };
+  bool const narrow{ sizeof(Ty) < sizeof(int32_t) };
+
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m256i const vlo{ _mm256_set1_epi32(static_cast<int32_t>(lo)) };
+  __m256i const vhi{ _mm256_set1_epi32(static_cast<int32_t>(hi)) };
+  __m256i mn{ _mm256_set1_epi32(static_cast<int32_t>(std::numeric_limits<C>::max())) };
+  __m256i mx{ _mm256_set1_epi32(static_cast<int32_t>(std::numeric_limits<C>::lowest())) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m256i sum32{ _mm256_setzero_si256() };
+    __m256i sum64{ _mm256_setzero_si256() };
+    __m256i count{ _mm256_setzero_si256() };
+    for (; i < end; i += N) {
+      __m256i const v{ loadAvx2(p + i) };
+      __m256i clamped;
+      if (isUnsigned) {
+        mn = _mm256_min_epu32(mn, v);
+        mx = _mm256_max_epu32(mx, v);
+        clamped = _mm256_min_epu32(_mm256_max_epu32(v, vlo), vhi);
+      } else {
+        mn = _mm256_min_epi32(mn, v);
+        mx = _mm256_max_epi32(mx, v);
+        clamped = _mm256_min_epi32(_mm256_max_epi32(v, vlo), vhi);
+      }
+      count = _mm256_sub_epi32(count, _mm256_cmpeq_epi32(v, clamped));
+      if (narrow) {
+        sum32 = _mm256_add_epi32(sum32, v);
+      } else if (isUnsigned) {
+        sum64 = _mm256_add_epi64(sum64, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+        sum64 = _mm256_add_epi64(sum64, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+      } else {
+        sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+      }
+    }
+
+    alignas(32) int32_t s32[N];
+    alignas(32) Wide s64[N / 2];
+    alignas(32) uint32_t c[N];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(s32), sum32);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(s64), sum64);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(c), count);
+    foldSum(s32, r);
+    foldSum(s64, r);
+    foldCount(c, r);
+  }
+
+  alignas(32) C lmn[N];
+  alignas(32) C lmx[N];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lmn), mn);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lmx), mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2"))) void
+reduceAvx2(float const *p, size_t n, float lo, float hi, ReduceResult &r)
+{
+  size_t const N{ 8 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m256 const vlo{ _mm256_set1_ps(lo) };
+  __m256 const vhi{ _mm256_set1_ps(hi) };
+  __m256 mn{ _mm256_set1_ps(std::numeric_limits<float>::max()) };
+  __m256 mx{ _mm256_set1_ps(std::numeric_limits<float>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m256d sum{ _mm256_setzero_pd() };
+    __m256i count{ _mm256_setzero_si256() };
+    for (; i < end; i += N) {
+      __m256 const v{ _mm256_loadu_ps(p + i) };
+      mn = _mm256_min_ps(mn, v);
+      mx = _mm256_max_ps(mx, v);
+      sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+      sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+      __m256 const in{ _mm256_and_ps(_mm256_cmp_ps(v, vlo, _CMP_GE_OQ),
+                                     _mm256_cmp_ps(v, vhi, _CMP_LE_OQ)) };
+      count = _mm256_sub_epi32(count, _mm256_castps_si256(in));
+    }
+
+    alignas(32) double s[N / 2];
+    alignas(32) uint32_t c[N];
+    _mm256_store_pd(s, sum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(c), count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(32) float lmn[N];
+  alignas(32) float lmx[N];
+  _mm256_store_ps(lmn, mn);
+  _mm256_store_ps(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2"))) void
+reduceAvx2(double const *p, size_t n, double lo, double hi, ReduceResult &r)
+{
+  size_t const N{ 4 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m256d const vlo{ _mm256_set1_pd(lo) };
+  __m256d const vhi{ _mm256_set1_pd(hi) };
+  __m256d mn{ _mm256_set1_pd(std::numeric_limits<double>::max()) };
+  __m256d mx{ _mm256_set1_pd(std::numeric_limits<double>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m256d sum{ _mm256_setzero_pd() };
+    __m256i count{ _mm256_setzero_si256() };
+    for (; i < end; i += N) {
+      __m256d const v{ _mm256_loadu_pd(p + i) };
+      mn = _mm256_min_pd(mn, v);
+      mx = _mm256_max_pd(mx, v);
+      sum = _mm256_add_pd(sum, v);
+      __m256d const in{ _mm256_and_pd(_mm256_cmp_pd(v, vlo, _CMP_GE_OQ),
+                                      _mm256_cmp_pd(v, vhi, _CMP_LE_OQ)) };
+      count = _mm256_sub_epi64(count, _mm256_castpd_si256(in));
+    }
+
+    alignas(32) double s[N];
+    alignas(32) uint64_t c[N];
+    _mm256_store_pd(s, sum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(c), count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(32) double lmn[N];
+  alignas(32) double lmx[N];
+  _mm256_store_pd(lmn, mn);
+  _mm256_store_pd(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+// AVX-512 ////////////////////////////////////////////////////////////////////
+//
+// Only AVX-512F is used. Compares give mask registers, so the in-range
+// count is a masked add.
+//
+// The AVX-512 intrinsics of some GCC 12 releases trip -Wmaybe-uninitialized
+// on their own placeholder operands (GCC bug 105593).
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(char const *p)
+{
+  return _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(unsigned char const *p)
+{
+  return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)));
+}
+
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(short const *p)
+{
+  return _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)));
+}
+
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(unsigned short const *p)
+{
+  return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)));
+}
+
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(int const *p)
+{
+  return _mm512_loadu_si512(p);
+}
+
+
+__attribute__((target("avx512f"))) inline __m512i
+loadAvx512(unsigned int const *p)
+{
+  return _mm512_loadu_si512(p);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+__attribute__((target("avx512f"))) void
+reduceAvx512(Ty const *p, size_t n,
+                typename Lane<Ty>::Cmp lo, typename Lane<Ty>::Cmp hi,
+                ReduceResult &r)
+{
+  using C = typename Lane<Ty>::Cmp;
+  using Wide = typename std::conditional<std::is_same<Ty, unsigned int>::value,
+                                         uint64_t, int64_t>::type;
+  size_t const N{ 16 };
+  bool const isUnsigned{ std::is_same<Ty, unsigned int>::value };
+  bool const narrow{ sizeof(Ty) < sizeof(int32_t) };
+
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m512i const one{ _mm512_set1_epi32(1) };
+  __m512i const vlo{ _mm512_set1_epi32(static_cast<int32_t>(lo)) };
+  __m512i const vhi{ _mm512_set1_epi32(static_cast<int32_t>(hi)) };
+  __m512i mn{ _mm512_set1_epi32(static_cast<int32_t>(std::numeric_limits<C>::max())) };
+  __m512i mx{ _mm512_set1_epi32(static_cast<int32_t>(std::numeric_limits<C>::lowest())) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m512i sum32{ _mm512_setzero_si512() };
+    __m512i sum64{ _mm512_setzero_si512() };
+    __m512i count{ _mm512_setzero_si512() };
+    for (; i < end; i += N) {
+      __m512i const v{ loadAvx512(p + i) };
+      __mmask16 in;
+      if (isUnsigned) {
+        mn = _mm512_min_epu32(mn, v);
+        mx = _mm512_max_epu32(mx, v);
+        in = _mm512_mask_cmp_epu32_mask(_mm512_cmp_epu32_mask(v, vlo, _MM_CMPINT_NLT),
+                                        v, vhi, _MM_CMPINT_LE);
+      } else {
+        mn = _mm512_min_epi32(mn, v);
+        mx = _mm512_max_epi32(mx, v);
+        in = _mm512_mask_cmp_epi32_mask(_mm512_cmp_epi32_mask(v, vlo, _MM_CMPINT_NLT),
+                                        v, vhi, _MM_CMPINT_LE);
+      }
+      count = _mm512_mask_add_epi32(count, in, count, one);
+      if (narrow) {
+        sum32 = _mm512_add_epi32(sum32, v);
+      } else if (isUnsigned) {
+        sum64 = _mm512_add_epi64(sum64, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(v)));
+        sum64 = _mm512_add_epi64(sum64, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+      } else {
+        sum64 = _mm512_add_epi64(sum64, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+        sum64 = _mm512_add_epi64(sum64, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+      }
+    }
+
+    alignas(64) int32_t s32[N];
+    alignas(64) Wide s64[N / 2];
+    alignas(64) uint32_t c[N];
+    _mm512_store_si512(s32, sum32);
+    _mm512_store_si512(s64, sum64);
+    _mm512_store_si512(c, count);
+    foldSum(s32, r);
+    foldSum(s64, r);
+    foldCount(c, r);
+  }
+
+  alignas(64) C lmn[N];
+  alignas(64) C lmx[N];
+  _mm512_store_si512(lmn, mn);
+  _mm512_store_si512(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx512f"))) void
+reduceAvx512(float const *p, size_t n, float lo, float hi, ReduceResult &r)
+{
+  size_t const N{ 16 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m512i const one{ _mm512_set1_epi32(1) };
+  __m512 const vlo{ _mm512_set1_ps(lo) };
+  __m512 const vhi{ _mm512_set1_ps(hi) };
+  __m512 mn{ _mm512_set1_ps(std::numeric_limits<float>::max()) };
+  __m512 mx{ _mm512_set1_ps(std::numeric_limits<float>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m512d sum{ _mm512_setzero_pd() };
+    __m512i count{ _mm512_setzero_si512() };
+    for (; i < end; i += N) {
+      __m512 const v{ _mm512_loadu_ps(p + i) };
+      mn = _mm512_min_ps(mn, v);
+      mx = _mm512_max_ps(mx, v);
+      __m256 const high{ _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)) };
+      sum = _mm512_add_pd(sum, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+      sum = _mm512_add_pd(sum, _mm512_cvtps_pd(high));
+      __mmask16 const in{ _mm512_mask_cmp_ps_mask(_mm512_cmp_ps_mask(v, vlo, _CMP_GE_OQ),
+                                                  v, vhi, _CMP_LE_OQ) };
+      count = _mm512_mask_add_epi32(count, in, count, one);
+    }
+
+    alignas(64) double s[N / 2];
+    alignas(64) uint32_t c[N];
+    _mm512_store_pd(s, sum);
+    _mm512_store_si512(c, count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(64) float lmn[N];
+  alignas(64) float lmx[N];
+  _mm512_store_ps(lmn, mn);
+  _mm512_store_ps(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx512f"))) void
+reduceAvx512(double const *p, size_t n, double lo, double hi, ReduceResult &r)
+{
+  size_t const N{ 8 };
+  if (n < N) {
+    reduceScalar(p, n, lo, hi, r);
+    return;
+  }
+
+  __m512i const one{ _mm512_set1_epi64(1) };
+  __m512d const vlo{ _mm512_set1_pd(lo) };
+  __m512d const vhi{ _mm512_set1_pd(hi) };
+  __m512d mn{ _mm512_set1_pd(std::numeric_limits<double>::max()) };
+  __m512d mx{ _mm512_set1_pd(std::numeric_limits<double>::lowest()) };
+
+  size_t i{ 0 };
+  while (n - i >= N) {
+    size_t const end{ chunkEnd(i, n, N) };
+    __m512d sum{ _mm512_setzero_pd() };
+    __m512i count{ _mm512_setzero_si512() };
+    for (; i < end; i += N) {
+      __m512d const v{ _mm512_loadu_pd(p + i) };
+      mn = _mm512_min_pd(mn, v);
+      mx = _mm512_max_pd(mx, v);
+      sum = _mm512_add_pd(sum, v);
+      __mmask8 const in{ _mm512_mask_cmp_pd_mask(_mm512_cmp_pd_mask(v, vlo, _CMP_GE_OQ),
+                                                 v, vhi, _CMP_LE_OQ) };
+      count = _mm512_mask_add_epi64(count, in, count, one);
+    }
+
+    alignas(64) double s[N];
+    alignas(64) uint64_t c[N];
+    _mm512_store_pd(s, sum);
+    _mm512_store_si512(c, count);
+    foldSum(s, r);
+    foldCount(c, r);
+  }
+
+  alignas(64) double lmn[N];
+  alignas(64) double lmx[N];
+  _mm512_store_pd(lmn, mn);
+  _mm512_store_pd(lmx, mx);
+  foldMinMax(lmn, lmx, r);
+
+  reduceScalar(p + i, n - i, lo, hi, r);
+}
+
+
+#pragma GCC diagnostic pop
+
+#endif // BD_SIMD_X86
+
+
+///////////////////////////////////////////////////////////////////////////////
+SimdLevel
+findSimdLevel()
+{
+#ifdef BD_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::Avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::Avx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::Sse2;
+  }
+#endif
+  return SimdLevel::Scalar;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+ReduceResult
+reduceAs(void const *data, size_t n, double lo, double hi)
+{
+  return reduce(static_cast<Ty const *>(data), n, lo, hi);
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::string
+to_string(SimdLevel l)
+{
+  switch (l) {
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    case SimdLevel::Scalar:
+    default: return "scalar";
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SimdLevel
+detectSimdLevel()
+{
+  static SimdLevel const level{ findSimdLevel() };
+  return level;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+ReduceResult
+reduce(Ty const *data, size_t n, double lo, double hi)
+{
+  return reduce(data, n, lo, hi, detectSimdLevel());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+template<class Ty>
+ReduceResult
+reduce(Ty const *data, size_t n, double lo, double hi, SimdLevel level)
+{
+  typename Lane<Ty>::Cmp clo, chi;
+  toCmpRange<Ty>(lo, hi, clo, chi);
+
+  ReduceResult r{ emptyResult() };
+  switch (std::min(level, detectSimdLevel())) {
+#ifdef BD_SIMD_X86
+    case SimdLevel::Avx512: reduceAvx512(data, n, clo, chi, r); break;
+    case SimdLevel::Avx2:   reduceAvx2(data, n, clo, chi, r); break;
+    case SimdLevel::Sse2:   reduceSse2(data, n, clo, chi, r); break;
+#endif
+    default:                reduceScalar(data, n, clo, chi, r); break;
+  }
+
+  // The vector range test assumes lo <= hi.
+  if (clo > chi) {
+    r.inRange = 0;
+  }
+  return r;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+reduce(DataType type, void const *data, size_t n, double lo, double hi,
+       ReduceResult &result)
+{
+  switch (type) {
+    case DataType::Character:         result = reduceAs<char>(data, n, lo, hi); break;
+    case DataType::UnsignedCharacter: result = reduceAs<unsigned char>(data, n, lo, hi); break;
+    case DataType::Short:             result = reduceAs<short>(data, n, lo, hi); break;
+    case DataType::UnsignedShort:     result = reduceAs<unsigned short>(data, n, lo, hi); break;
+    case DataType::Integer:           result = reduceAs<int>(data, n, lo, hi); break;
+    case DataType::UnsignedInteger:   result = reduceAs<unsigned int>(data, n, lo, hi); break;
+    case DataType::Float:             result = reduceAs<float>(data, n, lo, hi); break;
+    case DataType::Double:            result = reduceAs<double>(data, n, lo, hi); break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+
+#define BD_REDUCE_INSTANTIATE(Ty)                                              \
+  template ReduceResult reduce<Ty>(Ty const *, size_t, double, double);        \
+  template ReduceResult reduce<Ty>(Ty const *, size_t, double, double, SimdLevel);
+
+BD_REDUCE_INSTANTIATE(char)
+BD_REDUCE_INSTANTIATE(unsigned char)
+BD_REDUCE_INSTANTIATE(short)
+BD_REDUCE_INSTANTIATE(unsigned short)
+BD_REDUCE_INSTANTIATE(int)
+BD_REDUCE_INSTANTIATE(unsigned int)
+BD_REDUCE_INSTANTIATE(float)
+BD_REDUCE_INSTANTIATE(double)
+
+#undef BD_REDUCE_INSTANTIATE
+
+} // namespace bd
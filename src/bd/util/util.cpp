@@ -6,6 +6,7 @@
 
 #include <glm/glm.hpp>
 #include <algorithm>
+#include <cstdint>
 
 namespace bd
 {
@@ -98,6 +99,146 @@ to1D(size_t col, size_t row, size_t slab, size_t maxCols, size_t maxRows)
 }
 
 
+namespace
+{
+
+/// Spread the low 21 bits of v out to every third bit.
+uint64_t
+spreadBits(uint64_t v)
+{
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+
+/// Gather every third bit of v back into the low 21 bits.
+uint64_t
+compactBits(uint64_t v)
+{
+  v &= 0x1249249249249249ULL;
+  v = (v ^ v >> 2) & 0x10c30c30c30c30c3ULL;
+  v = (v ^ v >> 4) & 0x100f00f00f00f00fULL;
+  v = (v ^ v >> 8) & 0x1f0000ff0000ffULL;
+  v = (v ^ v >> 16) & 0x1f00000000ffffULL;
+  v = (v ^ v >> 32) & 0x1fffff;
+  return v;
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+toMorton(size_t col, size_t row, size_t slab)
+{
+  return spreadBits(col) | spreadBits(row) << 1 | spreadBits(slab) << 2;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+fromMorton(size_t code, size_t &col, size_t &row, size_t &slab)
+{
+  col = compactBits(code);
+  row = compactBits(code >> 1);
+  slab = compactBits(code >> 2);
+}
+
+
+// The Hilbert curve conversions are J. Skilling's, "Programming the Hilbert
+// curve" (AIP Conf. Proc. 707, 2004): the coordinates are turned into the
+// "transposed" Hilbert index in place, whose bits are then interleaved
+// like a Morton code, but with x in the highest bit of each triple.
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+toHilbert(size_t col, size_t row, size_t slab, unsigned bits)
+{
+  uint64_t x[3]{ col, row, slab };
+  uint64_t const m{ uint64_t(1) << ( bits - 1 ) };
+
+  // Inverse undo.
+  for (uint64_t q{ m }; q > 1; q >>= 1) {
+    uint64_t const p{ q - 1 };
+    for (int i{ 0 }; i < 3; ++i) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      } else {
+        uint64_t const t{ ( x[0] ^ x[i] ) & p };
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode.
+  x[1] ^= x[0];
+  x[2] ^= x[1];
+  uint64_t t{ 0 };
+  for (uint64_t q{ m }; q > 1; q >>= 1) {
+    if (x[2] & q) {
+      t ^= q - 1;
+    }
+  }
+  x[0] ^= t;
+  x[1] ^= t;
+  x[2] ^= t;
+
+  return spreadBits(x[2]) | spreadBits(x[1]) << 1 | spreadBits(x[0]) << 2;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+fromHilbert(size_t code, unsigned bits, size_t &col, size_t &row, size_t &slab)
+{
+  uint64_t x[3]{ compactBits(code >> 2), compactBits(code >> 1), compactBits(code) };
+  uint64_t const n{ uint64_t(2) << ( bits - 1 ) };
+
+  // Gray decode.
+  uint64_t t{ x[2] >> 1 };
+  x[2] ^= x[1];
+  x[1] ^= x[0];
+  x[0] ^= t;
+
+  // Undo excess work.
+  for (uint64_t q{ 2 }; q != n; q <<= 1) {
+    uint64_t const p{ q - 1 };
+    for (int i{ 2 }; i >= 0; --i) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      } else {
+        uint64_t const u{ ( x[0] ^ x[i] ) & p };
+        x[0] ^= u;
+        x[i] ^= u;
+      }
+    }
+  }
+
+  col = x[0];
+  row = x[1];
+  slab = x[2];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+unsigned
+curveBits(size_t n)
+{
+  unsigned bits{ 1 };
+  while (bits < 64 && ( size_t(1) << bits ) < n) {
+    ++bits;
+  }
+  return bits;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 unsigned long long
 vecCompMult(const glm::u64vec3 &v)
@@ -0,0 +1,294 @@
+#include <bd/volume/blockloader.h>
+#include <bd/io/blockio.h>
+#include <bd/io/brickedvolume.h>
+#include <bd/io/datatypes.h>
+#include <bd/log/logger.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace bd
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockLoader::BlockLoader(IndexFile const &index, size_t maxResident, int numWorkers)
+  : m_index{ &index }
+  , m_maxResident{ maxResident > 0 ? maxResident : 1 }
+  , m_numWorkers{ numWorkers > 0 ? numWorkers : 1 }
+  , m_fd{ -1 }
+  , m_tySize{ 0 }
+  , m_halo{ 0 }
+  , m_slabBytes{ 0 }
+  , m_slabMemory{ }
+  , m_freeSlabs{ }
+  , m_requests{ }
+  , m_wanted{ }
+  , m_nextGeneration{ 0 }
+  , m_loaded{ }
+  , m_workers{ }
+  , m_stop{ false }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BlockLoader::~BlockLoader()
+{
+  stop();
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockLoader::open(std::string const &path)
+{
+  m_tySize = to_sizeType(IndexFileHeader::getType(m_index->getHeader()));
+  if (m_tySize == 0) {
+    Err() << "Unknown data type in index file, can't load blocks.";
+    return false;
+  }
+
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    Err() << "Unable to open file: " + path;
+    return false;
+  }
+
+  // Textures are made to the voxel_dims of the blocks, so the halo is read
+  // into the slab and then dropped.
+  m_halo = brickHalo(*m_index);
+  m_slabBytes = m_tySize;
+  for (FileBlock const &b : m_index->blocks()) {
+    size_t bytes{ fileBlockBrickBytes(b, m_tySize, m_halo) };
+    if (bytes > m_slabBytes) {
+      m_slabBytes = bytes;
+    }
+  }
+
+  PoolAllocPolicy policy;
+  policy.alignment = 64;
+  if (! m_slabMemory.allocate(m_slabBytes * m_maxResident, policy)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lck(m_lock);
+  m_freeSlabs.clear();
+  char *mem{ static_cast<char *>(m_slabMemory.ptr()) };
+  for (size_t i{ 0 }; i < m_maxResident; ++i) {
+    m_freeSlabs.push_back(mem + i * m_slabBytes);
+  }
+
+  Info() << "Block loader has " << m_maxResident << " slabs of " << m_slabBytes << " bytes.";
+  return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::start()
+{
+  m_stop = false;
+  for (int i{ 0 }; i < m_numWorkers; ++i) {
+    m_workers.push_back(std::thread{ [this]() { work(); } });
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::stop()
+{
+  {
+    std::lock_guard<std::mutex> lck(m_lock);
+    m_stop = true;
+  }
+  m_workAvailable.notify_all();
+
+  for (std::thread &t : m_workers) {
+    t.join();
+  }
+  m_workers.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::request(Block *b, float priority)
+{
+  if (b == nullptr || b->pixelData() != nullptr) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lck(m_lock);
+    auto it = m_wanted.find(b);
+    if (it != m_wanted.end() && it->second.reading) {
+      return;
+    }
+
+    // The older entry, if any, goes stale and is skipped by the workers.
+    uint64_t const gen{ ++m_nextGeneration };
+    m_wanted[b] = Want{ gen, false };
+    m_requests.push(Request{ priority, gen, b });
+  }
+  m_workAvailable.notify_one();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::cancel(Block *b)
+{
+  std::lock_guard<std::mutex> lck(m_lock);
+  m_wanted.erase(b);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::cancelAll()
+{
+  std::lock_guard<std::mutex> lck(m_lock);
+  m_wanted.clear();
+  m_requests = decltype(m_requests){ };
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockLoader::deliver(size_t max)
+{
+  size_t delivered{ 0 };
+  Loaded l;
+  while (delivered < max && m_loaded.tryPop(l)) {
+    bool wanted{ false };
+    {
+      std::lock_guard<std::mutex> lck(m_lock);
+      wanted = isWanted(l.block, l.generation);
+      if (wanted) {
+        m_wanted.erase(l.block);
+      }
+    }
+
+    if (! wanted) {
+      releaseSlab(l.data);
+      continue;
+    }
+
+    l.block->pixelData(l.data);
+    ++delivered;
+  }
+
+  return delivered;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::evict(Block *b)
+{
+  char *data{ b->removePixelData() };
+  if (data) {
+    releaseSlab(data);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockLoader::outstanding() const
+{
+  std::lock_guard<std::mutex> lck(m_lock);
+  return m_wanted.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+BlockLoader::slabBytes() const
+{
+  return m_slabBytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::work()
+{
+  glm::u64vec3 const volDims{ m_index->getVolume().voxelDims() };
+  std::vector<char> scratch;
+
+  while (true) {
+    Request r;
+    char *slab{ nullptr };
+    {
+      std::unique_lock<std::mutex> lck(m_lock);
+      while (true) {
+        if (m_stop) {
+          return;
+        }
+        // Throw away requests that were cancelled or re-requested.
+        while (! m_requests.empty() &&
+               ! isWanted(m_requests.top().block, m_requests.top().generation)) {
+          m_requests.pop();
+        }
+        if (! m_requests.empty() && ! m_freeSlabs.empty()) {
+          break;
+        }
+        m_workAvailable.wait(lck);
+      }
+
+      r = m_requests.top();
+      m_requests.pop();
+      m_wanted[r.block].reading = true;
+      slab = m_freeSlabs.back();
+      m_freeSlabs.pop_back();
+    }
+
+    long long bytes{
+        readBlockData(m_fd, m_index->getHeader(), r.block->fileBlock(), volDims,
+                      m_tySize, slab, scratch, m_halo) };
+    if (bytes < 0) {
+      Err() << "Could not load block " << r.block->index();
+      {
+        std::lock_guard<std::mutex> lck(m_lock);
+        if (isWanted(r.block, r.generation)) {
+          m_wanted.erase(r.block);
+        }
+      }
+      releaseSlab(slab);
+      continue;
+    }
+    stripHalo(slab, r.block->fileBlock(), m_tySize, m_halo);
+
+    m_loaded.push(Loaded{ r.block, r.generation, slab });
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+BlockLoader::isWanted(Block *b, uint64_t generation) const
+{
+  auto it = m_wanted.find(b);
+  return it != m_wanted.end() && it->second.generation == generation;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+BlockLoader::releaseSlab(char *slab)
+{
+  {
+    std::lock_guard<std::mutex> lck(m_lock);
+    m_freeSlabs.push_back(slab);
+  }
+  m_workAvailable.notify_one();
+}
+
+
+} // namespace bd
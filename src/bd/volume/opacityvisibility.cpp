@@ -0,0 +1,115 @@
+#include <bd/volume/opacityvisibility.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bd
+{
+
+
+///////////////////////////////////////////////////////////////////////////////
+OpacityVisibility::OpacityVisibility()
+  : m_prefix(2, 0)
+  , m_lo{ 0.0 }
+  , m_scale{ 0.0 }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+OpacityVisibility::OpacityVisibility(OpacityLUT const &lut, double threshold)
+  : OpacityVisibility()
+{
+  update(lut, threshold);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+OpacityVisibility::update(OpacityLUT const &lut, double threshold)
+{
+  size_t const n{ lut.size() };
+  m_prefix.resize(n + 1);
+  m_prefix[0] = 0;
+  for (size_t i{ 0 }; i < n; ++i) {
+    m_prefix[i + 1] = m_prefix[i] + ( lut[i] > threshold ? 1 : 0 );
+  }
+
+  m_lo = lut.lo();
+  m_scale = lut.hi() > lut.lo() && n > 1 ? ( n - 1 ) / ( lut.hi() - lut.lo() ) : 0.0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+OpacityVisibility::size() const
+{
+  return m_prefix.size() - 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+OpacityVisibility::entryBelow(double v) const
+{
+  double const x{ std::floor(( v - m_lo ) * m_scale) };
+  return static_cast<size_t>(std::min(static_cast<double>(size() - 1), std::max(0.0, x)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+OpacityVisibility::entryAbove(double v) const
+{
+  double const x{ std::ceil(( v - m_lo ) * m_scale) };
+  return static_cast<size_t>(std::min(static_cast<double>(size() - 1), std::max(0.0, x)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+uint64_t
+OpacityVisibility::visibleEntries(double lo, double hi) const
+{
+  if (! ( lo <= hi )) {
+    return 0;
+  }
+  return m_prefix[entryAbove(hi) + 1] - m_prefix[entryBelow(lo)];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+OpacityVisibility::isVisible(double lo, double hi) const
+{
+  return visibleEntries(lo, hi) > 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<uint8_t>
+OpacityVisibility::table2D(size_t n) const
+{
+  std::vector<uint8_t> table(n * n, 0);
+  size_t const entries{ size() };
+  for (size_t i{ 0 }; i < n; ++i) {
+    // One entry past each end of the bins, like visibleEntries().
+    size_t const start{ i * entries / n };
+    size_t const first{ start > 0 ? start - 1 : 0 };
+    for (size_t j{ i }; j < n; ++j) {
+      size_t const end{ std::min(entries, std::max(( j + 1 ) * entries / n, start + 1) + 1) };
+      table[i * n + j] = m_prefix[end] - m_prefix[first] > 0 ? 1 : 0;
+    }
+  }
+  return table;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+isBlockVisible(FileBlock const &block, OpacityVisibility const &visibility)
+{
+  return visibility.isVisible(block.min_val, block.max_val);
+}
+
+
+} // namespace bd
@@ -0,0 +1,209 @@
+#include <bd/volume/preintegratedtable.h>
+#include <bd/volume/transferfunctionlut.h>
+#include <bd/log/logger.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace bd
+{
+
+namespace
+{
+
+/// Opacities are clamped below 1 so the extinction stays finite.
+double const MAX_ALPHA{ 0.9999 };
+
+
+float
+clampUnit(double v)
+{
+  return static_cast<float>(std::min(1.0, std::max(0.0, v)));
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+PreIntegratedTable::PreIntegratedTable()
+  : m_size{ 0 }
+  , m_stepSize{ 1.0 }
+  , m_rgbTau{ }
+  , m_table{ }
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+PreIntegratedTable::build(ColorTransferFunction const &color,
+                          OpacityTransferFunction const &opacity,
+                          size_t size,
+                          double stepSize)
+{
+  m_size = std::max<size_t>(size, 2);
+  m_stepSize = stepSize;
+  m_table.assign(m_size * m_size * 4, 0.0f);
+  sample(color, opacity, m_rgbTau);
+  integrate(0, m_size - 1);
+
+  Dbg() << "Pre-integrated a " << m_size << "x" << m_size << " table, step size "
+        << m_stepSize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+PreIntegratedTable::update(ColorTransferFunction const &color,
+                           OpacityTransferFunction const &opacity)
+{
+  if (m_size == 0) {
+    Err() << "Build the pre-integrated table before updating it.";
+    return 0;
+  }
+
+  std::vector<float> fresh;
+  sample(color, opacity, fresh);
+
+  // The span of scalars whose samples changed.
+  size_t lo{ m_size };
+  size_t hi{ 0 };
+  for (size_t i{ 0 }; i < m_size; ++i) {
+    if (! std::equal(&fresh[i * 4], &fresh[i * 4] + 4, &m_rgbTau[i * 4])) {
+      lo = std::min(lo, i);
+      hi = i;
+    }
+  }
+  if (lo > hi) {
+    return 0;
+  }
+
+  m_rgbTau.swap(fresh);
+  return integrate(lo, hi);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+PreIntegratedTable::size() const
+{
+  return m_size;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double
+PreIntegratedTable::stepSize() const
+{
+  return m_stepSize;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+float const *
+PreIntegratedTable::data() const
+{
+  return m_table.data();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+float const *
+PreIntegratedTable::entry(size_t front, size_t back) const
+{
+  return &m_table[( back * m_size + front ) * 4];
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+PreIntegratedTable::sample(ColorTransferFunction const &color,
+                           OpacityTransferFunction const &opacity,
+                           std::vector<float> &rgbTau) const
+{
+  ColorLUT const colors{ color, m_size };
+  OpacityLUT const alphas{ opacity, m_size };
+
+  rgbTau.resize(m_size * 4);
+  for (size_t i{ 0 }; i < m_size; ++i) {
+    double const a{ std::min(MAX_ALPHA, std::max(0.0, alphas[i])) };
+    // interpolate() can overshoot between knots, keep colors premultipliable.
+    rgbTau[i * 4 + 0] = clampUnit(colors[i].r);
+    rgbTau[i * 4 + 1] = clampUnit(colors[i].g);
+    rgbTau[i * 4 + 2] = clampUnit(colors[i].b);
+    rgbTau[i * 4 + 3] = static_cast<float>(-std::log(1.0 - a));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+size_t
+PreIntegratedTable::integrate(size_t lo, size_t hi)
+{
+  // A segment crosses [lo, hi] unless both its ends are below lo or both
+  // are above hi, so a row of back values needs the fronts on the far side.
+  return tbb::parallel_reduce(
+      tbb::blocked_range<size_t>{ 0, m_size },
+      size_t{ 0 },
+      [this, lo, hi](tbb::blocked_range<size_t> const &r, size_t done) -> size_t {
+        for (size_t back{ r.begin() }; back != r.end(); ++back) {
+          size_t first{ 0 };
+          size_t last{ m_size - 1 };
+          if (back < lo) {
+            first = lo;
+          } else if (back > hi) {
+            last = hi;
+          }
+          for (size_t front{ first }; front <= last; ++front) {
+            integrateEntry(front, back, &m_table[( back * m_size + front ) * 4]);
+          }
+          done += last - first + 1;
+        }
+        return done;
+      },
+      std::plus<size_t>());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void
+PreIntegratedTable::integrateEntry(size_t front, size_t back, float *rgba) const
+{
+  size_t const steps{ std::max<size_t>(1, front > back ? front - back : back - front) };
+  double const ds{ m_stepSize / steps };
+  double const from{ static_cast<double>(front) };
+  double const span{ static_cast<double>(back) - from };
+
+  double r{ 0.0 }, g{ 0.0 }, b{ 0.0 }, a{ 0.0 };
+  for (size_t k{ 0 }; k < steps; ++k) {
+    // Midpoint of the sub-step, between two samples of the functions.
+    double const s{ from + span * ( k + 0.5 ) / steps };
+    size_t const i0{ std::min(static_cast<size_t>(s), m_size - 1) };
+    size_t const i1{ std::min(i0 + 1, m_size - 1) };
+    double const t{ s - i0 };
+
+    float const *p0{ &m_rgbTau[i0 * 4] };
+    float const *p1{ &m_rgbTau[i1 * 4] };
+    double const tau{ p0[3] * ( 1.0 - t ) + p1[3] * t };
+    double const alpha{ 1.0 - std::exp(-tau * ds) };
+    double const w{ ( 1.0 - a ) * alpha };
+
+    r += w * ( p0[0] * ( 1.0 - t ) + p1[0] * t );
+    g += w * ( p0[1] * ( 1.0 - t ) + p1[1] * t );
+    b += w * ( p0[2] * ( 1.0 - t ) + p1[2] * t );
+    a += w;
+  }
+
+  rgba[0] = static_cast<float>(r);
+  rgba[1] = static_cast<float>(g);
+  rgba[2] = static_cast<float>(b);
+  rgba[3] = static_cast<float>(a);
+}
+
+
+} // namespace bd
@@ -101,6 +101,14 @@ Volume::block_dims() const
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+Volume::block_dims(glm::u64vec3 const &dims)
+{
+  m_blockDims = dims;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 const glm::u64vec3&
 Volume::block_count() const
@@ -118,6 +126,30 @@ Volume::block_count(const glm::u64vec3 &nb)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+void
+Volume::block_count(glm::u64vec3 const &nb, EdgeBlocks edges)
+{
+  if (edges == EdgeBlocks::Drop) {
+    block_count(nb);
+    return;
+  }
+
+  glm::u64vec3 const one{ 1 };
+  glm::u64vec3 const n{ glm::max(nb, one) };
+  m_blockDims = glm::max(( m_voxelDims + n - one ) / n, one);
+  m_blockCount = glm::max(( m_voxelDims + m_blockDims - one ) / m_blockDims, one);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+bool
+Volume::hasRaggedBlocks() const
+{
+  return glm::any(glm::greaterThan(m_blockCount * m_blockDims, m_voxelDims));
+}
+
+
 uint64_t
 Volume::total_block_count() const
 {
@@ -283,7 +315,8 @@ Volume::numEmptyVoxels() const
 glm::u64vec3
 Volume::blocksExtent() const
 {
-  return m_blockCount * m_blockDims; // component-wise multiply
+  // component-wise; ragged edge blocks stop at the end of the volume.
+  return glm::min(m_blockCount * m_blockDims, m_voxelDims);
 }
 
 
@@ -0,0 +1,113 @@
+//
+// Measures the cost of handing buffers between producer and consumer threads
+// through each BufferPool queue type.
+//
+// usage: bench_bufferpool [hand offs per producer] [buffers]
+//
+
+#include <bd/io/bufferpool.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+char const *
+queueName(bd::PoolQueue q)
+{
+  switch (q) {
+    case bd::PoolQueue::Spsc: return "spsc";
+    case bd::PoolQueue::Mpmc: return "mpmc";
+    case bd::PoolQueue::Locked:
+    default: return "locked";
+  }
+}
+
+
+/// \brief Pass \c perProducer buffers from each producer to the consumers.
+/// \return Average wall clock nanoseconds per hand off.
+double
+run(bd::PoolQueue q, int producers, int consumers, long perProducer, int nbufs)
+{
+  bd::BufferPool<int> pool{ nbufs * 64 * sizeof(int), nbufs };
+  pool.setQueueType(q);
+  pool.setNumProducers(producers);
+  pool.allocate();
+
+  std::atomic<long> consumed{ 0 };
+  std::vector<std::thread> threads;
+
+  auto const start = std::chrono::steady_clock::now();
+  for (int p{ 0 }; p < producers; ++p) {
+    threads.push_back(std::thread{ [&]() {
+      for (long i{ 0 }; i < perProducer; ++i) {
+        bd::Buffer<int> *buf{ pool.nextEmpty() };
+        if (buf == nullptr) {
+          break;
+        }
+        buf->getPtr()[0] = static_cast<int>(i);
+        pool.returnFull(buf);
+      }
+      pool.producerDone();
+    }});
+  }
+
+  for (int c{ 0 }; c < consumers; ++c) {
+    threads.push_back(std::thread{ [&]() {
+      bd::Buffer<int> *buf{ nullptr };
+      while ((buf = pool.nextFullUntilNone()) != nullptr) {
+        consumed += 1;
+        pool.returnEmpty(buf);
+      }
+    }});
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+  auto const end = std::chrono::steady_clock::now();
+
+  double ns{ static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) };
+  return ns / static_cast<double>(consumed.load());
+}
+
+} // namespace
+
+
+int
+main(int argc, char *argv[])
+{
+  long const perProducer{ argc > 1 ? std::atol(argv[1]) : 1000000 };
+  int const nbufs{ argc > 2 ? std::atoi(argv[2]) : 8 };
+
+  struct Case
+  {
+    bd::PoolQueue q;
+    int producers;
+    int consumers;
+  };
+  Case const cases[]{
+      { bd::PoolQueue::Locked, 1, 1 },
+      { bd::PoolQueue::Spsc, 1, 1 },
+      { bd::PoolQueue::Mpmc, 1, 1 },
+      { bd::PoolQueue::Locked, 4, 4 },
+      { bd::PoolQueue::Mpmc, 4, 4 } };
+
+  std::cout << "queue   producers consumers  ns/hand off\n";
+  for (Case const &c : cases) {
+    double ns{ run(c.q, c.producers, c.consumers, perProducer / c.producers, nbufs) };
+    std::cout << std::left << std::setw(8) << queueName(c.q)
+              << std::setw(10) << c.producers
+              << std::setw(11) << c.consumers
+              << std::fixed << std::setprecision(1) << ns << '\n';
+  }
+
+  return 0;
+}
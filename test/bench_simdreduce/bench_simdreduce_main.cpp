@@ -0,0 +1,90 @@
+//
+// Measures the throughput of the min/max/sum/count-in-range kernels for
+// every voxel type at every SIMD level this CPU supports.
+//
+// usage: bench_simdreduce [MiB per type] [repetitions]
+//
+
+#include <bd/util/simdreduce.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/// \brief Reduce \c bytes of random Ty values \c reps times at \c level.
+/// \return Bytes reduced per second.
+template<class Ty>
+double
+run(size_t bytes, int reps, bd::SimdLevel level)
+{
+  std::vector<Ty> data(bytes / sizeof(Ty));
+  std::mt19937 gen{ 1234 };
+  std::uniform_int_distribution<int> dist{ 0, 100 };
+  for (Ty &v : data) {
+    v = static_cast<Ty>(dist(gen));
+  }
+
+  // Touch the data once so the first repetition doesn't pay for page faults.
+  volatile double sink{ bd::reduce(data.data(), data.size(), 25, 75, level).sum };
+
+  auto const start = std::chrono::steady_clock::now();
+  for (int r{ 0 }; r < reps; ++r) {
+    sink = sink + bd::reduce(data.data(), data.size(), 25, 75, level).sum;
+  }
+  std::chrono::duration<double> const secs{ std::chrono::steady_clock::now() - start };
+
+  return static_cast<double>(data.size() * sizeof(Ty)) * reps / secs.count();
+}
+
+
+template<class Ty>
+void
+runAll(char const *name, size_t bytes, int reps)
+{
+  std::cout << std::setw(16) << name;
+  for (int l{ 0 }; l <= static_cast<int>(bd::SimdLevel::Avx512); ++l) {
+    bd::SimdLevel const level{ static_cast<bd::SimdLevel>(l) };
+    if (level > bd::detectSimdLevel()) {
+      std::cout << std::setw(12) << "-";
+      continue;
+    }
+    std::cout << std::setw(12) << std::fixed << std::setprecision(2)
+              << run<Ty>(bytes, reps, level) / ( 1 << 30 );
+  }
+  std::cout << "\n";
+}
+
+} // namespace
+
+
+int
+main(int argc, char *argv[])
+{
+  size_t const mib{ argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64 };
+  int const reps{ argc > 2 ? std::atoi(argv[2]) : 10 };
+  size_t const bytes{ mib << 20 };
+
+  std::cout << "GiB/s reducing " << mib << " MiB per type, " << reps << " repetitions\n"
+            << std::setw(16) << "type";
+  for (int l{ 0 }; l <= static_cast<int>(bd::SimdLevel::Avx512); ++l) {
+    std::cout << std::setw(12) << bd::to_string(static_cast<bd::SimdLevel>(l));
+  }
+  std::cout << "\n";
+
+  runAll<char>("char", bytes, reps);
+  runAll<unsigned char>("unsigned char", bytes, reps);
+  runAll<short>("short", bytes, reps);
+  runAll<unsigned short>("unsigned short", bytes, reps);
+  runAll<int>("int", bytes, reps);
+  runAll<unsigned int>("unsigned int", bytes, reps);
+  runAll<float>("float", bytes, reps);
+  runAll<double>("double", bytes, reps);
+
+  return 0;
+}
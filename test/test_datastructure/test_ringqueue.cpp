@@ -0,0 +1,136 @@
+#include <bd/datastructure/ringqueue.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+TEST_CASE("SpscRing keeps items in order and reports full and empty", "[ringqueue]")
+{
+  bd::SpscRing<int> ring{ 3 }; // rounded up to 4
+  int item{ -1 };
+
+  REQUIRE_FALSE(ring.tryPop(item));
+  for (int i{ 0 }; i < 4; ++i) {
+    REQUIRE(ring.tryPush(i));
+  }
+  REQUIRE_FALSE(ring.tryPush(4));
+  REQUIRE(ring.size() == 4);
+
+  for (int i{ 0 }; i < 4; ++i) {
+    REQUIRE(ring.tryPop(item));
+    REQUIRE(item == i);
+  }
+  REQUIRE_FALSE(ring.tryPop(item));
+}
+
+
+TEST_CASE("SpscRing passes items between two threads in order", "[ringqueue]")
+{
+  int const N{ 200000 };
+  bd::SpscRing<int> ring{ 16 };
+  bd::WaitEvent notEmpty;
+  bd::WaitEvent notFull;
+  std::atomic_bool done{ false };
+
+  std::thread producer{ [&]() {
+    for (int i{ 0 }; i < N; ++i) {
+      while (! ring.tryPush(i)) {
+        uint32_t token{ notFull.prepareWait() };
+        if (ring.tryPush(i)) {
+          notFull.cancelWait();
+          break;
+        }
+        notFull.wait(token);
+      }
+      notEmpty.notify();
+    }
+    done = true;
+    notEmpty.notifyAll();
+  }};
+
+  int expected{ 0 };
+  int item{ 0 };
+  bool inOrder{ true };
+  while (bd::popOrWait(ring, notEmpty, item, [&]() { return done.load(); })) {
+    inOrder = inOrder && item == expected;
+    ++expected;
+    notFull.notify();
+  }
+  producer.join();
+
+  REQUIRE(inOrder);
+  REQUIRE(expected == N);
+}
+
+
+TEST_CASE("popOrWait returns an item pushed just before giving up", "[ringqueue]")
+{
+  bd::SpscRing<int> ring{ 4 };
+  bd::WaitEvent notEmpty;
+  int item{ -1 };
+
+  // The producer's last push and its stop both land after the consumer's
+  // tryPop failed, right before give_up is asked.
+  bool stopped{ false };
+  auto pushThenStop = [&]() {
+    if (! stopped) {
+      ring.tryPush(42);
+      stopped = true;
+    }
+    return true;
+  };
+
+  REQUIRE(bd::popOrWait(ring, notEmpty, item, pushThenStop));
+  REQUIRE(item == 42);
+  REQUIRE_FALSE(bd::popOrWait(ring, notEmpty, item, pushThenStop));
+}
+
+
+TEST_CASE("MpmcRing delivers every item exactly once", "[ringqueue]")
+{
+  int const perProducer{ 50000 };
+  int const numProducers{ 4 };
+  int const numConsumers{ 4 };
+  bd::MpmcRing<long long> ring{ 64 };
+  bd::WaitEvent notEmpty;
+  std::atomic_int producersLeft{ numProducers };
+  std::atomic<long long> sum{ 0 };
+  std::atomic<long long> count{ 0 };
+
+  std::vector<std::thread> threads;
+  for (int p{ 0 }; p < numProducers; ++p) {
+    threads.push_back(std::thread{ [&, p]() {
+      for (int i{ 0 }; i < perProducer; ++i) {
+        long long v{ static_cast<long long>(p) * perProducer + i };
+        while (! ring.tryPush(v)) {
+          std::this_thread::yield();
+        }
+        notEmpty.notify();
+      }
+      if (--producersLeft == 0) {
+        notEmpty.notifyAll();
+      }
+    }});
+  }
+
+  for (int c{ 0 }; c < numConsumers; ++c) {
+    threads.push_back(std::thread{ [&]() {
+      long long v{ 0 };
+      while (bd::popOrWait(ring, notEmpty, v, [&]() { return producersLeft.load() == 0; })) {
+        sum += v;
+        ++count;
+      }
+    }});
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  long long const n{ static_cast<long long>(numProducers) * perProducer };
+  REQUIRE(count == n);
+  REQUIRE(sum == n * (n - 1) / 2);
+}
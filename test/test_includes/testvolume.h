@@ -0,0 +1,49 @@
+#ifndef bd_test_testvolume_h
+#define bd_test_testvolume_h
+
+#include <bd/io/indexfile.h>
+
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <vector>
+
+/// \brief Path of the 8x8x8 unsigned char test volume.
+#define TEST_VOLUME_PATH RESOURCE_FOLDER "/testvol_8x8x8.raw"
+
+
+/// \brief The 512 bytes of the test volume, as elements of type Ty.
+template<class Ty>
+inline std::vector<Ty>
+readTestVolume()
+{
+  std::ifstream in(TEST_VOLUME_PATH, std::ios::binary);
+  std::vector<Ty> vol(512 / sizeof(Ty), Ty());
+  in.read(reinterpret_cast<char *>(vol.data()), 512);
+  return vol;
+}
+
+
+/// \brief Lay \c index out over a volume of \c voxelDims voxels of \c type,
+///        split into \c blockCount blocks.
+inline void
+makeIndex(bd::IndexFile &index,
+          glm::u64vec3 const &blockCount,
+          glm::u64vec3 const &voxelDims,
+          bd::DataType type)
+{
+  index.getVolume().block_count(blockCount);
+  index.getVolume().voxelDims(voxelDims);
+  index.init(type);
+}
+
+
+/// \brief Lay \c index out over the test volume, split into \c blockCount blocks.
+inline void
+makeTestIndex(bd::IndexFile &index, glm::u64vec3 const &blockCount = glm::u64vec3{ 2, 2, 2 })
+{
+  makeIndex(index, blockCount, { 8, 8, 8 }, bd::DataType::UnsignedCharacter);
+  index.setRawFileName(TEST_VOLUME_PATH);
+}
+
+#endif // ! bd_test_testvolume_h
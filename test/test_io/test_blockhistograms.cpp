@@ -0,0 +1,126 @@
+#include <bd/io/blockhistograms.h>
+#include <bd/io/indexfile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+bd::OpacityTransferFunction
+makeOtf()
+{
+  std::string const path{ "test_blockhistograms.1dt" };
+  {
+    std::ofstream os(path);
+    os << "5\n0.0 0.0\n0.25 0.1\n0.5 0.8\n0.75 0.9\n1.0 1.0\n";
+  }
+  bd::OpacityTransferFunction otf;
+  otf.load(path);
+  std::remove(path.c_str());
+  return otf;
+}
+
+} // namespace
+
+
+TEST_CASE("Relevance from histograms matches a voxel scan", "[blockhistograms]")
+{
+  std::vector<unsigned char> const raw{ readTestVolume<unsigned char>() };
+
+  bd::IndexFile index;
+  makeTestIndex(index);
+
+  bd::BlockHistograms histograms{ index.blocks().size(), 256, 0.0, 255.0 };
+  REQUIRE(bd::buildBlockHistograms(index, RES_DIR "/testvol_8x8x8.raw", histograms));
+  REQUIRE(histograms.store(index));
+
+  // Take the histograms through the binary format, as the preprocessor would.
+  std::string const path{ "test_blockhistograms.bin" };
+  index.writeBinaryIndexFile(path);
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> loaded{ bd::IndexFile::fromBinaryIndexFile(path, ok) };
+  REQUIRE(ok);
+  std::remove(path.c_str());
+
+  bd::BlockHistograms fromIndex;
+  REQUIRE(fromIndex.load(*loaded));
+  REQUIRE(fromIndex.bins() == 256);
+
+  bd::OpacityTransferFunction const otf{ makeOtf() };
+  double const lo{ 0.5 };
+  double const hi{ 1.1 };
+  bd::updateRelevance(*loaded, fromIndex, otf, lo, hi);
+
+  uint64_t volEmpty{ 0 };
+  for (bd::FileBlock const &b : loaded->blocks()) {
+    uint64_t empty{ 0 };
+    for (size_t z{ 0 }; z < 4; ++z)
+    for (size_t y{ 0 }; y < 4; ++y)
+    for (size_t x{ 0 }; x < 4; ++x) {
+      unsigned char const v{ raw[b.data_offset + x + 8 * ( y + 8 * z )] };
+      double const a{ otf.interpolate(v / 255.0) };
+      empty += ( a >= lo && a < hi ) ? 0 : 1;
+    }
+
+    REQUIRE(b.empty_voxels == empty);
+    REQUIRE(b.rov == Approx(( 64 - empty ) / 64.0));
+    REQUIRE(b.is_empty == ( empty == 64 ? 1u : 0u ));
+    volEmpty += empty;
+  }
+  REQUIRE(loaded->getVolume().numEmptyVoxels() == volEmpty);
+}
+
+
+TEST_CASE("Double volumes histogram like their integer values", "[blockhistograms]")
+{
+  std::vector<unsigned char> const raw{ readTestVolume<unsigned char>() };
+
+  std::string const path{ "test_blockhistograms_double.raw" };
+  {
+    std::vector<double> const wide(raw.begin(), raw.end());
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<char const *>(wide.data()), wide.size() * sizeof(double));
+  }
+
+  bd::IndexFile bytes;
+  makeTestIndex(bytes);
+  bd::IndexFile doubles;
+  doubles.getVolume().block_count({ 2, 2, 2 });
+  doubles.getVolume().voxelDims({ 8, 8, 8 });
+  doubles.init(bd::DataType::Double);
+  REQUIRE(bd::IndexFileHeader::getType(doubles.getHeader()) == bd::DataType::Double);
+
+  bd::BlockHistograms expected{ 8, 64, 0.0, 255.0 };
+  bd::BlockHistograms histograms{ 8, 64, 0.0, 255.0 };
+  REQUIRE(bd::buildBlockHistograms(bytes, RES_DIR "/testvol_8x8x8.raw", expected));
+  REQUIRE(bd::buildBlockHistograms(doubles, path, histograms));
+  std::remove(path.c_str());
+
+  for (size_t b{ 0 }; b < 8; ++b) {
+    REQUIRE(std::equal(expected.counts(b), expected.counts(b) + 64, histograms.counts(b)));
+  }
+}
+
+
+TEST_CASE("Histograms must match the index", "[blockhistograms]")
+{
+  bd::IndexFile index;
+  makeTestIndex(index);
+
+  bd::BlockHistograms histograms;
+  REQUIRE(! histograms.load(index));
+
+  bd::BlockHistograms wrong{ 3, 16, 0.0, 255.0 };
+  REQUIRE(! wrong.store(index));
+  REQUIRE(index.section(bd::SectionType::Histograms).empty());
+}
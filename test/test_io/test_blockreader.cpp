@@ -0,0 +1,70 @@
+#include <bd/io/blockreader.h>
+#include <bd/io/indexfile.h>
+
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Read every block of an 8x8x8 volume split into \c numBlocks blocks and
+/// check each brick against voxels picked out of the raw file by hand.
+void
+checkBlocks(glm::u64vec3 const &numBlocks)
+{
+  std::vector<char> const raw{ readTestVolume<char>() };
+
+  bd::IndexFile index;
+  makeTestIndex(index, numBlocks);
+
+  bd::BlockReader<unsigned char> reader{ index, 3 };
+  REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+  reader.start();
+
+  size_t numRead{ 0 };
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    bd::FileBlock const &b{ reader.fileBlock(buf) };
+    REQUIRE(buf->getNumElements() == b.voxel_dims[0] * b.voxel_dims[1] * b.voxel_dims[2]);
+
+    size_t i{ 0 };
+    for (size_t z{ 0 }; z < b.voxel_dims[2]; ++z)
+    for (size_t y{ 0 }; y < b.voxel_dims[1]; ++y)
+    for (size_t x{ 0 }; x < b.voxel_dims[0]; ++x) {
+      size_t const fileIdx{ b.data_offset + x + 8 * ( y + 8 * z ) };
+      REQUIRE(buf->getPtr()[i++] == static_cast<unsigned char>(raw[fileIdx]));
+    }
+
+    ++numRead;
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(numRead == index.getFileBlocks().size());
+  REQUIRE(reader.reset() == 512);
+}
+
+} // namespace
+
+
+TEST_CASE("BlockReader gathers cubic blocks", "[blockreader]")
+{
+  checkBlocks({ 2, 2, 2 });
+}
+
+
+TEST_CASE("BlockReader reads whole slabs", "[blockreader]")
+{
+  checkBlocks({ 1, 1, 4 });
+  checkBlocks({ 1, 2, 2 });
+}
+
+
+TEST_CASE("BlockReader reads thin blocks row by row", "[blockreader]")
+{
+  checkBlocks({ 8, 1, 1 });
+}
@@ -0,0 +1,117 @@
+#include <bd/io/blocktable.h>
+#include <bd/io/indexfile.h>
+
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+namespace
+{
+
+/// An index over a float volume, with made up block statistics.
+void
+makeStatsIndex(bd::IndexFile &index)
+{
+  makeIndex(index, { 4, 3, 2 }, { 16, 12, 8 }, bd::DataType::Float);
+
+  for (size_t b{ 0 }; b < index.getFileBlocks().size(); ++b) {
+    bd::FileBlock &fb{ index[b] };
+    fb.min_val = static_cast<double>(b % 7);
+    fb.max_val = fb.min_val + static_cast<double>(b % 3);
+    fb.avg_val = 0.5 * ( fb.min_val + fb.max_val );
+    fb.is_empty = b % 5 == 0 ? 1 : 0;
+  }
+}
+
+} // namespace
+
+
+TEST_CASE("BlockTable columns match the FileBlocks", "[blocktable]")
+{
+  bd::IndexFile index;
+  makeStatsIndex(index);
+  bd::BlockTable table{ index };
+
+  REQUIRE(table.size() == 24);
+  for (size_t r{ 0 }; r < table.size(); ++r) {
+    bd::FileBlock const &b{ index[r] };
+    REQUIRE(table.blockIndex[r] == b.block_index);
+    REQUIRE(table.i[r] == b.ijk_index[0]);
+    REQUIRE(table.k[r] == b.ijk_index[2]);
+    REQUIRE(table.dataOffset[r] == b.data_offset);
+    REQUIRE(table.avgVal[r] == b.avg_val);
+    REQUIRE(table.isEmpty[r] == b.is_empty);
+    REQUIRE(table.worldMinX[r] < b.world_oigin[0]);
+    REQUIRE(table.worldMaxX[r] - table.worldMinX[r] == Approx(b.world_dims[0]));
+  }
+}
+
+
+TEST_CASE("BlockTable queries agree with scanning FileBlocks", "[blocktable]")
+{
+  bd::IndexFile index;
+  makeStatsIndex(index);
+  bd::BlockTable table{ index };
+
+  std::vector<size_t> inRange, overlapping, nonEmpty;
+  size_t empty{ 0 };
+  for (size_t r{ 0 }; r < 24; ++r) {
+    bd::FileBlock const &b{ index[r] };
+    if (b.avg_val >= 2.0 && b.avg_val <= 4.0) {
+      inRange.push_back(r);
+    }
+    if (b.min_val <= 1.5 && b.max_val >= 1.0) {
+      overlapping.push_back(r);
+    }
+    if (b.is_empty) {
+      ++empty;
+    } else {
+      nonEmpty.push_back(r);
+    }
+  }
+
+  std::vector<size_t> out;
+  REQUIRE(table.filterInRange(bd::BlockStat::Avg, 2.0, 4.0, out) == inRange.size());
+  REQUIRE(out == inRange);
+  REQUIRE(table.countInRange(bd::BlockStat::Avg, 2.0, 4.0) == inRange.size());
+
+  std::vector<uint8_t> mask;
+  table.inRangeMask(bd::BlockStat::Avg, 2.0, 4.0, mask);
+  for (size_t r : inRange) {
+    REQUIRE(mask[r] == 1);
+  }
+
+  REQUIRE(table.filterOverlapping(1.0, 1.5, out) == overlapping.size());
+  REQUIRE(out == overlapping);
+
+  REQUIRE(table.countEmpty() == empty);
+  REQUIRE(table.filterNonEmpty(out) == nonEmpty.size());
+  REQUIRE(out == nonEmpty);
+}
+
+
+TEST_CASE("BlockTable argsort is stable", "[blocktable]")
+{
+  bd::IndexFile index;
+  makeStatsIndex(index);
+  bd::BlockTable table{ index };
+
+  std::vector<size_t> order;
+  table.argsort(bd::BlockStat::Min, order);
+  REQUIRE(order.size() == 24);
+  for (size_t r{ 1 }; r < order.size(); ++r) {
+    double const a{ table.minVal[order[r - 1]] };
+    double const b{ table.minVal[order[r]] };
+    REQUIRE(a <= b);
+    if (a == b) {
+      REQUIRE(order[r - 1] < order[r]);
+    }
+  }
+
+  table.argsort(bd::BlockStat::Max, order, true);
+  for (size_t r{ 1 }; r < order.size(); ++r) {
+    REQUIRE(table.maxVal[order[r - 1]] >= table.maxVal[order[r]]);
+  }
+}
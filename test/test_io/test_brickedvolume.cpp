@@ -0,0 +1,185 @@
+#include <bd/io/blockreader.h>
+#include <bd/io/brickedvolume.h>
+#include <bd/io/indexfile.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Read every block of \c index out of \c path, keyed by block index.
+std::map<uint64_t, std::vector<unsigned char>>
+readBricks(bd::IndexFile const &index, std::string const &path)
+{
+  std::map<uint64_t, std::vector<unsigned char>> bricks;
+  bd::BlockReader<unsigned char> reader{ index, 3 };
+  REQUIRE(reader.open(path));
+  reader.start();
+
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    bd::FileBlock const &b{ reader.fileBlock(buf) };
+    bricks[b.block_index].assign(buf->getPtr(), buf->getPtr() + buf->getNumElements());
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(reader.reset() == 512);
+  return bricks;
+}
+
+} // namespace
+
+
+TEST_CASE("Bricked volumes read back the same blocks", "[brickedvolume]")
+{
+  bd::IndexFile rowMajor;
+  makeTestIndex(rowMajor);
+  auto const expected = readBricks(rowMajor, RES_DIR "/testvol_8x8x8.raw");
+
+  bd::Codec const codecs[]{ bd::Codec::None, bd::Codec::Lz4, bd::Codec::Zstd };
+  for (bd::Codec c : codecs) {
+    if (! bd::codecAvailable(c)) {
+      WARN("Codec " << bd::to_string(c) << " not in this build, skipping.");
+      continue;
+    }
+
+    std::string const path{ "test_brickedvolume_" + bd::to_string(c) + ".bricks" };
+    bd::IndexFile index;
+    makeTestIndex(index);
+    REQUIRE(bd::writeBrickedVolume(index, RES_DIR "/testvol_8x8x8.raw", path, c));
+
+    REQUIRE(bd::IndexFileHeader::getStorage(index.getHeader()) == bd::BlockStorage::Bricked);
+    REQUIRE(bd::IndexFileHeader::getCodec(index.getHeader()) == c);
+    REQUIRE(index.getRawFileName() == path);
+
+    // Bricks are packed back to back in block order.
+    uint64_t offset{ 0 };
+    for (bd::FileBlock const &b : index.getFileBlocks()) {
+      REQUIRE(b.data_offset == offset);
+      REQUIRE(b.data_bytes > 0);
+      REQUIRE(b.data_bytes <= 64);
+      offset += b.data_bytes;
+    }
+
+    REQUIRE(readBricks(index, path) == expected);
+    std::remove(path.c_str());
+  }
+}
+
+
+TEST_CASE("Empty blocks can be left out of a bricked volume", "[brickedvolume]")
+{
+  bd::IndexFile index;
+  makeTestIndex(index);
+  index[1].is_empty = 1;
+  index[6].is_empty = 1;
+
+  std::string const path{ "test_brickedvolume_skip.bricks" };
+  REQUIRE(bd::writeBrickedVolume(index, RES_DIR "/testvol_8x8x8.raw", path,
+                                 bd::Codec::None, 3, true));
+  REQUIRE(index[1].data_bytes == 0);
+  REQUIRE(index[6].data_bytes == 0);
+  REQUIRE(index[7].data_offset == 5 * 64);
+
+  // The index survives a trip through the binary format.
+  std::string const idxPath{ "test_brickedvolume_skip.bin" };
+  index.writeBinaryIndexFile(idxPath);
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> loaded{ bd::IndexFile::fromBinaryIndexFile(idxPath, ok) };
+  REQUIRE(ok);
+  REQUIRE(bd::IndexFileHeader::getStorage(loaded->getHeader()) == bd::BlockStorage::Bricked);
+
+  bd::IndexFile rowMajor;
+  makeTestIndex(rowMajor);
+  auto const expected = readBricks(rowMajor, RES_DIR "/testvol_8x8x8.raw");
+  auto const bricks = readBricks(*loaded, path);
+  for (auto const &kv : bricks) {
+    if (kv.first == 1 || kv.first == 6) {
+      REQUIRE(kv.second == std::vector<unsigned char>(64, 0));
+    } else {
+      REQUIRE(kv.second == expected.at(kv.first));
+    }
+  }
+
+  std::remove(path.c_str());
+  std::remove(idxPath.c_str());
+}
+
+
+TEST_CASE("Bricks can carry a halo of their neighbours", "[brickedvolume]")
+{
+  std::vector<unsigned char> const vol{ readTestVolume<unsigned char>() };
+  auto voxel = [&vol](int x, int y, int z) -> unsigned char {
+    auto clamp = [](int v) { return v < 0 ? 0 : v > 7 ? 7 : v; };
+    return vol[clamp(x) + 8 * ( clamp(y) + 8 * clamp(z) )];
+  };
+
+  bd::IndexFile index;
+  makeTestIndex(index);
+  std::string const path{ "test_brickedvolume_halo.bricks" };
+  REQUIRE_FALSE(bd::writeBrickedVolume(index, RES_DIR "/testvol_8x8x8.raw", path,
+                                       bd::Codec::None, 3, false, bd::MAX_BRICK_HALO + 1));
+  REQUIRE(bd::writeBrickedVolume(index, RES_DIR "/testvol_8x8x8.raw", path,
+                                 bd::Codec::None, 3, false, 1));
+  REQUIRE(bd::brickHalo(index) == 1);
+
+  // The halo width survives a trip through the binary format.
+  std::string const idxPath{ "test_brickedvolume_halo.bin" };
+  index.writeBinaryIndexFile(idxPath);
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> loaded{ bd::IndexFile::fromBinaryIndexFile(idxPath, ok) };
+  REQUIRE(ok);
+  REQUIRE(bd::brickHalo(*loaded) == 1);
+
+  bd::BlockReader<unsigned char> reader{ *loaded, 3 };
+  REQUIRE(reader.open(path));
+  REQUIRE(reader.halo() == 1);
+  reader.start();
+
+  size_t blocks{ 0 };
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    bd::FileBlock const &b{ reader.fileBlock(buf) };
+    REQUIRE(buf->getNumElements() == 6 * 6 * 6);
+
+    int const x0{ static_cast<int>(b.ijk_index[0]) * 4 - 1 };
+    int const y0{ static_cast<int>(b.ijk_index[1]) * 4 - 1 };
+    int const z0{ static_cast<int>(b.ijk_index[2]) * 4 - 1 };
+    unsigned char const *p{ buf->getPtr() };
+    for (int z{ 0 }; z < 6; ++z) {
+      for (int y{ 0 }; y < 6; ++y) {
+        for (int x{ 0 }; x < 6; ++x) {
+          REQUIRE(p[x + 6 * ( y + 6 * z )] == voxel(x0 + x, y0 + y, z0 + z));
+        }
+      }
+    }
+
+    // Without the halo it is the plain block again.
+    std::vector<unsigned char> brick(p, p + buf->getNumElements());
+    bd::stripHalo(reinterpret_cast<char *>(brick.data()), b, 1, 1);
+    for (int z{ 0 }; z < 4; ++z) {
+      for (int y{ 0 }; y < 4; ++y) {
+        for (int x{ 0 }; x < 4; ++x) {
+          REQUIRE(brick[x + 4 * ( y + 4 * z )] == voxel(x0 + 1 + x, y0 + 1 + y, z0 + 1 + z));
+        }
+      }
+    }
+
+    ++blocks;
+    reader.waitReturnEmpty(buf);
+  }
+  REQUIRE(reader.reset() == 8 * 216);
+  REQUIRE(blocks == 8);
+
+  std::remove(path.c_str());
+  std::remove(idxPath.c_str());
+}
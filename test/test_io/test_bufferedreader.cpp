@@ -0,0 +1,95 @@
+#include <bd/io/bufferedreader.h>
+
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+
+TEST_CASE("Multiple readers deliver buffers in file order", "[bufferedreader]")
+{
+  std::vector<unsigned char> const expected{ readTestVolume<unsigned char>() };
+
+  // 5 buffers of 32 bytes, so the file is 16 chunks split across 3 readers.
+  bd::BufferedReader<unsigned char> reader{ 5 * 32 };
+  reader.setNumBuffers(5);
+  reader.setNumReaders(3, bd::DeliveryOrder::File);
+  REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+  reader.start();
+
+  size_t next{ 0 };
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    REQUIRE(buf->getIndexOffset() == next);
+    for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+      REQUIRE(buf->getPtr()[i] == expected[next + i]);
+    }
+    next += buf->getNumElements();
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(next == 512);
+  REQUIRE(reader.reset() == 512);
+}
+
+
+TEST_CASE("Multiple readers cover the file in arrival order", "[bufferedreader]")
+{
+  std::vector<unsigned char> const expected{ readTestVolume<unsigned char>() };
+
+  bd::BufferedReader<unsigned char> reader{ 4 * 48 };
+  reader.setNumBuffers(4);
+  reader.setNumReaders(3, bd::DeliveryOrder::Arrival);
+  REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+  reader.start();
+
+  std::vector<int> seen(512, 0);
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+      size_t const idx{ buf->getIndexOffset() + i };
+      REQUIRE(buf->getPtr()[i] == expected[idx]);
+      seen[idx] += 1;
+    }
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(std::vector<int>(512, 1) == seen);
+  REQUIRE(reader.reset() == 512);
+}
+
+
+TEST_CASE("Lock-free pool queues cover the file", "[bufferedreader]")
+{
+  std::vector<unsigned char> const expected{ readTestVolume<unsigned char>() };
+
+  bd::PoolQueue const queues[]{ bd::PoolQueue::Spsc, bd::PoolQueue::Mpmc };
+  int const readers[]{ 1, 3 };
+  for (bd::PoolQueue q : queues) {
+    for (int k : readers) {
+      bd::BufferedReader<unsigned char> reader{ 4 * 48 };
+      reader.setNumBuffers(4);
+      reader.setNumReaders(k, bd::DeliveryOrder::Arrival);
+      reader.setQueueType(q);
+      REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+      reader.start();
+
+      std::vector<int> seen(512, 0);
+      bd::Buffer<unsigned char> *buf{ nullptr };
+      while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+        for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+          size_t const idx{ buf->getIndexOffset() + i };
+          REQUIRE(buf->getPtr()[i] == expected[idx]);
+          seen[idx] += 1;
+        }
+        reader.waitReturnEmpty(buf);
+      }
+
+      REQUIRE(std::vector<int>(512, 1) == seen);
+      REQUIRE(reader.reset() == 512);
+    }
+  }
+}
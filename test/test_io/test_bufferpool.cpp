@@ -0,0 +1,77 @@
+#include <bd/io/bufferpool.h>
+
+#include <chrono>
+#include <thread>
+
+#include <catch.hpp>
+
+namespace
+{
+
+/// Pass \c count buffers from one producer to one consumer that sleeps
+/// \c consumerDelay on each buffer.
+void
+runPool(bd::BufferPool<int> &pool, int count, std::chrono::microseconds consumerDelay)
+{
+  std::thread producer{ [&]() {
+    for (int i{ 0 }; i < count; ++i) {
+      bd::Buffer<int> *buf{ pool.nextEmpty() };
+      if (buf == nullptr) {
+        break;
+      }
+      buf->getPtr()[0] = i;
+      pool.returnFull(buf);
+    }
+    pool.producerDone();
+  }};
+
+  bd::Buffer<int> *buf{ nullptr };
+  while ((buf = pool.nextFullUntilNone()) != nullptr) {
+    std::this_thread::sleep_for(consumerDelay);
+    pool.returnEmpty(buf);
+  }
+  producer.join();
+}
+
+} // namespace
+
+
+TEST_CASE("BufferPool counts hand offs and stalls", "[bufferpool]")
+{
+  bd::BufferPool<int> pool{ 4 * 16 * sizeof(int), 4 };
+  pool.allocate();
+
+  runPool(pool, 100, std::chrono::microseconds{ 0 });
+
+  bd::PoolStats const st{ pool.stats() };
+  REQUIRE(st.handOffs == 100);
+  REQUIRE(st.liveBuffers == 4);
+  REQUIRE(st.maxBuffers == 4);
+  REQUIRE(st.bufferBytes == 16 * sizeof(int));
+  REQUIRE(st.grows == 0);
+  REQUIRE(st.shrinks == 0);
+}
+
+
+TEST_CASE("Adaptive BufferPool parks buffers a slow consumer can't use", "[bufferpool]")
+{
+  // 6 live buffers of 64 bytes, room for up to 16 of them.
+  bd::BufferPool<int> pool{ 6 * 16 * sizeof(int), 6 };
+  pool.setAdaptive(16 * 16 * sizeof(int), 2);
+  pool.allocate();
+  REQUIRE(pool.isAdaptive());
+  REQUIRE(pool.stats().maxBuffers == 16);
+
+  // The producer is always waiting on the consumer, so only the producer
+  // side stalls and extra buffers are of no use.
+  runPool(pool, 60, std::chrono::microseconds{ 1000 });
+
+  bd::PoolStats const st{ pool.stats() };
+  REQUIRE(st.handOffs == 60);
+  REQUIRE(st.producerStalls > 0);
+  REQUIRE(st.liveBuffers == 2);
+  REQUIRE(st.shrinks == 4);
+
+  pool.reset();
+  REQUIRE(pool.stats().liveBuffers == 6);
+}
@@ -0,0 +1,148 @@
+#include <bd/io/compression.h>
+#include <bd/io/decompressingreader.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Stream \c path and check every element lands where it was in the raw file.
+void
+checkStream(std::string const &path, bd::DeliveryOrder order)
+{
+  std::vector<unsigned short> const expected{ readTestVolume<unsigned short>() };
+
+  bd::DecompressingReader<unsigned short> reader{ 3 };
+  reader.setNumBuffers(4);
+  reader.setDeliveryOrder(order);
+  REQUIRE(reader.open(path));
+  REQUIRE(reader.rawFileSize() == 512);
+  REQUIRE(reader.singleBufferElements() == 24);
+  reader.start();
+
+  size_t next{ 0 };
+  std::vector<int> seen(256, 0);
+  bd::Buffer<unsigned short> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    if (order == bd::DeliveryOrder::File) {
+      REQUIRE(buf->getIndexOffset() == next);
+      next += buf->getNumElements();
+    }
+    for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+      size_t const idx{ buf->getIndexOffset() + i };
+      REQUIRE(buf->getPtr()[i] == expected[idx]);
+      seen[idx] += 1;
+    }
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(std::vector<int>(256, 1) == seen);
+  REQUIRE(reader.reset() == 512);
+}
+
+} // namespace
+
+
+TEST_CASE("Compressed volumes stream back to the raw data", "[decompressingreader]")
+{
+  bd::Codec const codecs[]{ bd::Codec::None, bd::Codec::Lz4, bd::Codec::Zstd };
+  for (bd::Codec c : codecs) {
+    if (! bd::codecAvailable(c)) {
+      WARN("Codec " << bd::to_string(c) << " not in this build, skipping.");
+      continue;
+    }
+
+    std::string const path{ "test_decompressingreader_" + bd::to_string(c) + ".bdz" };
+    // 48 byte chunks, so the last of the 11 chunks is short.
+    REQUIRE(bd::writeCompressedFile(RES_DIR "/testvol_8x8x8.raw", path, c, 48));
+
+    bd::CompressedFile f;
+    REQUIRE(f.open(path));
+    REQUIRE(f.codec() == c);
+    REQUIRE(f.header().num_chunks == 11);
+    REQUIRE(f.chunks().back().raw_bytes == 32);
+    f.close();
+
+    checkStream(path, bd::DeliveryOrder::Arrival);
+    checkStream(path, bd::DeliveryOrder::File);
+    std::remove(path.c_str());
+  }
+}
+
+
+TEST_CASE("Compressed volumes with a corrupt chunk table are rejected", "[decompressingreader]")
+{
+  std::string const path{ "test_decompressingreader_corrupt.bdz" };
+  REQUIRE(bd::writeCompressedFile(RES_DIR "/testvol_8x8x8.raw", path, bd::Codec::None, 48));
+
+  bd::CompressedHeader good;
+  std::ifstream(path, std::ios::binary).read(reinterpret_cast<char *>(&good), sizeof(good));
+
+  auto openWith = [&](bd::CompressedHeader const &h) -> bool {
+    std::fstream(path, std::ios::binary | std::ios::in | std::ios::out)
+        .write(reinterpret_cast<char const *>(&h), sizeof(h));
+    bd::CompressedFile f;
+    return f.open(path);
+  };
+
+  bd::CompressedHeader h{ good };
+  h.num_chunks = uint64_t(1) << 40;
+  REQUIRE_FALSE(openWith(h));
+
+  h = good;
+  h.table_offset = uint64_t(1) << 40;
+  REQUIRE_FALSE(openWith(h));
+  REQUIRE(openWith(good));
+
+  // Entries of the table, written over the second chunk's.
+  bd::CompressedChunk second;
+  std::ifstream(path, std::ios::binary)
+      .seekg(good.table_offset + sizeof(second))
+      .read(reinterpret_cast<char *>(&second), sizeof(second));
+
+  auto openWithChunk = [&](bd::CompressedChunk const &c) -> bool {
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(good.table_offset + sizeof(c));
+    f.write(reinterpret_cast<char const *>(&c), sizeof(c));
+    f.close();
+    bd::CompressedFile cf;
+    return cf.open(path);
+  };
+
+  bd::CompressedChunk c{ second };
+  c.bytes = uint64_t(1) << 40;
+  REQUIRE_FALSE(openWithChunk(c));
+
+  c = second;
+  c.offset = good.table_offset;
+  REQUIRE_FALSE(openWithChunk(c));
+
+  c = second;
+  c.raw_bytes = good.chunk_bytes + 1;
+  REQUIRE_FALSE(openWithChunk(c));
+
+  c = second;
+  c.raw_offset += 1;
+  REQUIRE_FALSE(openWithChunk(c));
+  REQUIRE(openWithChunk(second));
+
+  // A volume of no chunks opens, but has no chunk size to make buffers of.
+  h = good;
+  h.chunk_bytes = 0;
+  h.raw_bytes = 0;
+  h.num_chunks = 0;
+  REQUIRE(openWith(h));
+  bd::DecompressingReader<unsigned char> reader{ 2 };
+  REQUIRE_FALSE(reader.open(path));
+
+  std::remove(path.c_str());
+}
@@ -5,6 +5,14 @@
 
 #include <bd/io/fileblock.h>
 #include <bd/io/indexfile.h>
+#include <bd/io/indexrecord.h>
+#include <bd/util/util.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 #include <catch.hpp>
 
@@ -98,3 +106,381 @@ TEST_CASE("Byte offsets are correct")
   offset = block->data_offset;
   REQUIRE(offset == (256 * 256 * 128) + (256 * 128) + 128);
 }
+
+
+TEST_CASE("Ragged edge blocks cover the whole volume", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  bd::Volume *v{ &index_file.getVolume() };
+  v->voxelDims({ 10, 7, 5 });
+  v->block_count({ 3, 2, 2 });
+
+  SECTION("Drop leaves the remainder out")
+  {
+    index_file.init(bd::DataType::Character);
+    REQUIRE(v->block_dims() == glm::u64vec3(3, 3, 2));
+    REQUIRE(v->blocksExtent() == glm::u64vec3(9, 6, 4));
+    REQUIRE_FALSE(v->hasRaggedBlocks());
+  }
+
+  SECTION("Ragged keeps the edge blocks")
+  {
+    index_file.init(bd::DataType::Character, bd::EdgeBlocks::Ragged);
+    REQUIRE(v->block_dims() == glm::u64vec3(4, 4, 3));
+    REQUIRE(v->block_count() == glm::u64vec3(3, 2, 2));
+    REQUIRE(v->blocksExtent() == v->voxelDims());
+    REQUIRE(v->hasRaggedBlocks());
+
+    std::vector<bd::FileBlock> const &blocks{ index_file.getFileBlocks() };
+    REQUIRE(blocks.size() == 3 * 2 * 2);
+
+    uint64_t voxels{ 0 };
+    for (bd::FileBlock const &b : blocks) {
+      voxels += b.voxel_dims[0] * b.voxel_dims[1] * b.voxel_dims[2];
+      REQUIRE(b.data_bytes == b.voxel_dims[0] * b.voxel_dims[1] * b.voxel_dims[2]);
+    }
+    REQUIRE(voxels == 10 * 7 * 5);
+
+    // last block is whatever is left over along each axis
+    bd::FileBlock const &last = blocks.back();
+    REQUIRE(last.voxel_dims[0] == 2);
+    REQUIRE(last.voxel_dims[1] == 3);
+    REQUIRE(last.voxel_dims[2] == 2);
+    REQUIRE(last.data_offset == 8 + 10 * ( 4 + 7 * 3 ));
+
+    // world extents follow the voxel counts and still meet at +0.5
+    REQUIRE(last.world_dims[0] == Approx(0.2f));
+    REQUIRE(last.world_oigin[0] + last.world_dims[0] * 0.5f == Approx(0.5f));
+    REQUIRE(blocks[0].world_oigin[0] - blocks[0].world_dims[0] * 0.5f == Approx(-0.5f));
+  }
+}
+
+
+TEST_CASE("Blocks can be ordered along space filling curves", "[indexfile]")
+{
+  bd::IndexFile linear;
+  linear.getVolume().voxelDims({ 64, 64, 64 });
+  linear.getVolume().block_count({ 4, 4, 4 });
+  linear.init(bd::DataType::Character);
+
+  bd::BlockOrder const orders[]{ bd::BlockOrder::Morton, bd::BlockOrder::Hilbert };
+  for (bd::BlockOrder order : orders) {
+    bd::IndexFile index_file;
+    index_file.getVolume().voxelDims({ 64, 64, 64 });
+    index_file.getVolume().block_count({ 4, 4, 4 });
+    index_file.init(bd::DataType::Character, bd::EdgeBlocks::Drop, order);
+
+    std::vector<bd::FileBlock> const &blocks{ index_file.getFileBlocks() };
+    REQUIRE(blocks.size() == 64);
+
+    // Same blocks as the linear order, each still knowing its to1D() index.
+    std::vector<bool> seen(64, false);
+    for (bd::FileBlock const &b : blocks) {
+      REQUIRE(b.block_index == bd::to1D(b.ijk_index[0], b.ijk_index[1], b.ijk_index[2], 4, 4));
+      REQUIRE(b.data_offset == linear.blocks()[b.block_index].data_offset);
+      seen[b.block_index] = true;
+    }
+    REQUIRE(std::count(seen.begin(), seen.end(), true) == 64);
+
+    // Both curves finish one 2x2x2 octant of blocks before the next.
+    for (size_t i{ 0 }; i < 8; ++i) {
+      REQUIRE(blocks[i].ijk_index[0] < 2);
+      REQUIRE(blocks[i].ijk_index[1] < 2);
+      REQUIRE(blocks[i].ijk_index[2] < 2);
+    }
+
+    if (order == bd::BlockOrder::Hilbert) {
+      for (size_t i{ 1 }; i < blocks.size(); ++i) {
+        uint64_t step{ 0 };
+        for (int a{ 0 }; a < 3; ++a) {
+          uint64_t const p{ blocks[i - 1].ijk_index[a] };
+          uint64_t const q{ blocks[i].ijk_index[a] };
+          step += p > q ? p - q : q - p;
+        }
+        REQUIRE(step == 1);
+      }
+    }
+  }
+}
+
+
+TEST_CASE("Mapped index files view the same blocks", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  bd::Volume *v{ &index_file.getVolume() };
+  v->block_count({ 4, 3, 2 });
+  v->voxelDims({ 64, 48, 32 });
+  index_file.init(bd::DataType::UnsignedShort);
+
+  std::string const path{ "test_indexfile_mapped.bin" };
+  index_file.writeBinaryIndexFile(path);
+
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> mapped{ bd::IndexFile::mapBinaryIndexFile(path, ok) };
+  REQUIRE(ok);
+  REQUIRE(mapped->isMapped());
+  REQUIRE(mapped->getVolume().total_block_count() == 24);
+
+  bd::Span<bd::FileBlock const> const blocks{ mapped->blocks() };
+  REQUIRE(blocks.size() == 24);
+  for (size_t i{ 0 }; i < blocks.size(); ++i) {
+    char mappedRecord[bd::FILEBLOCK_RECORD_BYTES];
+    char blockRecord[bd::FILEBLOCK_RECORD_BYTES];
+    bd::encodeFileBlock(blocks[i], mappedRecord);
+    bd::encodeFileBlock(index_file[i], blockRecord);
+    REQUIRE(std::memcmp(mappedRecord, blockRecord, bd::FILEBLOCK_RECORD_BYTES) == 0);
+  }
+
+  std::unique_ptr<bd::IndexFile> read{ bd::IndexFile::fromBinaryIndexFile(path, ok) };
+  REQUIRE(ok);
+  REQUIRE(! read->isMapped());
+  REQUIRE(read->getFileBlocks().size() == 24);
+  REQUIRE(read->getFileBlocks()[23].block_index == blocks[23].block_index);
+
+  // Writing through the index moves the table out of the mapping.
+  (*mapped)[5].is_empty = 1;
+  REQUIRE(! mapped->isMapped());
+  REQUIRE(mapped->blocks()[5].is_empty == 1);
+
+  std::remove(path.c_str());
+}
+
+
+TEST_CASE("Truncated index files are not mapped", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.getVolume().block_count({ 2, 2, 2 });
+  index_file.getVolume().voxelDims({ 8, 8, 8 });
+  index_file.init(bd::DataType::Float);
+
+  // Drop the last half block.
+  std::ostringstream os;
+  index_file.writeBinaryIndexFile(os);
+  std::string bytes{ os.str() };
+  bytes.resize(bytes.size() - bd::FILEBLOCK_RECORD_BYTES / 2);
+
+  std::string const path{ "test_indexfile_truncated.bin" };
+  std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+
+  bool ok{ true };
+  std::unique_ptr<bd::IndexFile> mapped{ bd::IndexFile::mapBinaryIndexFile(path, ok) };
+  REQUIRE(! ok);
+  REQUIRE(! mapped->isMapped());
+
+  std::unique_ptr<bd::IndexFile> read{ bd::IndexFile::fromBinaryIndexFile(path, ok) };
+  REQUIRE(! ok);
+
+  std::remove(path.c_str());
+}
+
+
+TEST_CASE("Extra sections survive reading and writing", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.getVolume().block_count({ 2, 2, 1 });
+  index_file.getVolume().voxelDims({ 8, 8, 4 });
+  index_file.init(bd::DataType::UnsignedCharacter);
+
+  bd::SectionType const unknown{ static_cast<bd::SectionType>(1000) };
+  REQUIRE(index_file.setSection(unknown, { 'a', 'b', 'c', 'd', 'e' }, 1));
+  REQUIRE(! index_file.setSection(bd::SectionType::Blocks, { }));
+
+  std::string const path{ "test_indexfile_sections.bin" };
+  index_file.writeBinaryIndexFile(path);
+
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> read{ bd::IndexFile::fromBinaryIndexFile(path, ok) };
+  REQUIRE(ok);
+  REQUIRE(read->section(unknown).size() == 5);
+  REQUIRE(read->section(unknown)[4] == 'e');
+  REQUIRE(read->sectionRecordBytes(unknown) == 1);
+
+  std::unique_ptr<bd::IndexFile> mapped{ bd::IndexFile::mapBinaryIndexFile(path, ok) };
+  REQUIRE(ok);
+  REQUIRE(mapped->isMapped());
+  REQUIRE(mapped->section(unknown).size() == 5);
+
+  // Dropping the mapping keeps a copy of the section.
+  mapped->getFileBlocks();
+  REQUIRE(! mapped->isMapped());
+  REQUIRE(mapped->section(unknown)[0] == 'a');
+
+  std::remove(path.c_str());
+}
+
+
+TEST_CASE("Corrupt sections are detected", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.getVolume().block_count({ 2, 2, 2 });
+  index_file.getVolume().voxelDims({ 8, 8, 8 });
+  index_file.init(bd::DataType::Float);
+
+  std::ostringstream os;
+  index_file.writeBinaryIndexFile(os);
+  std::string bytes{ os.str() };
+  // Flip a bit in the last block.
+  bytes[bytes.size() - bd::FILEBLOCK_RECORD_BYTES / 2] ^= 0x10;
+
+  std::string const path{ "test_indexfile_corrupt.bin" };
+  std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+
+  bool ok{ true };
+  std::unique_ptr<bd::IndexFile> read{ bd::IndexFile::fromBinaryIndexFile(path, ok) };
+  REQUIRE(! ok);
+
+  std::remove(path.c_str());
+}
+
+
+namespace
+{
+
+/// The IndexFileHeader as written by version 13, before storage and codec.
+struct V13IndexFileHeader
+{
+  uint16_t magic_number;
+  uint16_t version;
+  uint32_t header_length;
+  uint32_t dataType;
+  char raw_file[256];
+  char tf_file[256];
+};
+
+} // namespace
+
+
+TEST_CASE("Flat version 13 index files can be read", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.getVolume().block_count({ 3, 1, 2 });
+  index_file.getVolume().voxelDims({ 9, 4, 4 });
+  index_file.init(bd::DataType::Short);
+
+  V13IndexFileHeader h{ };
+  h.magic_number = bd::MAGIC;
+  h.version = 13;
+  h.header_length = sizeof(V13IndexFileHeader);
+  h.dataType = bd::IndexFileHeader::getTypeInt(bd::DataType::Short);
+  std::strcpy(h.raw_file, "old.raw");
+  REQUIRE(sizeof(h) == bd::IFH_V13_LENGTH);
+
+  std::string const path{ "test_indexfile_flat.bin" };
+  {
+    std::ofstream os(path, std::ios::binary);
+    std::vector<char> volume(bd::VOLUME_RECORD_BYTES);
+    bd::encodeVolume(index_file.getVolume(), volume.data());
+    std::vector<char> table(index_file.blocks().size() * bd::FILEBLOCK_RECORD_BYTES);
+    bd::encodeFileBlocks(index_file.blocks().data(), index_file.blocks().size(), table.data());
+    os.write(reinterpret_cast<char const *>(&h), sizeof(h));
+    os.write(volume.data(), static_cast<std::streamsize>(volume.size()));
+    os.write(table.data(), static_cast<std::streamsize>(table.size()));
+  }
+
+  for (bool map : { false, true }) {
+    bool ok{ false };
+    std::unique_ptr<bd::IndexFile> read{ map ? bd::IndexFile::mapBinaryIndexFile(path, ok)
+                                             : bd::IndexFile::fromBinaryIndexFile(path, ok) };
+    REQUIRE(ok);
+    REQUIRE(! read->isMapped());
+    bd::IndexFileHeader const &rh{ read->getHeader() };
+    REQUIRE(rh.version == bd::VERSION);
+    REQUIRE(rh.header_length == bd::HEAD_LEN);
+    REQUIRE(std::string(rh.raw_file) == "old.raw");
+    REQUIRE(bd::IndexFileHeader::getType(rh) == bd::DataType::Short);
+    REQUIRE(bd::IndexFileHeader::getStorage(rh) == bd::BlockStorage::RowMajor);
+    REQUIRE(bd::IndexFileHeader::getCodec(rh) == bd::Codec::None);
+    REQUIRE(read->getVolume().voxelDims() == index_file.getVolume().voxelDims());
+    REQUIRE(read->blocks().size() == 6);
+    REQUIRE(read->blocks()[5].data_offset == index_file.blocks()[5].data_offset);
+  }
+
+  std::remove(path.c_str());
+}
+
+
+TEST_CASE("Index records are little-endian", "[indexfile]")
+{
+  bd::IndexFile index_file;
+  index_file.getVolume().block_count({ 2, 1, 1 });
+  index_file.getVolume().voxelDims({ 8, 4, 4 });
+  index_file.init(bd::DataType::Float);
+
+  std::ostringstream os;
+  index_file.writeBinaryIndexFile(os);
+  std::string const bytes{ os.str() };
+  REQUIRE(bytes.size() > bd::PREAMBLE_RECORD_BYTES);
+
+  // magic 7376 = 0x1CD0, version 15, header_length 24, byte order 0x01020304.
+  unsigned char const preamble[]{ 0xD0, 0x1C, 15, 0, 24, 0, 0, 0, 4, 3, 2, 1 };
+  for (size_t i{ 0 }; i < sizeof(preamble); ++i) {
+    REQUIRE(static_cast<unsigned char>(bytes[i]) == preamble[i]);
+  }
+
+  // A block record put together a byte at a time decodes to the same values
+  // on any host.
+  std::vector<char> record(bd::FILEBLOCK_RECORD_BYTES, 0);
+  record[0] = 0x02;
+  record[1] = 0x01;
+  record[32] = 0x08;
+  record[33] = 0x07;
+  record[34] = 0x06;
+  // 1.5 is 0x3FF8000000000000 in the first of world_dims.
+  record[78] = static_cast<char>(0xF8);
+  record[79] = 0x3F;
+  bd::FileBlock b;
+  bd::decodeFileBlock(record.data(), record.size(), b);
+  REQUIRE(b.block_index == 0x0102);
+  REQUIRE(b.data_offset == 0x060708);
+  REQUIRE(b.world_dims[0] == 1.5);
+
+  char encoded[bd::FILEBLOCK_RECORD_BYTES];
+  bd::encodeFileBlock(b, encoded);
+  REQUIRE(std::memcmp(encoded, record.data(), record.size()) == 0);
+}
+
+
+TEST_CASE("Index records round trip", "[indexfile]")
+{
+  bd::IndexFileHeader h{ };
+  h.magic_number = bd::MAGIC;
+  h.version = bd::VERSION;
+  h.header_length = bd::HEAD_LEN;
+  h.dataType = bd::IndexFileHeader::getTypeInt(bd::DataType::UnsignedShort);
+  std::strcpy(h.raw_file, "some.raw");
+  h.storage = static_cast<uint16_t>(bd::BlockStorage::Bricked);
+  h.codec = static_cast<uint16_t>(bd::Codec::Lz4);
+
+  char headBytes[bd::HEADER_RECORD_BYTES];
+  bd::encodeHeader(h, headBytes);
+  bd::IndexFileHeader rh;
+  REQUIRE(bd::decodeHeader(headBytes, bd::HEADER_RECORD_BYTES, rh));
+  REQUIRE(rh.dataType == h.dataType);
+  REQUIRE(std::string(rh.raw_file) == "some.raw");
+  REQUIRE(bd::IndexFileHeader::getStorage(rh) == bd::BlockStorage::Bricked);
+  REQUIRE(bd::IndexFileHeader::getCodec(rh) == bd::Codec::Lz4);
+  REQUIRE_FALSE(bd::decodeHeader(headBytes, bd::IFH_V13_LENGTH, rh));
+
+  // The block dimensions of a ragged volume don't follow from its counts.
+  bd::Volume v;
+  v.block_count({ 3, 2, 1 });
+  v.voxelDims({ 10, 9, 8 });
+  v.block_dims({ 4, 5, 8 });
+  v.worldDims({ 1.0f, 0.5f, 0.25f });
+  v.min(-2.0);
+  v.max(7.5);
+  v.numEmptyVoxels(11);
+
+  char volBytes[bd::VOLUME_RECORD_BYTES];
+  bd::encodeVolume(v, volBytes);
+  bd::Volume rv;
+  REQUIRE(bd::decodeVolume(volBytes, bd::VOLUME_RECORD_BYTES, rv));
+  REQUIRE(rv.block_count() == v.block_count());
+  REQUIRE(rv.voxelDims() == v.voxelDims());
+  REQUIRE(rv.block_dims() == v.block_dims());
+  REQUIRE(rv.worldDims() == v.worldDims());
+  REQUIRE(rv.min() == -2.0);
+  REQUIRE(rv.max() == 7.5);
+  REQUIRE(rv.numEmptyVoxels() == 11);
+  REQUIRE_FALSE(bd::decodeVolume(volBytes, bd::VOLUME_RECORD_BYTES - 1, rv));
+}
@@ -0,0 +1,173 @@
+#include <bd/io/lodpyramid.h>
+#include <bd/io/indexfile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+namespace
+{
+
+glm::u64vec3 const DIMS{ 7, 6, 5 };
+
+
+/// \brief Value of voxel x,y,z of the test volume.
+unsigned short
+voxel(uint64_t x, uint64_t y, uint64_t z)
+{
+  return static_cast<unsigned short>(x + 10 * y + 100 * z);
+}
+
+
+std::string
+writeVolume()
+{
+  std::string const path{ "test_lodpyramid.raw" };
+  std::ofstream os(path, std::ios::binary);
+  for (uint64_t z{ 0 }; z < DIMS.z; ++z)
+  for (uint64_t y{ 0 }; y < DIMS.y; ++y)
+  for (uint64_t x{ 0 }; x < DIMS.x; ++x) {
+    unsigned short const v{ voxel(x, y, z) };
+    os.write(reinterpret_cast<char const *>(&v), sizeof(v));
+  }
+  return path;
+}
+
+
+std::vector<unsigned short>
+readLevel(std::string const &path, glm::u64vec3 const &dims)
+{
+  std::vector<unsigned short> v(dims.x * dims.y * dims.z);
+  std::ifstream is(path, std::ios::binary);
+  is.read(reinterpret_cast<char *>(v.data()), v.size() * sizeof(unsigned short));
+  REQUIRE(is);
+  return v;
+}
+
+
+void
+cleanUp(std::string const &raw, size_t levels)
+{
+  std::remove(raw.c_str());
+  for (size_t l{ 1 }; l < levels; ++l) {
+    std::remove(( raw + ".lod" + std::to_string(l) ).c_str());
+  }
+}
+
+} // namespace
+
+
+TEST_CASE("LOD levels halve the volume with the chosen filter", "[lod]")
+{
+  std::string const raw{ writeVolume() };
+  bd::IndexFile index;
+  index.getVolume().voxelDims(DIMS);
+  index.getVolume().block_count({ 2, 2, 1 });
+  index.init(bd::DataType::UnsignedShort);
+  index.setRawFileName(raw);
+
+  bd::LodPyramid pyramid;
+  REQUIRE(bd::buildLodPyramid(index, raw, 10, bd::LodFilter::Max, pyramid));
+
+  // 7x6x5 -> 4x3x3 -> 2x2x2 -> 1x1x1, then it stops.
+  REQUIRE(pyramid.numLevels() == 4);
+  REQUIRE(pyramid.level(1).voxelDims == glm::u64vec3(4, 3, 3));
+  REQUIRE(pyramid.level(2).voxelDims == glm::u64vec3(2, 2, 2));
+  REQUIRE(pyramid.level(3).voxelDims == glm::u64vec3(1, 1, 1));
+  REQUIRE(pyramid.level(1).blockCount == glm::u64vec3(1, 1, 1));
+
+  // Voxel values grow along every axis, so the max of each 2x2x2 group is
+  // its last voxel, clipped at the edges.
+  glm::u64vec3 const d1{ pyramid.level(1).voxelDims };
+  std::vector<unsigned short> const l1{ readLevel(pyramid.level(1).rawFile, d1) };
+  for (uint64_t z{ 0 }; z < d1.z; ++z)
+  for (uint64_t y{ 0 }; y < d1.y; ++y)
+  for (uint64_t x{ 0 }; x < d1.x; ++x) {
+    unsigned short const expected{ voxel(std::min<uint64_t>(2 * x + 1, DIMS.x - 1),
+                                         std::min<uint64_t>(2 * y + 1, DIMS.y - 1),
+                                         std::min<uint64_t>(2 * z + 1, DIMS.z - 1)) };
+    REQUIRE(l1[x + d1.x * ( y + d1.y * z )] == expected);
+  }
+
+  bd::FileBlock const &top{ pyramid.level(3).blocks[0] };
+  REQUIRE(top.min_val == voxel(6, 5, 4));
+  REQUIRE(top.max_val == voxel(6, 5, 4));
+
+  cleanUp(raw, pyramid.numLevels());
+}
+
+
+TEST_CASE("LOD average filter rounds the mean", "[lod]")
+{
+  std::string const raw{ writeVolume() };
+  bd::IndexFile index;
+  index.getVolume().voxelDims(DIMS);
+  index.getVolume().block_count({ 1, 1, 1 });
+  index.init(bd::DataType::UnsignedShort);
+
+  bd::LodPyramid pyramid;
+  REQUIRE(bd::buildLodPyramid(index, raw, 2, bd::LodFilter::Average, pyramid));
+  REQUIRE(pyramid.numLevels() == 2);
+
+  std::vector<unsigned short> const l1{ readLevel(pyramid.level(1).rawFile, { 4, 3, 3 }) };
+  // Mean of x 0..1, y 0..1, z 0..1 is 0.5 + 5 + 50.
+  REQUIRE(l1[0] == 56);
+  // The corner voxel 3,2,2 only covers x 6, y 4..5, z 4: 6 + 45 + 400.
+  REQUIRE(l1[3 + 4 * ( 2 + 3 * 2 )] == 451);
+
+  bd::FileBlock const &b{ pyramid.level(1).blocks[0] };
+  REQUIRE(b.min_val == 56);
+  REQUIRE(b.max_val == 451);
+
+  cleanUp(raw, pyramid.numLevels());
+}
+
+
+TEST_CASE("LOD pyramid round trips through the index and picks levels", "[lod]")
+{
+  std::string const raw{ writeVolume() };
+  bd::IndexFile index;
+  index.getVolume().voxelDims(DIMS);
+  index.getVolume().block_count({ 2, 2, 1 });
+  index.init(bd::DataType::UnsignedShort);
+  index.setRawFileName(raw);
+
+  bd::LodPyramid built;
+  REQUIRE(bd::buildLodPyramid(index, raw, 3, bd::LodFilter::Min, built));
+  REQUIRE(built.store(index));
+
+  std::string const idxPath{ "test_lodpyramid.bin" };
+  index.writeBinaryIndexFile(idxPath);
+  bool ok{ false };
+  std::unique_ptr<bd::IndexFile> read{ bd::IndexFile::fromBinaryIndexFile(idxPath, ok) };
+  REQUIRE(ok);
+
+  bd::LodPyramid loaded;
+  REQUIRE(loaded.load(*read));
+  REQUIRE(loaded.numLevels() == 3);
+  REQUIRE(loaded.filter() == bd::LodFilter::Min);
+  REQUIRE(loaded.level(0).rawFile == raw);
+  for (size_t l{ 1 }; l < loaded.numLevels(); ++l) {
+    REQUIRE(loaded.level(l).voxelDims == built.level(l).voxelDims);
+    REQUIRE(loaded.level(l).rawFile == built.level(l).rawFile);
+    REQUIRE(loaded.level(l).blocks.size() == built.level(l).blocks.size());
+    for (size_t b{ 0 }; b < loaded.level(l).blocks.size(); ++b) {
+      REQUIRE(loaded.level(l).blocks[b].min_val == built.level(l).blocks[b].min_val);
+      REQUIRE(loaded.level(l).blocks[b].data_offset == built.level(l).blocks[b].data_offset);
+    }
+  }
+
+  // Level 1 voxels span 2 level 0 voxels, level 2 voxels 7/2.
+  REQUIRE(loaded.selectLevel(1.0, 1.0) == 0);
+  REQUIRE(loaded.selectLevel(0.5, 1.0) == 1);
+  REQUIRE(loaded.selectLevel(0.25, 1.0) == 2);
+  REQUIRE(loaded.selectLevel(0.01, 1.0) == 2);
+
+  std::remove(idxPath.c_str());
+  cleanUp(raw, loaded.numLevels());
+}
@@ -0,0 +1,62 @@
+#include <bd/io/mmapreader.h>
+
+#include <fstream>
+#include <vector>
+
+#include <catch.hpp>
+
+#define RES_DIR RESOURCE_FOLDER
+
+
+TEST_CASE("MmapReader hands out the whole file in order", "[mmapreader]")
+{
+  const char *path = RES_DIR "/testvol_8x8x8.raw";
+
+  std::ifstream in(path, std::ios::binary);
+  REQUIRE(in.is_open());
+  std::vector<char> expected((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+  REQUIRE(expected.size() == 512);
+
+  bd::MmapReader<unsigned char> reader{ 100 };
+  REQUIRE(reader.open(path));
+  REQUIRE(reader.fileSize() == 512);
+  reader.start();
+
+  size_t total{ 0 };
+  size_t numBuffers{ 0 };
+  bd::Buffer<unsigned char> *buf{ nullptr };
+  while ((buf = reader.waitNextFullUntilNone()) != nullptr) {
+    REQUIRE(buf->getIndexOffset() == total);
+    REQUIRE(buf->getMaxNumElements() == 100);
+
+    for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+      REQUIRE(buf->getPtr()[i] ==
+                  static_cast<unsigned char>(expected[total + i]));
+    }
+
+    total += buf->getNumElements();
+    ++numBuffers;
+    reader.waitReturnEmpty(buf);
+  }
+
+  REQUIRE(total == 512);
+  REQUIRE(numBuffers == 6);
+  REQUIRE(reader.reset() == 512);
+}
+
+
+TEST_CASE("MmapReader returns nothing after stop", "[mmapreader]")
+{
+  bd::MmapReader<unsigned short> reader{ 64 };
+  REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+  reader.start();
+
+  bd::Buffer<unsigned short> *buf{ reader.waitNextFullUntilNone() };
+  REQUIRE(buf != nullptr);
+  REQUIRE(buf->getNumElements() == 32);
+  reader.waitReturnEmpty(buf);
+
+  reader.stop();
+  REQUIRE(reader.waitNextFullUntilNone() == nullptr);
+}
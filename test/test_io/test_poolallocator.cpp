@@ -0,0 +1,92 @@
+#include <bd/io/bufferedreader.h>
+#include <bd/io/bufferpool.h>
+#include <bd/io/nodelocalpools.h>
+#include <bd/io/poolallocator.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <catch.hpp>
+
+
+TEST_CASE("PoolMemory honours alignment and falls back from huge pages", "[poolallocator]")
+{
+  bd::PageSize const sizes[]{ bd::PageSize::Default, bd::PageSize::Transparent,
+                              bd::PageSize::Huge2M, bd::PageSize::Huge1G };
+  size_t const bytes{ 3 * 1024 * 1024 + 17 };
+
+  for (bd::PageSize ps : sizes) {
+    bd::PoolAllocPolicy policy;
+    policy.alignment = 4096;
+    policy.pages = ps;
+    policy.prefault = true;
+
+    bd::PoolMemory mem;
+    REQUIRE(mem.allocate(bytes, policy));
+    REQUIRE(mem.ptr() != nullptr);
+    REQUIRE(mem.bytes() == bytes);
+    REQUIRE(reinterpret_cast<uintptr_t>(mem.ptr()) % 4096 == 0);
+    if (mem.pages() == bd::PageSize::Transparent) {
+      REQUIRE(reinterpret_cast<uintptr_t>(mem.ptr()) % (2 * 1024 * 1024) == 0);
+    }
+
+    // Every byte is usable.
+    std::memset(mem.ptr(), 0xab, bytes);
+    REQUIRE(static_cast<unsigned char *>(mem.ptr())[bytes - 1] == 0xab);
+
+    mem.release();
+    REQUIRE(mem.ptr() == nullptr);
+  }
+}
+
+
+TEST_CASE("BufferPool allocates with a NUMA node policy", "[poolallocator]")
+{
+  bd::PoolAllocPolicy policy;
+  policy.alignment = 64;
+  policy.numaNode = 0;
+
+  bd::BufferPool<float> pool{ 4 * 1024 * sizeof(float), 4 };
+  pool.setAllocPolicy(policy);
+  REQUIRE(pool.allocate());
+
+  for (int i{ 0 }; i < 4; ++i) {
+    bd::Buffer<float> *buf{ pool.nextEmpty() };
+    REQUIRE(buf != nullptr);
+    REQUIRE(reinterpret_cast<uintptr_t>(buf->getPtr()) % 64 == 0);
+    buf->getPtr()[buf->getMaxNumElements() - 1] = 1.0f;
+  }
+}
+
+
+TEST_CASE("BufferPool refuses buffers smaller than the alignment", "[poolallocator]")
+{
+  // 1 KiB per buffer would round down to nothing at 4 KiB alignment.
+  bd::BufferPool<char> pool{ 4 * 1024, 4, 4096 };
+  REQUIRE_FALSE(pool.allocate());
+  REQUIRE(pool.memory().ptr() == nullptr);
+
+  // A reader that can't get its pool fails to open, rather than leaving
+  // its reader threads waiting on buffers that never come.
+  bd::PoolAllocPolicy policy;
+  policy.alignment = 4096;
+  bd::BufferedReader<char> reader{ 4 * 1024 };
+  reader.setNumBuffers(4);
+  reader.setAllocPolicy(policy);
+  REQUIRE_FALSE(reader.open(RESOURCE_FOLDER "/testvol_8x8x8.raw"));
+}
+
+
+TEST_CASE("NodeLocalPools has a pool for every node", "[poolallocator]")
+{
+  bd::NodeLocalPools<int> pools{ 1024, 2 };
+  REQUIRE(pools.allocate());
+
+  REQUIRE(pools.numNodes() == bd::numaNodeCount());
+  REQUIRE(bd::currentNumaNode() < pools.numNodes());
+
+  bd::BufferPool<int> &local{ pools.local() };
+  bd::Buffer<int> *buf{ local.nextEmpty() };
+  REQUIRE(buf != nullptr);
+  local.returnEmpty(buf);
+}
@@ -0,0 +1,82 @@
+#include <bd/io/bufferpool.h>
+#include <bd/io/readerworker.h>
+#include <bd/io/readbackend.h>
+
+#include <atomic>
+#include <future>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Run a ReaderWorker over testvol_8x8x8.raw, collecting buffers by offset.
+std::vector<unsigned short>
+readAll(bd::ReadBackend *backend, long long &bytes)
+{
+  bd::BufferPool<unsigned short> pool{ 96, 4 };
+  pool.allocate();
+
+  std::atomic_bool quit{ false };
+  bd::ReaderWorker<unsigned short> worker{ pool, backend };
+  worker.setPath(RES_DIR "/testvol_8x8x8.raw");
+  std::future<long long> f{
+      std::async(std::launch::async, [&]() { return worker(quit); }) };
+
+  std::vector<unsigned short> got(256, 0);
+  bd::Buffer<unsigned short> *buf{ nullptr };
+  while ((buf = pool.nextFullUntilNone()) != nullptr) {
+    for (size_t i{ 0 }; i < buf->getNumElements(); ++i) {
+      got[buf->getIndexOffset() + i] = buf->getPtr()[i];
+    }
+    pool.returnEmpty(buf);
+  }
+
+  bytes = f.get();
+  return got;
+}
+
+} // namespace
+
+
+TEST_CASE("ReaderWorker reads whole elements from the ifstream", "[readerworker]")
+{
+  long long bytes{ 0 };
+  std::vector<unsigned short> got{ readAll(nullptr, bytes) };
+  REQUIRE(bytes == 512);
+  REQUIRE(got == readTestVolume<unsigned short>());
+}
+
+
+TEST_CASE("ReaderWorker reads through the pread backend", "[readerworker]")
+{
+  bd::ReadBackend *backend{ bd::ReadBackend::create(bd::ReadBackendType::Pread, 3) };
+  REQUIRE(backend != nullptr);
+
+  long long bytes{ 0 };
+  std::vector<unsigned short> got{ readAll(backend, bytes) };
+  REQUIRE(bytes == 512);
+  REQUIRE(got == readTestVolume<unsigned short>());
+
+  delete backend;
+}
+
+
+TEST_CASE("ReaderWorker reads through the io_uring backend", "[readerworker]")
+{
+  // Falls back to pread when io_uring is unavailable.
+  bd::ReadBackend *backend{ bd::ReadBackend::create(bd::ReadBackendType::Uring, 4) };
+  REQUIRE(backend != nullptr);
+
+  long long bytes{ 0 };
+  std::vector<unsigned short> got{ readAll(backend, bytes) };
+  REQUIRE(bytes == 512);
+  REQUIRE(got == readTestVolume<unsigned short>());
+
+  delete backend;
+}
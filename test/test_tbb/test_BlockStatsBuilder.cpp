@@ -0,0 +1,131 @@
+#include <bd/tbb/blockstatsbuilder.h>
+#include <bd/io/bufferedreader.h>
+#include <bd/io/indexfile.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+struct AboveFifty
+{
+  bool
+  operator()(unsigned char v) const
+  {
+    return v > 50;
+  }
+};
+
+
+/// \brief Check each block against a plain scan of its voxels in \c vol.
+void
+checkBlocks(bd::IndexFile &index, std::vector<unsigned char> const &vol, int threshold)
+{
+  glm::u64vec3 const bd{ index.getVolume().block_dims() };
+  uint64_t volEmpty{ 0 };
+  double volMin{ 255 }, volMax{ 0 };
+
+  for (bd::FileBlock const &fb : index.getFileBlocks()) {
+    glm::u64vec3 const start{ fb.ijk_index[0] * bd.x,
+                              fb.ijk_index[1] * bd.y,
+                              fb.ijk_index[2] * bd.z };
+    double mn{ 255 }, mx{ 0 }, total{ 0 };
+    uint64_t relevant{ 0 };
+    for (uint64_t z{ start.z }; z < start.z + bd.z; ++z)
+    for (uint64_t y{ start.y }; y < start.y + bd.y; ++y)
+    for (uint64_t x{ start.x }; x < start.x + bd.x; ++x) {
+      double const v{ static_cast<double>(vol[x + 8 * ( y + 8 * z )]) };
+      mn = std::min(mn, v);
+      mx = std::max(mx, v);
+      total += v;
+      relevant += v > threshold ? 1 : 0;
+    }
+
+    uint64_t const n{ bd.x * bd.y * bd.z };
+    REQUIRE(fb.min_val == mn);
+    REQUIRE(fb.max_val == mx);
+    REQUIRE(fb.total_val == total);
+    REQUIRE(fb.avg_val == Approx(total / n));
+    REQUIRE(fb.empty_voxels == n - relevant);
+    REQUIRE(fb.rov == Approx(static_cast<double>(relevant) / n));
+    REQUIRE(fb.is_empty == ( relevant == 0 ? 1u : 0u ));
+    volEmpty += n - relevant;
+    volMin = std::min(volMin, mn);
+    volMax = std::max(volMax, mx);
+  }
+
+  REQUIRE(index.getVolume().numEmptyVoxels() == volEmpty);
+  REQUIRE(index.getVolume().min() == volMin);
+  REQUIRE(index.getVolume().max() == volMax);
+}
+
+} // namespace
+
+
+TEST_CASE("BlockStatsBuilder matches a scan of the reader's buffers", "[tbb][blockstats]")
+{
+  std::vector<unsigned char> const vol{ readTestVolume<unsigned char>() };
+
+  bd::IndexFile index;
+  makeTestIndex(index, { 2, 2, 2 });
+
+  // 37 element buffers start and end in the middle of rows and blocks.
+  bd::BufferedReader<unsigned char> reader{ 4 * 37 };
+  reader.setNumBuffers(4);
+  reader.setNumReaders(2, bd::DeliveryOrder::Arrival);
+  REQUIRE(reader.open(RES_DIR "/testvol_8x8x8.raw"));
+  reader.start();
+
+  bd::BlockStatsBuilder<unsigned char, AboveFifty> builder{ index };
+  REQUIRE(builder.consume(reader) == 512);
+  builder.finish();
+
+  checkBlocks(index, vol, 50);
+}
+
+
+TEST_CASE("BlockStatsBuilder counts every voxel relevant by default", "[tbb][blockstats]")
+{
+  std::vector<unsigned char> vol{ readTestVolume<unsigned char>() };
+
+  bd::IndexFile index;
+  makeTestIndex(index, { 4, 2, 1 });
+
+  bd::BlockStatsBuilder<unsigned char> builder{ index };
+  for (size_t off{ 0 }; off < vol.size(); off += 100) {
+    bd::Buffer<unsigned char> buf{ vol.data() + off, 100, off };
+    buf.setNumElements(std::min<size_t>(100, vol.size() - off));
+    builder.add(buf);
+  }
+  builder.finish();
+
+  checkBlocks(index, vol, -1);
+}
+
+
+TEST_CASE("BlockStatsBuilder leaves out voxels past dropped edge blocks", "[tbb][blockstats]")
+{
+  std::vector<unsigned char> vol{ readTestVolume<unsigned char>() };
+
+  // 3 blocks of 2 along each axis, the last 2 voxels of each axis are dropped.
+  bd::IndexFile index;
+  makeTestIndex(index, { 3, 3, 3 });
+  REQUIRE(( index.getVolume().blocksExtent() == glm::u64vec3{ 6, 6, 6 } ));
+
+  bd::BlockStatsBuilder<unsigned char, AboveFifty> builder{ index };
+  for (size_t off{ 0 }; off < vol.size(); off += 37) {
+    bd::Buffer<unsigned char> buf{ vol.data() + off, 37, off };
+    buf.setNumElements(std::min<size_t>(37, vol.size() - off));
+    builder.add(buf);
+  }
+  builder.finish();
+
+  checkBlocks(index, vol, 50);
+}
@@ -12,11 +12,14 @@
 #include <tbb/parallel_for.h>
 
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 #include <catch.hpp>
 
+#include "testvolume.h"
+
 #define RES_DIR RESOURCE_FOLDER
 
 namespace
@@ -68,18 +71,17 @@ TEST_CASE("ParallelVoxelClassifer test")
     return val > 128 && val < 168;
   };
 
-  std::vector<bool> map(contents.size(), false);
+  bd::RelevanceBitmap map(contents.size());
 
   bd::Buffer<unsigned char> buf{
       reinterpret_cast<unsigned char*>(contents.data()), contents.size() };
+  buf.setNumElements(contents.size());
 
-  bd::ParallelForVoxelRelevance<unsigned char, decltype(rel), std::vector<bool>> classifier{ map, &buf, rel };
+  bd::ParallelForVoxelRelevance<unsigned char, decltype(rel)> classifier{ map, &buf, rel };
 
-  tbb::blocked_range<size_t> range{ 0, contents.size() };
+  tbb::blocked_range<size_t> range{ 0, map.words() };
   tbb::parallel_for(range, classifier);
 
-  std::cout << "done";
-
   for(int i{ 0 }; i < 43; ++i) {
     if (map[i] == true) {
       FAIL("At index " + std::to_string(i) + " map was true, should have been false.");
@@ -98,5 +100,62 @@ TEST_CASE("ParallelVoxelClassifer test")
     }
   }
 
-  REQUIRE(true);
+  REQUIRE(map.count() == 13);
+}
+
+
+namespace
+{
+
+/// Classify the test volume in buffers that don't line up with rows or
+/// words, and check the counts of a volume of \c numBlocks blocks against
+/// a count made one voxel at a time.
+void
+checkBlockCounts(glm::u64vec3 const &numBlocks)
+{
+  std::vector<unsigned char> vol{ readTestVolume<unsigned char>() };
+
+  bd::Volume volume{ { 8, 8, 8 }, numBlocks };
+  glm::u64vec3 const bd{ volume.block_dims() };
+  auto rel = [](unsigned char val) -> bool { return val > 50; };
+
+  std::vector<uint64_t> expected(numBlocks.x * numBlocks.y * numBlocks.z, 0);
+  for (size_t i{ 0 }; i < vol.size(); ++i) {
+    glm::u64vec3 const b{ i % 8 / bd.x, ( i / 8 ) % 8 / bd.y, i / 64 / bd.z };
+    if (b.x < numBlocks.x && b.y < numBlocks.y && b.z < numBlocks.z) {
+      expected[b.x + numBlocks.x * ( b.y + numBlocks.y * b.z )] += rel(vol[i]) ? 1 : 0;
+    }
+  }
+
+  size_t const bufLen{ 100 };
+  std::vector<uint64_t> counts;
+  uint64_t total{ 0 };
+  for (size_t off{ 0 }; off < vol.size(); off += bufLen) {
+    bd::Buffer<unsigned char> buf{ vol.data() + off, bufLen, off };
+    buf.setNumElements(std::min(bufLen, vol.size() - off));
+
+    bd::RelevanceBitmap map;
+    total += bd::parallelBlockRelevance(buf, rel, volume, map, counts);
+    for (size_t i{ 0 }; i < buf.getNumElements(); ++i) {
+      REQUIRE(map[i] == rel(vol[off + i]));
+    }
+  }
+
+  REQUIRE(counts == expected);
+  REQUIRE(total == static_cast<uint64_t>(std::count_if(vol.begin(), vol.end(), rel)));
+}
+
+} // namespace
+
+
+TEST_CASE("ParallelVoxelClassifer counts relevant voxels per block")
+{
+  checkBlockCounts({ 2, 2, 2 });
+}
+
+
+TEST_CASE("ParallelVoxelClassifer leaves out voxels past dropped edge blocks")
+{
+  // 3 blocks of 2 along each axis, the last 2 voxels of each axis are dropped.
+  checkBlockCounts({ 3, 3, 3 });
 }
@@ -0,0 +1,70 @@
+#include <bd/util/util.h>
+
+#include <cstdlib>
+#include <set>
+
+#include <catch.hpp>
+
+
+TEST_CASE("Morton codes interleave the coordinate bits", "[util]")
+{
+  REQUIRE(bd::toMorton(0, 0, 0) == 0);
+  REQUIRE(bd::toMorton(1, 0, 0) == 1);
+  REQUIRE(bd::toMorton(0, 1, 0) == 2);
+  REQUIRE(bd::toMorton(0, 0, 1) == 4);
+  REQUIRE(bd::toMorton(3, 3, 3) == 63);
+  REQUIRE(bd::toMorton(0x1fffff, 0, 0) == 0x1249249249249249ULL);
+
+  size_t const coords[][3]{ { 5, 9, 2 }, { 1023, 0, 77 }, { 0x1fffff, 0x1ffffe, 0x100001 } };
+  for (auto const &c : coords) {
+    size_t x, y, z;
+    bd::fromMorton(bd::toMorton(c[0], c[1], c[2]), x, y, z);
+    REQUIRE(x == c[0]);
+    REQUIRE(y == c[1]);
+    REQUIRE(z == c[2]);
+  }
+}
+
+
+TEST_CASE("Hilbert codes walk between neighbouring cells", "[util]")
+{
+  for (unsigned bits{ 1 }; bits <= 4; ++bits) {
+    size_t const side{ size_t(1) << bits };
+    size_t const cells{ side * side * side };
+
+    std::set<size_t> seen;
+    size_t px{ 0 }, py{ 0 }, pz{ 0 };
+    for (size_t h{ 0 }; h < cells; ++h) {
+      size_t x, y, z;
+      bd::fromHilbert(h, bits, x, y, z);
+      REQUIRE(x < side);
+      REQUIRE(y < side);
+      REQUIRE(z < side);
+      REQUIRE(bd::toHilbert(x, y, z, bits) == h);
+      seen.insert(bd::to1D(x, y, z, side, side));
+
+      if (h == 0) {
+        REQUIRE(x + y + z == 0);
+      } else {
+        long const step{ std::labs(long(x) - long(px)) + std::labs(long(y) - long(py)) +
+                         std::labs(long(z) - long(pz)) };
+        REQUIRE(step == 1);
+      }
+      px = x;
+      py = y;
+      pz = z;
+    }
+    REQUIRE(seen.size() == cells);
+  }
+}
+
+
+TEST_CASE("curveBits covers the coordinate range", "[util]")
+{
+  REQUIRE(bd::curveBits(0) == 1);
+  REQUIRE(bd::curveBits(2) == 1);
+  REQUIRE(bd::curveBits(3) == 2);
+  REQUIRE(bd::curveBits(4) == 2);
+  REQUIRE(bd::curveBits(5) == 3);
+  REQUIRE(bd::curveBits(1024) == 10);
+}
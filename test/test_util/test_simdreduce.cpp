@@ -0,0 +1,121 @@
+#include <bd/util/simdreduce.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+namespace
+{
+
+/// \brief Random values over the whole range of Ty (or +-1e6 for floats),
+///        with both ends of the range mixed in.
+template<class Ty>
+std::vector<Ty>
+makeData(size_t n)
+{
+  std::mt19937 gen{ 42 };
+  double const lo{ std::numeric_limits<Ty>::is_integer
+                       ? static_cast<double>(std::numeric_limits<Ty>::lowest()) : -1e6 };
+  double const hi{ std::numeric_limits<Ty>::is_integer
+                       ? static_cast<double>(std::numeric_limits<Ty>::max()) : 1e6 };
+  std::uniform_real_distribution<double> dist{ lo, hi };
+
+  std::vector<Ty> data(n);
+  for (Ty &v : data) {
+    v = static_cast<Ty>(dist(gen));
+  }
+  if (n > 10) {
+    data[n / 3] = static_cast<Ty>(lo);
+    data[n / 2] = static_cast<Ty>(hi);
+  }
+  return data;
+}
+
+
+template<class Ty>
+void
+checkAllLevels(size_t n, double lo, double hi)
+{
+  std::vector<Ty> const data{ makeData<Ty>(n) };
+
+  double mn{ std::numeric_limits<double>::max() };
+  double mx{ std::numeric_limits<double>::lowest() };
+  double sum{ 0.0 };
+  uint64_t inRange{ 0 };
+  for (Ty v : data) {
+    double const d{ static_cast<double>(v) };
+    mn = std::min(mn, d);
+    mx = std::max(mx, d);
+    sum += d;
+    inRange += ( d >= lo && d <= hi ) ? 1 : 0;
+  }
+
+  for (int l{ 0 }; l <= static_cast<int>(bd::detectSimdLevel()); ++l) {
+    bd::SimdLevel const level{ static_cast<bd::SimdLevel>(l) };
+    INFO("level " << bd::to_string(level) << ", n " << n);
+    bd::ReduceResult const r{ bd::reduce(data.data(), data.size(), lo, hi, level) };
+    REQUIRE(r.min == mn);
+    REQUIRE(r.max == mx);
+    REQUIRE(r.sum == Approx(sum));
+    REQUIRE(r.inRange == inRange);
+  }
+}
+
+
+template<class Ty>
+void
+checkType(double lo, double hi)
+{
+  // Shorter than any vector, an odd length, and long enough to flush.
+  for (size_t n : { 0, 3, 1001, 600001 }) {
+    checkAllLevels<Ty>(n, lo, hi);
+  }
+}
+
+} // namespace
+
+
+TEST_CASE("reduce matches a scalar scan for every type and level", "[util][simdreduce]")
+{
+  checkType<char>(-20.5, 60);
+  checkType<unsigned char>(100, 200.5);
+  checkType<short>(-1000, 1000);
+  checkType<unsigned short>(0, 40000);
+  checkType<int>(-1e8, 5e8);
+  checkType<unsigned int>(1e9, 4e9);
+  checkType<float>(-1234.5, 1e5);
+  checkType<double>(-0.5, 7e5);
+}
+
+
+TEST_CASE("reduce counts nothing in an empty or disjoint range", "[util][simdreduce]")
+{
+  std::vector<int> const ints{ makeData<int>(1000) };
+  std::vector<unsigned char> const bytes{ makeData<unsigned char>(1000) };
+
+  for (int l{ 0 }; l <= static_cast<int>(bd::detectSimdLevel()); ++l) {
+    bd::SimdLevel const level{ static_cast<bd::SimdLevel>(l) };
+    INFO("level " << bd::to_string(level));
+    REQUIRE(bd::reduce(ints.data(), ints.size(), 10, 5, level).inRange == 0);
+    REQUIRE(bd::reduce(bytes.data(), bytes.size(), 300, 400, level).inRange == 0);
+    REQUIRE(bd::reduce(bytes.data(), bytes.size(), 10.2, 10.8, level).inRange == 0);
+    REQUIRE(bd::reduce(bytes.data(), bytes.size(), -10, 1000, level).inRange == 1000);
+  }
+}
+
+
+TEST_CASE("reduce by DataType", "[util][simdreduce]")
+{
+  std::vector<unsigned short> const data{ 1, 5, 9, 300 };
+  bd::ReduceResult r;
+  REQUIRE(bd::reduce(bd::DataType::UnsignedShort, data.data(), data.size(), 2, 10, r));
+  REQUIRE(r.min == 1);
+  REQUIRE(r.max == 300);
+  REQUIRE(r.sum == 315);
+  REQUIRE(r.inRange == 2);
+
+  REQUIRE_FALSE(bd::reduce(bd::DataType::Unknown, data.data(), data.size(), 2, 10, r));
+}
@@ -0,0 +1,144 @@
+#include <bd/volume/blockloader.h>
+#include <bd/volume/block.h>
+#include <bd/io/indexfile.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "testvolume.h"
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+struct Fixture
+{
+  Fixture()
+  {
+    raw = readTestVolume<char>();
+
+    makeTestIndex(index);
+
+    for (bd::FileBlock const &fb : index.getFileBlocks()) {
+      blocks.push_back(std::unique_ptr<bd::Block>(new bd::Block({ 0, 0, 0 }, fb)));
+    }
+  }
+
+
+  /// Deliver until \c n blocks arrived or a second passed.
+  size_t
+  deliverAll(bd::BlockLoader &loader, size_t n)
+  {
+    size_t got{ 0 };
+    auto const giveUp = std::chrono::steady_clock::now() + std::chrono::seconds{ 1 };
+    while (got < n && std::chrono::steady_clock::now() < giveUp) {
+      got += loader.deliver();
+      std::this_thread::yield();
+    }
+    return got;
+  }
+
+
+  bool
+  matchesRaw(bd::Block &b) const
+  {
+    bd::FileBlock const &fb{ b.fileBlock() };
+    size_t i{ 0 };
+    for (size_t z{ 0 }; z < fb.voxel_dims[2]; ++z)
+    for (size_t y{ 0 }; y < fb.voxel_dims[1]; ++y)
+    for (size_t x{ 0 }; x < fb.voxel_dims[0]; ++x) {
+      if (b.pixelData()[i++] != raw[fb.data_offset + x + 8 * ( y + 8 * z )]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  std::vector<char> raw;
+  bd::IndexFile index;
+  std::vector<std::unique_ptr<bd::Block>> blocks;
+};
+
+} // namespace
+
+
+TEST_CASE("BlockLoader delivers requested blocks", "[blockloader]")
+{
+  Fixture f;
+  bd::BlockLoader loader{ f.index, 8, 3 };
+  REQUIRE(loader.open(RES_DIR "/testvol_8x8x8.raw"));
+  REQUIRE(loader.slabBytes() == 64);
+  loader.start();
+
+  for (size_t i{ 0 }; i < f.blocks.size(); ++i) {
+    loader.request(f.blocks[i].get(), static_cast<float>(i));
+  }
+
+  REQUIRE(f.deliverAll(loader, 8) == 8);
+  REQUIRE(loader.outstanding() == 0);
+  for (auto &b : f.blocks) {
+    REQUIRE(b->pixelData() != nullptr);
+    REQUIRE((b->status() & bd::Block::CPU_RES) != 0);
+    REQUIRE(f.matchesRaw(*b));
+  }
+}
+
+
+TEST_CASE("BlockLoader loads by priority and reuses evicted slabs", "[blockloader]")
+{
+  Fixture f;
+  // One slab, so each load must wait for the previous block to be evicted.
+  bd::BlockLoader loader{ f.index, 1, 1 };
+  REQUIRE(loader.open(RES_DIR "/testvol_8x8x8.raw"));
+
+  // Queue everything before starting so the order is decided by priority.
+  for (size_t i{ 0 }; i < f.blocks.size(); ++i) {
+    loader.request(f.blocks[i].get(), -static_cast<float>(i));
+  }
+  loader.start();
+
+  for (size_t n{ 0 }; n < f.blocks.size(); ++n) {
+    bd::Block &expected{ *f.blocks[f.blocks.size() - 1 - n] };
+    REQUIRE(f.deliverAll(loader, 1) == 1);
+    REQUIRE(expected.pixelData() != nullptr);
+    REQUIRE(f.matchesRaw(expected));
+    loader.evict(&expected);
+    REQUIRE(expected.pixelData() == nullptr);
+  }
+}
+
+
+TEST_CASE("BlockLoader drops cancelled requests", "[blockloader]")
+{
+  Fixture f;
+  bd::BlockLoader loader{ f.index, 8, 2 };
+  REQUIRE(loader.open(RES_DIR "/testvol_8x8x8.raw"));
+
+  for (size_t i{ 0 }; i < f.blocks.size(); ++i) {
+    loader.request(f.blocks[i].get(), static_cast<float>(i));
+  }
+  loader.cancel(f.blocks[0].get());
+  loader.cancel(f.blocks[5].get());
+  REQUIRE(loader.outstanding() == 6);
+  loader.start();
+
+  REQUIRE(f.deliverAll(loader, 6) == 6);
+  REQUIRE(f.blocks[0]->pixelData() == nullptr);
+  REQUIRE(f.blocks[5]->pixelData() == nullptr);
+
+  // Everything in flight is dropped after cancelAll().
+  for (auto &b : f.blocks) {
+    loader.evict(b.get());
+    loader.request(b.get(), 0.0f);
+  }
+  loader.cancelAll();
+  REQUIRE(loader.outstanding() == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+  REQUIRE(loader.deliver() == 0);
+}
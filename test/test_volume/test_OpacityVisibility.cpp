@@ -0,0 +1,99 @@
+#include <bd/volume/opacityvisibility.h>
+
+#include <random>
+
+#include <catch.hpp>
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Knots: (0, 0) (0.16, 0) (0.33, 1) (0.5, 1) (0.66, 1) (0.83, 0.5) (1, 0),
+/// over data values 0 to 1000. interpolate() gives 0 up to about 250.
+bd::OpacityLUT
+makeLut()
+{
+  bd::OpacityTransferFunction otf{ };
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+  return bd::OpacityLUT{ otf, 1001, 0.0, 1000.0 };
+}
+
+} // namespace
+
+
+TEST_CASE("Value ranges in the transparent part are not visible", "[otf][visibility]")
+{
+  bd::OpacityLUT const lut{ makeLut() };
+  bd::OpacityVisibility const vis{ lut };
+  REQUIRE(vis.size() == 1001);
+
+  REQUIRE_FALSE(vis.isVisible(0.0, 200.0));
+  REQUIRE(vis.isVisible(0.0, 300.0));
+  REQUIRE(vis.isVisible(400.0, 400.0));
+  REQUIRE(vis.isVisible(900.0, 5000.0));
+  REQUIRE_FALSE(vis.isVisible(200.0, 100.0));
+
+  bd::FileBlock b;
+  REQUIRE_FALSE(bd::isBlockVisible(b, vis));
+  b.min_val = 20;
+  b.max_val = 40;
+  REQUIRE_FALSE(bd::isBlockVisible(b, vis));
+  b.max_val = 600;
+  REQUIRE(bd::isBlockVisible(b, vis));
+
+  // A higher threshold hides the ramps.
+  bd::OpacityVisibility const opaque{ lut, 0.99 };
+  REQUIRE_FALSE(opaque.isVisible(0.0, 300.0));
+  REQUIRE(opaque.isVisible(0.0, 340.0));
+}
+
+
+TEST_CASE("Visibility never misses a visible LUT entry", "[otf][visibility]")
+{
+  bd::OpacityLUT const lut{ makeLut() };
+  bd::OpacityVisibility const vis{ lut };
+
+  std::mt19937 gen{ 7 };
+  std::uniform_real_distribution<double> dist{ -50.0, 1050.0 };
+  std::uniform_real_distribution<double> width{ 0.0, 50.0 };
+  for (int t{ 0 }; t < 2000; ++t) {
+    double const lo{ dist(gen) };
+    double const hi{ lo + width(gen) };
+
+    bool any{ false };
+    for (double v{ lo }; v <= hi; v += 0.25) {
+      any = any || lut.lookup(v) > 0.0;
+    }
+    any = any || lut.lookup(hi) > 0.0;
+    if (any) {
+      REQUIRE(vis.isVisible(lo, hi));
+    }
+  }
+}
+
+
+TEST_CASE("The 2D visibility table agrees with range queries", "[otf][visibility]")
+{
+  bd::OpacityVisibility const vis{ makeLut() };
+  size_t const n{ 16 };
+  std::vector<uint8_t> const table{ vis.table2D(n) };
+  REQUIRE(table.size() == n * n);
+
+  for (size_t i{ 0 }; i < n; ++i) {
+    for (size_t j{ 0 }; j < n; ++j) {
+      if (i > j) {
+        REQUIRE(table[i * n + j] == 0);
+        continue;
+      }
+      // Every range inside bins i..j must be covered by the entry.
+      double const lo{ 1000.0 * i / n };
+      double const hi{ 1000.0 * ( j + 1 ) / n };
+      if (vis.isVisible(lo + 1.0, hi - 1.0)) {
+        REQUIRE(table[i * n + j] == 1);
+      }
+    }
+  }
+  REQUIRE(table[0 * n + 1] == 0);  // 0 to 125
+  REQUIRE(table[0 * n + 15] == 1);
+}
@@ -0,0 +1,123 @@
+#include <bd/volume/preintegratedtable.h>
+#include <bd/volume/transferfunctionlut.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <catch.hpp>
+
+#define RES_DIR RESOURCE_FOLDER
+
+namespace
+{
+
+/// Write a color transfer function going from dark red to white.
+std::string
+writeColorFile()
+{
+  std::string const path{ "test_preintegrated.ctf" };
+  std::ofstream f{ path };
+  f << "3\n"
+       "0.0 0.2 0.0 0.0\n"
+       "0.5 1.0 0.5 0.0\n"
+       "1.0 1.0 1.0 1.0\n";
+  return path;
+}
+
+
+/// Write an opacity transfer function with \c n evenly spaced knots of
+/// opacity \c alpha, except knot \c spike, which is opaque.
+std::string
+writeOpacityFile(int n, double alpha, int spike)
+{
+  std::string const path{ "test_preintegrated.1dt" };
+  std::ofstream f{ path };
+  f << n << "\n";
+  for (int i{ 0 }; i < n; ++i) {
+    f << double(i) / ( n - 1 ) << " " << ( i == spike ? 1.0 : alpha ) << "\n";
+  }
+  return path;
+}
+
+} // namespace
+
+
+TEST_CASE("Pre-integrated entries of constant segments match the opacity",
+          "[preintegrated]")
+{
+  bd::ColorTransferFunction ctf;
+  bd::OpacityTransferFunction otf;
+  ctf.load(writeColorFile());
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  double const step{ 0.5 };
+  bd::PreIntegratedTable table;
+  table.build(ctf, otf, 64, step);
+  REQUIRE(table.size() == 64);
+  REQUIRE(table.stepSize() == step);
+
+  bd::OpacityLUT const alphas{ otf, 64 };
+  bd::ColorLUT const colors{ ctf, 64 };
+  for (size_t i{ 0 }; i < table.size(); ++i) {
+    double const a{ std::min(0.9999, alphas[i]) };
+    double const expect{ 1.0 - std::pow(1.0 - a, step) };
+    float const *e{ table.entry(i, i) };
+    REQUIRE(e[3] == Approx(expect).epsilon(1e-4));
+    REQUIRE(e[0] == Approx(std::min(1.0, colors[i].r) * expect).epsilon(1e-4));
+  }
+}
+
+
+TEST_CASE("Pre-integrated opacity doesn't depend on direction", "[preintegrated]")
+{
+  bd::ColorTransferFunction ctf;
+  bd::OpacityTransferFunction otf;
+  ctf.load(writeColorFile());
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  bd::PreIntegratedTable table;
+  table.build(ctf, otf, 48, 1.0);
+  for (size_t f{ 0 }; f < table.size(); ++f) {
+    for (size_t b{ 0 }; b < table.size(); ++b) {
+      REQUIRE(table.entry(f, b)[3] == Approx(table.entry(b, f)[3]).epsilon(1e-4));
+      REQUIRE(table.entry(f, b)[3] <= 1.0f);
+      REQUIRE(table.entry(f, b)[0] <= table.entry(f, b)[3] + 1e-5f);
+    }
+  }
+
+  // A segment crossing an opaque spike is more opaque than its ends.
+  bd::OpacityTransferFunction spiked;
+  spiked.load(writeOpacityFile(9, 0.05, 4));
+  table.build(ctf, spiked, 48, 1.0);
+  REQUIRE(table.entry(0, 47)[3] > table.entry(0, 0)[3] * 2);
+}
+
+
+TEST_CASE("Incremental update matches a full rebuild", "[preintegrated]")
+{
+  bd::ColorTransferFunction ctf;
+  bd::OpacityTransferFunction before;
+  bd::OpacityTransferFunction after;
+  ctf.load(writeColorFile());
+  before.load(writeOpacityFile(9, 0.1, 2));
+  after.load(writeOpacityFile(9, 0.1, 6));
+
+  bd::PreIntegratedTable table;
+  table.build(ctf, before, 64, 1.0);
+  REQUIRE(table.update(ctf, before) == 0);
+
+  size_t const redone{ table.update(ctf, after) };
+  REQUIRE(redone > 0);
+  REQUIRE(redone < 64 * 64);
+
+  bd::PreIntegratedTable full;
+  full.build(ctf, after, 64, 1.0);
+  for (size_t i{ 0 }; i < 64 * 64 * 4; ++i) {
+    REQUIRE(table.data()[i] == full.data()[i]);
+  }
+
+  std::remove("test_preintegrated.ctf");
+  std::remove("test_preintegrated.1dt");
+}
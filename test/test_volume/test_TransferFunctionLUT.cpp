@@ -0,0 +1,65 @@
+#include <bd/volume/transferfunctionlut.h>
+
+#include <cmath>
+#include <limits>
+
+#include <catch.hpp>
+
+#define RES_DIR RESOURCE_FOLDER
+
+
+TEST_CASE("Opacity LUT entries match the function", "[otf][lut]")
+{
+  bd::OpacityTransferFunction otf{ };
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  bd::OpacityLUT lut{ otf, 4096 };
+  REQUIRE(lut.size() == 4096);
+  for (size_t i{ 0 }; i < lut.size(); ++i) {
+    double const s{ i / 4095.0 };
+    REQUIRE(lut[i] == otf.interpolate(s));
+    REQUIRE(lut.lookup(s) == lut[i]);
+  }
+
+  // Out of range values clamp to the ends instead of throwing.
+  REQUIRE(lut.lookup(-3.0) == lut[0]);
+  REQUIRE(lut.lookup(7.0) == lut[4095]);
+  REQUIRE(lut.lookup(std::numeric_limits<double>::quiet_NaN()) == lut[0]);
+}
+
+
+TEST_CASE("Opacity LUTs for 8 bit data have one entry per value", "[otf][lut]")
+{
+  bd::OpacityTransferFunction otf{ };
+  otf.load(RES_DIR "/scalar_opacity_tf.1dt");
+
+  SECTION("Full data range")
+  {
+    bd::OpacityLUT lut{ bd::OpacityLUT::forType<unsigned char>(otf, 0, 255) };
+    REQUIRE(lut.size() == 256);
+    for (int v{ 0 }; v < 256; ++v) {
+      REQUIRE(lut.lookup(v) == otf.interpolate(v / 255.0));
+    }
+  }
+
+  SECTION("Part of the range")
+  {
+    bd::OpacityLUT lut{ bd::OpacityLUT::forType<char>(otf, -10, 90) };
+    REQUIRE(lut.size() == 256);
+    REQUIRE(lut.lo() == -128.0);
+    for (int v{ -128 }; v < 128; ++v) {
+      double s{ ( v + 10 ) / 100.0 };
+      s = s < 0.0 ? 0.0 : s > 1.0 ? 1.0 : s;
+      REQUIRE(lut.lookup(v) == otf.interpolate(s));
+    }
+  }
+
+  SECTION("Float data gets the default size")
+  {
+    bd::OpacityLUT lut{ bd::OpacityLUT::forType<float>(otf, 2.0f, 4.0f) };
+    REQUIRE(lut.size() == bd::TF_LUT_DEFAULT_SIZE);
+    REQUIRE(lut.lookup(2.0) == otf.interpolate(0.0));
+    REQUIRE(lut.lookup(4.0) == otf.interpolate(1.0));
+    REQUIRE(lut.lookup(3.0) == Approx(otf.interpolate(0.5)).epsilon(1e-3));
+  }
+}
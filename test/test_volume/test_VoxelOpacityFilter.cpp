@@ -4,7 +4,11 @@
 
 #include <bd/filter/voxelopacityfilter.h>
 #include <bd/volume/transferfunction.h>
+#include <bd/volume/transferfunctionlut.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <thread>
 #include <vector>
 #include <limits>
 
@@ -78,3 +82,115 @@ TEST_CASE("Given matching irrelevant voxel, returns false", "[voxelopacityfilter
   bool r{ vof(0) };
   REQUIRE(r == false);
 }
+
+
+TEST_CASE("Batch classification of 8 bit voxels matches operator()",
+          "[voxelopacityfilter][classify]")
+{
+  // Every value a few times over, and a length that leaves a partial word.
+  std::vector<unsigned char> data(1000);
+  for (size_t i{ 0 }; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 7);
+  }
+
+  std::vector<uint64_t> bits(bd::VoxelOpacityFilter<unsigned char>::maskWords(data.size()));
+  REQUIRE(bits.size() == 16);
+  uint64_t relevant{ vof.classify(data.data(), data.size(), bits.data()) };
+
+  uint64_t expected{ 0 };
+  for (size_t i{ 0 }; i < data.size(); ++i) {
+    bool const bit{ ( ( bits[i / 64] >> ( i % 64 ) ) & 1 ) != 0 };
+    REQUIRE(bit == vof(data[i]));
+    expected += vof(data[i]) ? 1 : 0;
+  }
+  REQUIRE(relevant == expected);
+  REQUIRE(( bits.back() >> ( data.size() % 64 ) ) == 0);
+}
+
+
+TEST_CASE("Batch classification of 16 bit voxels matches operator() over the data range",
+          "[voxelopacityfilter][classify]")
+{
+  bd::VoxelOpacityFilter<unsigned short> const f{
+      func, 0.8, 1.0,
+      static_cast<unsigned short>(1000), static_cast<unsigned short>(60000) };
+
+  std::vector<unsigned short> vals(65536);
+  for (size_t i{ 0 }; i < vals.size(); ++i) {
+    vals[i] = static_cast<unsigned short>(i);
+  }
+  bd::Buffer<unsigned short> buf{ vals.data(), vals.size() };
+  buf.setNumElements(vals.size());
+
+  std::vector<uint64_t> bits;
+  uint64_t relevant{ f.classify(buf, bits) };
+  REQUIRE(bits.size() == 1024);
+
+  // Values outside the data range are classified as its nearest end.
+  uint64_t expected{ 0 };
+  for (size_t i{ 0 }; i < vals.size(); ++i) {
+    unsigned short const v{ std::min<unsigned short>(60000, std::max<unsigned short>(1000, vals[i])) };
+    bool const bit{ ( ( bits[i / 64] >> ( i % 64 ) ) & 1 ) != 0 };
+    REQUIRE(bit == f(v));
+    expected += f(v) ? 1 : 0;
+  }
+  REQUIRE(relevant == expected);
+}
+
+
+TEST_CASE("Batch classification of float voxels follows the table",
+          "[voxelopacityfilter][classify]")
+{
+  bd::VoxelOpacityFilter<float> const f{ func, 0.8, 1.0, -2.0f, 2.0f };
+  size_t const n{ bd::TF_LUT_DEFAULT_SIZE };
+
+  // Values at the LUT entries away from the 0.8 boundary (at 0.5) agree.
+  std::vector<float> vals;
+  for (size_t i{ 0 }; i < n; i += 97) {
+    double const s{ i / static_cast<double>(n - 1) };
+    if (s < 0.49 || s > 0.51) {
+      vals.push_back(static_cast<float>(-2.0 + 4.0 * s));
+    }
+  }
+  vals.push_back(-100.0f);
+  vals.push_back(100.0f);
+
+  std::vector<uint64_t> bits(bd::VoxelOpacityFilter<float>::maskWords(vals.size()));
+  f.classify(vals.data(), vals.size(), bits.data());
+  for (size_t i{ 0 }; i < vals.size(); ++i) {
+    float const v{ std::min(2.0f, std::max(-2.0f, vals[i])) };
+    bool const bit{ ( ( bits[i / 64] >> ( i % 64 ) ) & 1 ) != 0 };
+    REQUIRE(bit == f(v));
+  }
+}
+
+
+TEST_CASE("Copies of a filter classify alike from several threads",
+          "[voxelopacityfilter][classify]")
+{
+  bd::VoxelOpacityFilter<float> const f{ func, 0.8, 1.0, 0.0f, 1.0f };
+  std::vector<float> vals(4096);
+  for (size_t i{ 0 }; i < vals.size(); ++i) {
+    vals[i] = static_cast<float>(i) / vals.size();
+  }
+
+  // The copies are made before any of them has built the shared table.
+  std::vector<bd::VoxelOpacityFilter<float>> copies(4, f);
+  std::vector<std::vector<uint64_t>> bits(copies.size());
+  std::vector<std::thread> threads;
+  for (size_t t{ 0 }; t < copies.size(); ++t) {
+    threads.push_back(std::thread{ [&, t]() {
+      bits[t].resize(bd::VoxelOpacityFilter<float>::maskWords(vals.size()));
+      copies[t].classify(vals.data(), vals.size(), bits[t].data());
+    }});
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+
+  std::vector<uint64_t> expected(bits[0].size());
+  f.classify(vals.data(), vals.size(), expected.data());
+  for (auto const &b : bits) {
+    REQUIRE(b == expected);
+  }
+}